@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Synthetic multi-file torrent: `files` entries, each with a length and a
+// three-component path, plus a pieces blob, the shape that dominates large
+// real-world torrents.
+inline std::string MakeMultiFileTorrent(int files) {
+  std::string doc = "d8:announce31:http://tracker.example/announce4:infod";
+  doc += "5:filesl";
+  for (int i = 0; i < files; ++i) {
+    const std::string leaf = "file_" + std::to_string(i) + ".bin";
+    doc += "d6:lengthi" + std::to_string(1000 + i * 37) + "e4:pathl";
+    doc += "6:albums";
+    doc += "4:disc";
+    doc += std::to_string(leaf.size()) + ":" + leaf;
+    doc += "ee";
+  }
+  doc += "e4:name7:archive12:piece lengthi262144e6:pieces";
+  const size_t pieces = static_cast<size_t>(files / 4 + 1) * 20;
+  doc += std::to_string(pieces) + ":" + std::string(pieces, '\x5a');
+  doc += "ee";
+  return doc;
+}
+
+// Runs fn `runs` times and returns the best time in seconds
+template <typename Fn> double BestSeconds(int runs, Fn &&fn) {
+  double best = 1e300;
+  for (int i = 0; i < runs; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  return best;
+}
+
+// Runs fn `runs` times and prints the best throughput over `bytes`
+template <typename Fn>
+void Report(const char *name, size_t bytes, int runs, Fn &&fn) {
+  const double best = BestSeconds(runs, fn);
+  std::printf("  %-34s %9.3f ms  %8.1f MB/s\n", name, best * 1e3,
+              bytes / best / 1e6);
+}
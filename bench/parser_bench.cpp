@@ -0,0 +1,267 @@
+// Throughput of the parsing front ends over a large info.files list.
+#include "bench_util.h"
+#include "bencode_parser.h"
+#include "bencode_projection.h"
+#include "piece_hash_index.h"
+#include "piece_map.h"
+#include "piece_verifier.h"
+#include "string_kind.h"
+#include "structural_index.h"
+#include "torrent_creator.h"
+#include "torrent_metainfo.h"
+#include "torrent_tape.h"
+#include "torrent_reader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv) {
+  const int files = argc > 1 ? std::atoi(argv[1]) : 200000;
+  const std::string doc = MakeMultiFileTorrent(files);
+  std::printf("info.files entries: %d, document: %.1f MB\n", files,
+              doc.size() / 1e6);
+
+  const int runs = 5;
+  Report("BencodeParser (events only)", doc.size(), runs, [&] {
+    BencodeHandler ignore;
+    BencodeParser(doc).parse(ignore);
+  });
+  // Tree timings include tearing the tree down again
+  Report("BencodeParser + TorrentTreeBuilder", doc.size(), runs, [&] {
+    BencodeParser parser(doc);
+    TorrentTreeBuilder builder;
+    parser.parse(builder);
+  });
+  Report("  ... tree in a monotonic arena", doc.size(), runs, [&] {
+    std::pmr::monotonic_buffer_resource arena(doc.size());
+    BencodeParser parser(doc);
+    TorrentTreeBuilder builder(&arena);
+    parser.parse(builder);
+    // Like TorrentReader, leave the arena to reclaim the tree wholesale
+    new (arena.allocate(sizeof(TorrentValue), alignof(TorrentValue)))
+        TorrentValue(std::move(builder.result()));
+  });
+  Report("  ... projected to 4 fields", doc.size(), runs, [&] {
+    TorrentTreeBuilder builder;
+    ProjectionHandler projection({{"announce"},
+                                  {"info", "name"},
+                                  {"info", "piece length"},
+                                  {"info", "files", "*", "length"}},
+                                 builder);
+    BencodeParser(doc).parse(projection);
+  });
+  // One line per named parser instantiation
+  Report("LenientBencodeParser (events only)", doc.size(), runs, [&] {
+    BencodeHandler ignore;
+    LenientBencodeParser(doc).parse(ignore);
+  });
+  Report("TrustedBencodeParser (events only)", doc.size(), runs, [&] {
+    BencodeHandler ignore;
+    TrustedBencodeParser(doc).parse(ignore);
+  });
+  Report("OwningBencodeParser (events only)", doc.size(), runs, [&] {
+    std::pmr::monotonic_buffer_resource arena(doc.size());
+    BencodeHandler ignore;
+    OwningBencodeParser(doc, {}, OwnedStrings(&arena)).parse(ignore);
+  });
+  Report("  ... trusted, tree in arena", doc.size(), runs, [&] {
+    std::pmr::monotonic_buffer_resource arena(doc.size());
+    TorrentTreeBuilder builder(&arena);
+    TrustedBencodeParser(doc).parse(builder);
+    new (arena.allocate(sizeof(TorrentValue), alignof(TorrentValue)))
+        TorrentValue(std::move(builder.result()));
+  });
+  {
+    // TorrentReader end to end from a mapped file, one thread vs all cores
+    const auto path =
+        std::filesystem::temp_directory_path() / "torrent_bench.torrent";
+    std::ofstream(path, std::ios::binary) << doc;
+    TorrentReaderOptions options;
+    options.arena = true;
+    Report("TorrentReader, arena, 1 thread", doc.size(), runs,
+           [&] { TorrentReader reader(path.string(), options); });
+    options.threads = 0;
+    std::printf("  ... %u hardware threads\n",
+                std::thread::hardware_concurrency());
+    Report("TorrentReader, arena, all threads", doc.size(), runs,
+           [&] { TorrentReader reader(path.string(), options); });
+    std::filesystem::remove(path);
+  }
+  {
+    // Batch ingestion where most files are broken: small torrents cut short
+    // at varying points, opened by exception or by std::expected
+    const auto dir = std::filesystem::temp_directory_path() / "torrent_bench";
+    std::filesystem::create_directories(dir);
+    const std::string small = MakeMultiFileTorrent(20);
+    std::vector<std::string> paths;
+    for (int i = 0; i < 2000; ++i) {
+      paths.push_back((dir / (std::to_string(i) + ".torrent")).string());
+      const size_t cut = i % 4 == 0 ? small.size() : small.size() * i / 2000;
+      std::ofstream(paths.back(), std::ios::binary) << small.substr(0, cut);
+    }
+    const size_t bytes = small.size() * paths.size();
+    size_t good = 0;
+    Report("Corpus, constructor + catch", bytes, runs, [&] {
+      good = 0;
+      for (const auto &file : paths) {
+        try {
+          TorrentReader reader(file);
+          ++good;
+        } catch (const std::exception &) {
+        }
+      }
+    });
+    Report("Corpus, TorrentReader::parse", bytes, runs, [&] {
+      good = 0;
+      for (const auto &file : paths)
+        good += TorrentReader::parse(file).has_value();
+    });
+    std::printf("  %zu of %zu files valid\n", good, paths.size());
+    std::filesystem::remove_all(dir);
+  }
+  {
+    // Per-file summary over a built tree: string-keyed lookups per field
+    // against one TorrentMetainfo pass
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    const TorrentValue &root = builder.result();
+    uint64_t total = 0;
+    Report("Summary via TorrentDict::at", doc.size(), runs, [&] {
+      total = 0;
+      const auto &info = root.asDict().at("info").asDict();
+      for (const auto &file : info.at("files").asList()) {
+        const auto &entry = file.asDict();
+        total += entry.at("length").asInt() + entry.at("path").asList().size();
+      }
+    });
+    Report("Building TorrentMetainfo", doc.size(), runs,
+           [&] { TorrentMetainfo meta(root); });
+    Report("Building TorrentMetainfo from a tape, parse included",
+           doc.size(), runs, [&] { TorrentMetainfo meta{TorrentTape(doc)}; });
+    const TorrentMetainfo meta(root);
+    Report("Summary via TorrentMetainfo", doc.size(), runs, [&] {
+      total = 0;
+      for (const auto &file : meta.files())
+        total += file.length + file.path.size();
+    });
+    // Both directions of the piece/file index, for every piece and file
+    Report("Building PieceMap", doc.size(), runs,
+           [&] { PieceMap map(meta); });
+    const PieceMap map(meta);
+    Report("PieceMap, files of every piece", doc.size(), runs, [&] {
+      for (size_t piece = 0; piece < map.pieceCount(); ++piece)
+        total += map.filesOf(piece).size();
+    });
+    Report("PieceMap, pieces of every file", doc.size(), runs, [&] {
+      for (size_t file = 0; file < map.fileCount(); ++file)
+        total += map.piecesOf(file).size();
+    });
+    std::printf("  (%llu)\n", static_cast<unsigned long long>(total));
+  }
+  {
+    // Piece verification over 256 MiB in 64 files of 4 MiB, 1 MiB pieces;
+    // the data is in the page cache after the first run
+    const auto dir = std::filesystem::temp_directory_path() / "verify_bench";
+    std::filesystem::create_directories(dir / "data");
+    const size_t file_size = 4 << 20, piece = 1 << 20, count = 64;
+    std::string content(file_size, '\0');
+    std::string pieces, info = "5:filesl";
+    for (size_t f = 0; f < count; ++f) {
+      for (size_t i = 0; i < content.size(); ++i)
+        content[i] = static_cast<char>(i * 31 + f);
+      std::ofstream(dir / "data" / std::to_string(f), std::ios::binary)
+          << content;
+      for (size_t at = 0; at < file_size; at += piece) {
+        const auto digest = sha1(std::string_view(content).substr(at, piece));
+        pieces.append(reinterpret_cast<const char *>(digest.data()), 20);
+      }
+      info += "d6:lengthi" + std::to_string(file_size) + "e4:pathl" +
+              std::to_string(std::to_string(f).size()) + ":" +
+              std::to_string(f) + "ee";
+    }
+    const std::string torrent =
+        "d4:infod" + info + "e4:name4:data12:piece lengthi" +
+        std::to_string(piece) + "e6:pieces" + std::to_string(pieces.size()) +
+        ":" + pieces + "ee";
+    TorrentTreeBuilder builder;
+    BencodeParser(torrent).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+    for (const size_t threads : {size_t{1}, size_t{0}}) {
+      Report(threads == 1 ? "PieceVerifier, 1 thread"
+                          : "PieceVerifier, all threads",
+             file_size * count, runs, [&] {
+               PieceVerifier verifier(meta, dir, threads);
+               verifier.start();
+               verifier.wait();
+             });
+    }
+    TorrentCreateOptions create;
+    create.piece_length = piece;
+    for (const size_t threads : {size_t{1}, size_t{0}}) {
+      create.threads = threads;
+      Report(threads == 1 ? "createTorrent, 1 thread"
+                          : "createTorrent, all threads",
+             file_size * count, runs,
+             [&] { createTorrent(dir / "data", create); });
+    }
+    std::filesystem::remove_all(dir);
+  }
+  {
+    // Digest index over 4M pieces (an 80 MB "pieces" string)
+    const size_t count = 4 << 20;
+    std::vector<unsigned char> digests(count * 20);
+    uint64_t state = 88172645463325252ULL;
+    for (auto &byte : digests) {
+      state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+      byte = static_cast<unsigned char>(state);
+    }
+    Report("PieceHashIndex, 4M pieces", digests.size(), runs,
+           [&] { PieceHashIndex index(digests, 20); });
+    const PieceHashIndex index(digests, 20);
+    size_t found = 0;
+    Report("  ... find every piece", digests.size(), runs, [&] {
+      for (size_t piece = 0; piece < count; ++piece)
+        found += index.find(index.digest(piece)) == piece;
+    });
+    std::printf("  (%zu)\n", found);
+  }
+  Report("TorrentTape", doc.size(), runs, [&] { TorrentTape tape(doc); });
+  {
+    const TorrentTape tape(doc);
+    std::printf("  %zu values, %zu bytes per value on the tape "
+                "(TorrentValue alone: %zu)\n",
+                tape.size(), sizeof(TapeNode), sizeof(TorrentValue));
+  }
+  Report("StructuralIndex, scalar bitmap", doc.size(), runs, [&] {
+    StructuralIndex index(doc, {}, StructuralBitmap::Kernel::Scalar);
+  });
+  if (StructuralBitmap::bestKernel() != StructuralBitmap::Kernel::Scalar) {
+    Report("StructuralIndex, SSE2 bitmap", doc.size(), runs, [&] {
+      StructuralIndex index(doc, {}, StructuralBitmap::Kernel::SSE2);
+    });
+  }
+  if (StructuralBitmap::bestKernel() == StructuralBitmap::Kernel::AVX2) {
+    Report("StructuralIndex, AVX2 bitmap", doc.size(), runs, [&] {
+      StructuralIndex index(doc, {}, StructuralBitmap::Kernel::AVX2);
+    });
+  }
+  Report("StructuralBitmap only (best)", doc.size(), runs,
+         [&] { StructuralBitmap bits(doc); });
+
+  // A long text value, the worst case for classification: no early exit
+  const std::string text(16 << 20, 'a');
+  for (const auto &[name, kernel] :
+       {std::pair{"classifyString, scalar", StructuralBitmap::Kernel::Scalar},
+        std::pair{"classifyString, SSE2", StructuralBitmap::Kernel::SSE2},
+        std::pair{"classifyString, AVX2", StructuralBitmap::Kernel::AVX2}}) {
+    if (kernel > StructuralBitmap::bestKernel())
+      continue;
+    Report(name, text.size(), runs, [&] { classifyString(text, kernel); });
+  }
+  return 0;
+}
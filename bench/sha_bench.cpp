@@ -0,0 +1,58 @@
+// SHA kernel throughput: every kernel this CPU supports, hashing 256 MiB
+// cut into pieces from 16 KiB to 16 MiB, enough to fill 16 lanes of each
+#include "bench_util.h"
+#include "sha.h"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+const char *kernelName(const ShaKernel kernel) {
+  switch (kernel) {
+  case ShaKernel::Scalar:
+    return "scalar";
+  case ShaKernel::SHANI:
+    return "sha-ni";
+  case ShaKernel::AVX2:
+    return "avx2 x8";
+  case ShaKernel::AVX512:
+    return "avx512 x16";
+  }
+  return "?";
+}
+
+} // namespace
+
+int main() {
+  constexpr size_t total = 256 << 20;
+  std::string data(total, '\0');
+  for (size_t i = 0; i < total; ++i)
+    data[i] = static_cast<char>(i * 2654435761u >> 24);
+
+  std::printf("SHA kernels over %zu MiB (best: %s)\n", total >> 20,
+              kernelName(bestShaKernel()));
+  for (size_t piece = 16 << 10; piece <= 16 << 20; piece *= 4) {
+    std::vector<std::string_view> pieces;
+    for (size_t at = 0; at < total; at += piece)
+      pieces.push_back(std::string_view(data).substr(at, piece));
+    std::vector<Sha1Digest> sha1_digests(pieces.size());
+    std::vector<Sha256Digest> sha256_digests(pieces.size());
+    std::printf("%zu KiB pieces\n", piece >> 10);
+    for (const ShaKernel kernel : {ShaKernel::Scalar, ShaKernel::SHANI,
+                                   ShaKernel::AVX2, ShaKernel::AVX512}) {
+      if (!shaKernelSupported(kernel))
+        continue;
+      const double sha1_seconds =
+          BestSeconds(3, [&] { sha1Many(pieces, sha1_digests, kernel); });
+      const double sha256_seconds =
+          BestSeconds(3, [&] { sha256Many(pieces, sha256_digests, kernel); });
+      std::printf("  %-12s sha1 %6.2f GB/s  sha256 %6.2f GB/s\n",
+                  kernelName(kernel), total / sha1_seconds / 1e9,
+                  total / sha256_seconds / 1e9);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,621 @@
+#include "bencode_parser.h"
+
+#include "structural_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+
+bool readBencodeInteger(const std::string_view text, long long &value,
+                        const bool canonical) {
+  if (canonical) {
+    if (text == "-0" || (text.size() > 1 && text[0] == '0'))
+      return false;
+  }
+  const char *first = text.data();
+  const char *last = first + text.size();
+  const auto [end, error] = std::from_chars(first, last, value);
+  return error == std::errc() && end == last && first != last;
+}
+
+bool readBencodeLength(const std::string_view text, size_t &value) {
+  const char *first = text.data();
+  const char *last = first + text.size();
+  // from_chars takes no sign for unsigned types, so "-1" fails here too
+  const auto [end, error] = std::from_chars(first, last, value);
+  return error == std::errc() && end == last && first != last;
+}
+
+long long parseBencodeInteger(const std::string_view text) {
+  long long value = 0;
+  if (!readBencodeInteger(text, value)) {
+    if (text == "-0")
+      throw std::runtime_error("Invalid integer -0");
+    if (text.size() > 1 && text[0] == '0')
+      throw std::runtime_error("Invalid leading zero");
+    throw std::runtime_error("Integer parse error: " + std::string(text));
+  }
+  return value;
+}
+
+// --- Errors as values ---
+
+const char *describe(const ParseErrorKind kind) {
+  switch (kind) {
+  case ParseErrorKind::EmptyInput:
+    return "File is empty";
+  case ParseErrorKind::NotADictionary:
+    return "Invalid torrent file: Must start with a dictionary 'd'";
+  case ParseErrorKind::UnexpectedEnd:
+    return "Unexpected End Of File";
+  case ParseErrorKind::InvalidInteger:
+    return "Invalid integer";
+  case ParseErrorKind::InvalidLength:
+    return "Invalid string length format";
+  case ParseErrorKind::StringOutOfBounds:
+    return "String content out of bounds";
+  case ParseErrorKind::KeyNotString:
+    return "Dictionary key must be a string";
+  case ParseErrorKind::MissingValue:
+    return "Missing dictionary value";
+  case ParseErrorKind::UnknownType:
+    return "Unknown type indicator";
+  case ParseErrorKind::LimitExceeded:
+    return "Parse limit exceeded";
+  case ParseErrorKind::Io:
+    return "Cannot read file";
+  case ParseErrorKind::Stream:
+    return "Stream error";
+  }
+  return "Parse error";
+}
+
+std::string ParseError::message() const {
+  std::string text = describe(kind);
+  if (kind != ParseErrorKind::Io && kind != ParseErrorKind::Stream)
+    text += " at position " + std::to_string(offset);
+  if (!detail.empty())
+    text += ": " + detail;
+  return text;
+}
+
+std::expected<size_t, ParseError>
+validateBencode(const std::string_view source, const ParseLimits &limits,
+                const bool canonical_integers) {
+  struct Open {
+    bool is_dict;
+    bool expect_key;
+  };
+  const auto fail = [](ParseErrorKind kind, size_t at) {
+    return std::unexpected(ParseError{kind, at, {}});
+  };
+
+  const size_t size = source.size();
+  std::vector<Open> open;
+  size_t nodes = 0;
+  size_t string_bytes = 0;
+  size_t pos = 0;
+  do {
+    if (pos >= size)
+      return fail(size == 0 ? ParseErrorKind::EmptyInput
+                            : ParseErrorKind::UnexpectedEnd,
+                  pos);
+    const char c = source[pos];
+    const bool key = !open.empty() && open.back().is_dict &&
+                     open.back().expect_key;
+
+    if (c == 'e' && !open.empty()) {
+      if (open.back().is_dict && !open.back().expect_key)
+        return fail(ParseErrorKind::MissingValue, pos);
+      open.pop_back();
+      ++pos;
+    } else if (key && !(c >= '0' && c <= '9')) {
+      return fail(ParseErrorKind::KeyNotString, pos);
+    } else if (c >= '0' && c <= '9') {
+      // Keys are not values, so only count them towards the byte budget
+      if (!key && ++nodes > limits.max_nodes)
+        return fail(ParseErrorKind::LimitExceeded, pos);
+      const size_t colon = source.find(':', pos);
+      size_t length = 0;
+      if (colon == std::string_view::npos)
+        return fail(ParseErrorKind::UnexpectedEnd, pos);
+      if (!readBencodeLength(source.substr(pos, colon - pos), length))
+        return fail(ParseErrorKind::InvalidLength, pos);
+      if (length > size - colon - 1)
+        return fail(ParseErrorKind::StringOutOfBounds, pos);
+      if (length > limits.max_string_bytes - string_bytes)
+        return fail(ParseErrorKind::LimitExceeded, pos);
+      string_bytes += length;
+      pos = colon + 1 + length;
+    } else if (c == 'i') {
+      if (++nodes > limits.max_nodes)
+        return fail(ParseErrorKind::LimitExceeded, pos);
+      const size_t end = source.find('e', pos + 1);
+      long long value = 0;
+      if (end == std::string_view::npos)
+        return fail(ParseErrorKind::UnexpectedEnd, pos);
+      if (!readBencodeInteger(source.substr(pos + 1, end - pos - 1), value,
+                              canonical_integers))
+        return fail(ParseErrorKind::InvalidInteger, pos);
+      pos = end + 1;
+    } else if (c == 'l' || c == 'd') {
+      if (++nodes > limits.max_nodes || open.size() + 1 > limits.max_depth)
+        return fail(ParseErrorKind::LimitExceeded, pos);
+      open.push_back({c == 'd', true});
+      ++pos;
+      continue; // the container itself is not a complete value yet
+    } else {
+      return fail(ParseErrorKind::UnknownType, pos);
+    }
+
+    // A key or value just finished inside a dictionary
+    if (!open.empty() && open.back().is_dict)
+      open.back().expect_key = !open.back().expect_key;
+  } while (!open.empty());
+  return pos;
+}
+
+// --- Policies ---
+
+long long StrictIntegers::length(const std::string_view text) {
+  size_t value = 0;
+  if (!readBencodeLength(text, value) ||
+      value > static_cast<size_t>(std::numeric_limits<long long>::max()))
+    throw std::runtime_error("Invalid string length format");
+  return static_cast<long long>(value);
+}
+
+long long LenientIntegers::integer(const std::string_view text) {
+  long long value = 0;
+  if (!readBencodeInteger(text, value, false))
+    throw std::runtime_error("Integer parse error: " + std::string(text));
+  return value;
+}
+
+std::string_view OwnedStrings::keep(const std::string_view bytes) const {
+  if (bytes.empty())
+    return {};
+  auto *copy = static_cast<char *>(resource->allocate(bytes.size(), 1));
+  std::copy(bytes.begin(), bytes.end(), copy);
+  return {copy, bytes.size()};
+}
+
+// --- BasicBencodeParser Implementation ---
+
+template <typename Integers, typename Strings, typename Bounds>
+BasicBencodeParser<Integers, Strings, Bounds>::BasicBencodeParser(
+    std::string_view source, const ParseLimits &limits, Strings strings)
+    : source_data(source), budget(limits), strings(strings) {}
+
+template <typename Integers, typename Strings, typename Bounds>
+BasicBencodeParser<Integers, Strings, Bounds>::BasicBencodeParser(
+    const StructuralIndex &index, const size_t node, Strings strings)
+    : source_data(index.source()), index(&index), next_container(node),
+      strings(strings) {
+  if (node >= index.size())
+    throw std::runtime_error("Container " + std::to_string(node) +
+                             " is not in the structural index");
+  pos = index[node].begin;
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+size_t BasicBencodeParser<Integers, Strings, Bounds>::position() const {
+  return pos;
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+bool BasicBencodeParser<Integers, Strings, Bounds>::parse(
+    BencodeHandler &handler) {
+  return run(handler, frames.size());
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+void BasicBencodeParser<Integers, Strings, Bounds>::skip() {
+  const char c = peek();
+  if (c == 'l' || c == 'd') {
+    consume();
+    budget.node();
+    budget.enter(frames.size() + 1);
+    skipContainer(c, next_container++);
+    return;
+  }
+  BencodeHandler ignore;
+  parseValue(ignore);
+}
+
+// Skip the remainder of a container whose opening byte was just consumed
+template <typename Integers, typename Strings, typename Bounds>
+void BasicBencodeParser<Integers, Strings, Bounds>::skipContainer(
+    const char type, const size_t node) {
+  if (index) {
+    // An index loaded from a snapshot may leave containers out, so make sure
+    // this one really starts at the byte just consumed before jumping
+    if (node >= index->size() || (*index)[node].begin != pos - 1)
+      throw std::runtime_error("Structural index does not match container at " +
+                               std::to_string(pos - 1));
+    pos = (*index)[node].end;
+    next_container = index->next(node);
+    return;
+  }
+  frames.push_back({type == 'd'});
+  BencodeHandler ignore;
+  run(ignore, frames.size() - 1);
+}
+
+// --- Parser Logic ---
+
+template <typename Integers, typename Strings, typename Bounds>
+char BasicBencodeParser<Integers, Strings, Bounds>::peek() const {
+  if constexpr (Bounds::enabled) {
+    if (pos >= source_data.size())
+      return 0; // EOF
+  }
+  return source_data[pos];
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+char BasicBencodeParser<Integers, Strings, Bounds>::consume() {
+  if constexpr (Bounds::enabled) {
+    if (pos >= source_data.size())
+      throw std::out_of_range("Unexpected End Of File");
+  }
+  return source_data[pos++];
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+bool BasicBencodeParser<Integers, Strings, Bounds>::match(
+    const char expected) {
+  if (peek() == expected) {
+    consume();
+    return true;
+  }
+  return false;
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+void BasicBencodeParser<Integers, Strings, Bounds>::expect(
+    const char expected) {
+  if (consume() != expected) {
+    throw std::runtime_error(std::string("Expected '") + expected +
+                             "' at position " + std::to_string(pos));
+  }
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+bool BasicBencodeParser<Integers, Strings, Bounds>::run(
+    BencodeHandler &handler, const size_t stop_depth) {
+  bool stopped = false;
+  do {
+    if (frames.size() > stop_depth) {
+      const Frame frame = frames.back();
+      if (peek() == 'e' || peek() == 0) {
+        expect('e');
+        frames.pop_back();
+        const BencodeAction action =
+            frame.is_dict ? handler.onDictEnd() : handler.onListEnd();
+        if (action == BencodeAction::Stop) {
+          stopped = true;
+          break;
+        }
+        continue;
+      }
+      if (frame.is_dict) {
+        // Keys must be strings
+        const BencodeAction action = handler.onKey(parseString());
+        if (action == BencodeAction::Stop) {
+          stopped = true;
+          break;
+        }
+        if (action == BencodeAction::Skip) {
+          skip();
+          continue;
+        }
+      }
+    }
+    if (!parseValue(handler)) {
+      stopped = true;
+      break;
+    }
+  } while (frames.size() > stop_depth);
+
+  // Forget containers the handler stopped us inside of
+  frames.resize(stop_depth);
+  return !stopped;
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+bool BasicBencodeParser<Integers, Strings, Bounds>::parseValue(
+    BencodeHandler &handler) {
+  const char c = peek();
+  budget.node();
+  if (isdigit(static_cast<unsigned char>(c)))
+    return handler.onString(parseString()) != BencodeAction::Stop;
+  if (c == 'i')
+    return handler.onInt(parseInt()) != BencodeAction::Stop;
+  if (c == 'l' || c == 'd') {
+    consume();
+    const size_t node = next_container++;
+    budget.enter(frames.size() + 1);
+    const BencodeAction action =
+        c == 'd' ? handler.onDictBegin() : handler.onListBegin();
+    if (action == BencodeAction::Stop)
+      return false;
+    if (action == BencodeAction::Skip)
+      skipContainer(c, node);
+    else
+      frames.push_back({c == 'd'});
+    return true;
+  }
+
+  throw std::runtime_error(std::string("Unknown type indicator '") + c +
+                           "' at " + std::to_string(pos));
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+size_t BasicBencodeParser<Integers, Strings, Bounds>::find(
+    const char delimiter, const size_t from) const {
+  if (!index)
+    return source_data.find(delimiter, from);
+  return delimiter == ':' ? index->bitmap().nextColon(from)
+                          : index->bitmap().nextEnd(from);
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+long long BasicBencodeParser<Integers, Strings, Bounds>::parseInt() {
+  expect('i');
+  const size_t end = find('e', pos);
+  if constexpr (Bounds::enabled) {
+    if (end == std::string_view::npos)
+      throw std::runtime_error("Unterminated integer");
+  }
+
+  // Unchecked construction: bounds are the Bounds policy's business
+  const std::string_view numStr(source_data.data() + pos, end - pos);
+  pos = end + 1; // Skip 'e'
+  return Integers::integer(numStr);
+}
+
+template <typename Integers, typename Strings, typename Bounds>
+std::string_view BasicBencodeParser<Integers, Strings, Bounds>::parseString() {
+  const size_t colon = find(':', pos);
+  if constexpr (Bounds::enabled) {
+    if (colon == std::string_view::npos)
+      throw std::runtime_error("Invalid string length format");
+  }
+
+  const long long len =
+      Integers::length({source_data.data() + pos, colon - pos});
+
+  pos = colon + 1; // Skip ':'
+
+  if constexpr (Bounds::enabled) {
+    if (len < 0 || static_cast<size_t>(len) > source_data.size() - pos)
+      throw std::runtime_error("String content out of bounds");
+  }
+  budget.string(static_cast<size_t>(len));
+
+  // Borrow the bytes in place (or let the policy copy them out)
+  const std::string_view str(source_data.data() + pos,
+                             static_cast<size_t>(len));
+  pos += len;
+
+  return strings.keep(str);
+}
+
+template class BasicBencodeParser<StrictIntegers, BorrowedStrings,
+                                  CheckedBounds>;
+template class BasicBencodeParser<LenientIntegers, BorrowedStrings,
+                                  CheckedBounds>;
+template class BasicBencodeParser<LenientIntegers, BorrowedStrings,
+                                  UncheckedBounds>;
+template class BasicBencodeParser<StrictIntegers, OwnedStrings,
+                                  CheckedBounds>;
+
+// --- BencodePushParser Implementation ---
+
+namespace {
+
+// Longest length prefix / integer we wait for before calling it malformed
+constexpr size_t max_number_digits = 24;
+
+} // namespace
+
+BencodePushParser::BencodePushParser(BencodeHandler &handler,
+                                     const ParseLimits &limits)
+    : handler(handler), budget(limits) {}
+
+bool BencodePushParser::feed(const std::string_view chunk) {
+  if (done)
+    return true;
+
+  std::string_view input = chunk;
+  if (discard > 0) {
+    // The rest of a muted string; its token is already accounted for
+    const size_t dropped = std::min(discard, input.size());
+    discard -= dropped;
+    offset += dropped;
+    input.remove_prefix(dropped);
+  }
+  if (!carry.empty()) {
+    carry.append(chunk);
+    if (carry.size() < need)
+      return false; // e.g. the middle of a long string: nothing to retry yet
+    input = carry;
+  }
+
+  size_t used = 0;
+  while (!done && used < input.size()) {
+    const size_t length = step(input.substr(used));
+    if (length == 0)
+      break;
+    used += length;
+  }
+
+  if (done || used == input.size()) {
+    carry.clear();
+  } else if (input.data() == carry.data()) {
+    carry.erase(0, used);
+  } else {
+    carry.assign(input.substr(used));
+  }
+  return done;
+}
+
+void BencodePushParser::finish() const {
+  if (!done)
+    throw std::out_of_range("Unexpected End Of File");
+}
+
+void BencodePushParser::act(const BencodeAction action) {
+  if (action == BencodeAction::Stop)
+    done = halted = true;
+}
+
+size_t BencodePushParser::step(const std::string_view input) {
+  const char c = input.front();
+  const bool muted = frames.size() > mute_depth;
+
+  if (!frames.empty()) {
+    Frame &frame = frames.back();
+    if (c == 'e') {
+      if (frame.is_dict && !frame.expect_key)
+        throw std::runtime_error("Missing dictionary value at " +
+                                 std::to_string(offset));
+      ++offset;
+      endContainer();
+      return 1;
+    }
+    if (frame.is_dict && frame.expect_key) {
+      // Keys must be strings
+      if (!isdigit(static_cast<unsigned char>(c)))
+        throw std::runtime_error(std::string("Invalid key '") + c + "' at " +
+                                 std::to_string(offset));
+      std::string_view key;
+      const size_t length = stringToken(input, key, muted);
+      if (length == 0)
+        return 0;
+      frame.expect_key = false;
+      offset += length;
+      if (!muted) {
+        const BencodeAction action = handler.onKey(key);
+        skip_value = action == BencodeAction::Skip;
+        act(action);
+      }
+      return length;
+    }
+  }
+
+  const bool silent = muted || skip_value;
+  if (isdigit(static_cast<unsigned char>(c))) {
+    std::string_view value;
+    const size_t length = stringToken(input, value, silent);
+    if (length == 0)
+      return 0;
+    budget.node();
+    offset += length;
+    skip_value = false;
+    if (!silent)
+      act(handler.onString(value));
+    valueDone();
+    return length;
+  }
+  if (c == 'i') {
+    const size_t end = input.find('e');
+    if (end == std::string_view::npos) {
+      if (input.size() > max_number_digits)
+        throw std::runtime_error("Unterminated integer");
+      need = input.size() + 1;
+      return 0;
+    }
+    const long long value = parseBencodeInteger(input.substr(1, end - 1));
+    budget.node();
+    offset += end + 1;
+    skip_value = false;
+    if (!silent)
+      act(handler.onInt(value));
+    valueDone();
+    return end + 1;
+  }
+  if (c == 'l' || c == 'd') {
+    budget.node();
+    ++offset;
+    skip_value = false;
+    beginContainer(c == 'd', silent);
+    return 1;
+  }
+
+  throw std::runtime_error(std::string("Unknown type indicator '") + c +
+                           "' at " + std::to_string(offset));
+}
+
+size_t BencodePushParser::stringToken(const std::string_view input,
+                                      std::string_view &value,
+                                      const bool silent) {
+  const size_t colon = input.find(':');
+  if (colon == std::string_view::npos) {
+    if (input.size() > max_number_digits)
+      throw std::runtime_error("Invalid string length format");
+    need = input.size() + 1;
+    return 0;
+  }
+
+  size_t len = 0;
+  if (!readBencodeLength(input.substr(0, colon), len))
+    throw std::runtime_error("Invalid string length format");
+  if (!length_charged) {
+    // Before buffering any of it, so a huge prefix fails immediately
+    budget.string(static_cast<size_t>(len));
+    length_charged = true;
+  }
+
+  const size_t total = colon + 1 + static_cast<size_t>(len);
+  if (input.size() < total && silent) {
+    // Nobody sees the bytes, so count them down rather than holding them
+    discard = total - input.size();
+    length_charged = false;
+    return input.size();
+  }
+  if (input.size() < total) {
+    need = total;
+    return 0;
+  }
+  length_charged = false;
+  value = input.substr(colon + 1, static_cast<size_t>(len));
+  return total;
+}
+
+void BencodePushParser::beginContainer(const bool is_dict, const bool silent) {
+  budget.enter(frames.size() + 1);
+  frames.push_back({is_dict, true});
+  if (silent) {
+    if (mute_depth == not_muted)
+      mute_depth = frames.size() - 1;
+    return;
+  }
+  const BencodeAction action =
+      is_dict ? handler.onDictBegin() : handler.onListBegin();
+  if (action == BencodeAction::Skip)
+    mute_depth = frames.size() - 1;
+  act(action);
+}
+
+void BencodePushParser::endContainer() {
+  const bool is_dict = frames.back().is_dict;
+  frames.pop_back();
+  if (frames.size() == mute_depth) {
+    // A skipped container ends silently
+    mute_depth = not_muted;
+  } else if (frames.size() < mute_depth) {
+    act(is_dict ? handler.onDictEnd() : handler.onListEnd());
+  }
+  valueDone();
+}
+
+void BencodePushParser::valueDone() {
+  if (frames.empty())
+    done = true;
+  else if (frames.back().is_dict)
+    frames.back().expect_key = true;
+}
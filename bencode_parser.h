@@ -0,0 +1,357 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class StructuralIndex;
+
+// What the parser should do after a handler callback returns
+enum class BencodeAction {
+  Continue, // keep emitting events
+  Skip,     // from onKey: skip that key's value; from onListBegin /
+            // onDictBegin: skip the rest of the container, including its end
+            // event. Treated as Continue everywhere else.
+  Stop,     // abandon the parse; BencodeParser::parse() returns false
+};
+
+/// @brief Receives SAX-style events from BencodeParser.
+/// Every callback defaults to Continue, so handlers only override the events
+/// they care about. String and key views point into the parser's source and
+/// stay valid for as long as that buffer does. While a callback runs, the
+/// parser's position() is just past the token being reported: past the 'd'
+/// in onDictBegin, past the 'e' in onDictEnd.
+class BencodeHandler {
+public:
+  virtual ~BencodeHandler() = default;
+
+  virtual BencodeAction onInt(long long) { return BencodeAction::Continue; }
+  virtual BencodeAction onString(std::string_view) {
+    return BencodeAction::Continue;
+  }
+  virtual BencodeAction onListBegin() { return BencodeAction::Continue; }
+  virtual BencodeAction onListEnd() { return BencodeAction::Continue; }
+  virtual BencodeAction onDictBegin() { return BencodeAction::Continue; }
+  // Emitted before each dictionary value
+  virtual BencodeAction onKey(std::string_view) {
+    return BencodeAction::Continue;
+  }
+  virtual BencodeAction onDictEnd() { return BencodeAction::Continue; }
+};
+
+/// @brief Upper bounds on the work and memory a single parse may consume.
+/// The defaults impose no limit; set them when the input is untrusted.
+struct ParseLimits {
+  static constexpr size_t unlimited = std::numeric_limits<size_t>::max();
+
+  size_t max_depth = unlimited;        // nested lists/dicts open at once
+  size_t max_nodes = unlimited;        // values of any type
+  size_t max_string_bytes = unlimited; // total length of strings and keys
+};
+
+// Thrown as soon as a ParseLimits budget is exceeded
+class ParseLimitError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// What went wrong, for callers that branch on it rather than on message text
+enum class ParseErrorKind {
+  EmptyInput,        // no bytes at all
+  NotADictionary,    // a torrent must be one dictionary
+  UnexpectedEnd,     // truncated: the document stops mid-value
+  InvalidInteger,    // malformed, non-canonical or overflowing integer
+  InvalidLength,     // malformed string length prefix
+  StringOutOfBounds, // a string runs past the end of the input
+  KeyNotString,      // dictionary key that is not a string
+  MissingValue,      // dictionary key without a value
+  UnknownType,       // byte that starts no bencode value
+  LimitExceeded,     // a ParseLimits budget ran out
+  Io,                // the file could not be opened or read
+  Stream,            // compressed, archived or streamed input failed
+};
+
+/// @brief A parse failure reported as a value: its kind and the byte offset
+/// of the offending token. `detail` holds the underlying message for Io and
+/// Stream, and for LimitExceeded when the budget is known.
+struct ParseError {
+  ParseErrorKind kind;
+  size_t offset = 0;
+  std::string detail;
+
+  // Human-readable form, e.g. "Invalid integer at position 12"
+  std::string message() const;
+};
+
+const char *describe(ParseErrorKind kind);
+
+/// @brief Running totals checked against a ParseLimits. The string budget is
+/// charged from the length prefix, before the content is touched.
+class ParseBudget {
+public:
+  ParseBudget() = default;
+  explicit ParseBudget(const ParseLimits &limits) : limits(limits) {}
+
+  void enter(size_t depth) const {
+    if (depth > limits.max_depth)
+      fail("depth", limits.max_depth);
+  }
+  void node() {
+    if (++nodes > limits.max_nodes)
+      fail("node count", limits.max_nodes);
+  }
+  void string(size_t length) {
+    if (length > limits.max_string_bytes - string_bytes)
+      fail("string bytes", limits.max_string_bytes);
+    string_bytes += length;
+  }
+
+  size_t nodeCount() const { return nodes; }
+  size_t stringBytes() const { return string_bytes; }
+
+private:
+  ParseLimits limits;
+  size_t nodes = 0;
+  size_t string_bytes = 0;
+
+  [[noreturn]] static void fail(const char *what, size_t limit) {
+    throw ParseLimitError(std::string("Parse limit exceeded: ") + what +
+                          " > " + std::to_string(limit));
+  }
+};
+
+// Convert the text between 'i' and 'e', rejecting "-0" and leading zeros.
+// Throws std::runtime_error on malformed integers.
+long long parseBencodeInteger(std::string_view text);
+
+// Non-throwing integer and length-prefix conversions (std::from_chars).
+// `canonical` rejects "-0" and leading zeros; false on malformed text.
+bool readBencodeInteger(std::string_view text, long long &value,
+                        bool canonical = true);
+bool readBencodeLength(std::string_view text, size_t &value);
+
+/// @brief Check that `source` starts with one well-formed bencoded value
+/// within `limits`, without building anything and without throwing: returns
+/// the value's length, or where and why it is malformed. With
+/// `canonical_integers` false, integers are checked like LenientIntegers.
+std::expected<size_t, ParseError>
+validateBencode(std::string_view source, const ParseLimits &limits = {},
+                bool canonical_integers = true);
+
+// --- Parser policies ---
+// BasicBencodeParser takes one policy of each kind below. Policies are
+// resolved at compile time, so an instantiation contains no code, and no
+// branches, for the checks it leaves out.
+
+/// @brief Integer and length-prefix rules of the bencode spec: no leading
+/// zeros, no "-0", no overflow. For ingesting untrusted files.
+struct StrictIntegers {
+  static long long integer(std::string_view text) {
+    return parseBencodeInteger(text);
+  }
+  static long long length(std::string_view text);
+};
+
+/// @brief Also accepts non-canonical integers ("007", "-0") written by some
+/// clients; malformed digits and overflow still throw.
+struct LenientIntegers {
+  static long long integer(std::string_view text);
+  static long long length(std::string_view text) { return integer(text); }
+};
+
+/// @brief Strings are views into the parser's source (zero-copy).
+struct BorrowedStrings {
+  std::string_view keep(std::string_view bytes) const { return bytes; }
+};
+
+/// @brief Strings are copied into `resource` before being reported, so they
+/// outlive the source buffer (e.g. a mapping the caller wants to release).
+struct OwnedStrings {
+  explicit OwnedStrings(std::pmr::memory_resource *resource)
+      : resource(resource) {}
+  std::string_view keep(std::string_view bytes) const;
+
+  std::pmr::memory_resource *resource;
+};
+
+/// @brief Every read is checked against the end of the source; truncated or
+/// lying length prefixes throw.
+struct CheckedBounds {
+  static constexpr bool enabled = true;
+};
+
+/// @brief No end-of-input or length-prefix checks. Only for input that has
+/// already passed a checked parse: malformed input is undefined behaviour.
+struct UncheckedBounds {
+  static constexpr bool enabled = false;
+};
+
+/// @brief Streaming bencode parser that reports values as events instead of
+/// building a tree. Malformed input throws std::runtime_error /
+/// std::out_of_range, the same as TorrentReader.
+/// Nesting is tracked on an explicit stack rather than by recursion, so
+/// hostile inputs such as "llll..." cannot overflow the call stack; pair it
+/// with ParseLimits to also bound memory and work.
+/// Instantiated for the combinations named below; see the policy types.
+template <typename Integers, typename Strings, typename Bounds>
+class BasicBencodeParser {
+public:
+  explicit BasicBencodeParser(std::string_view source,
+                              const ParseLimits &limits = {},
+                              Strings strings = {});
+
+  // Parse the subtree of one indexed container. Skipped containers (and
+  // skip() over a container) then jump straight to the recorded end offset
+  // instead of scanning their contents, and delimiters are looked up in the
+  // index's bitmap.
+  BasicBencodeParser(const StructuralIndex &index, size_t node,
+                     Strings strings = {});
+
+  // Parse one complete value starting at the current position. Returns false
+  // if the handler asked to stop, true once the value has been consumed.
+  bool parse(BencodeHandler &handler);
+
+  // Advance past one complete value without emitting any events. Limits
+  // still apply unless the value is a container jumped over via the index.
+  void skip();
+
+  // Offset of the next unread byte
+  size_t position() const;
+
+private:
+  std::string_view source_data;
+  size_t pos = 0;
+  // Optional structural index; next_container is the preorder number of the
+  // next container to be opened
+  const StructuralIndex *index = nullptr;
+  size_t next_container = 0;
+  ParseBudget budget;
+  Strings strings;
+
+  // Containers currently open, innermost last
+  struct Frame {
+    bool is_dict;
+  };
+  std::vector<Frame> frames;
+
+  // Parser methods; each returns false once the handler has asked to stop.
+  // run() consumes values until the stack is back down to stop_depth.
+  bool run(BencodeHandler &handler, size_t stop_depth);
+  bool parseValue(BencodeHandler &handler);
+  long long parseInt();
+  std::string_view parseString();
+  void skipContainer(char type, size_t node);
+  size_t find(char delimiter, size_t from) const;
+
+  char peek() const;
+  char consume();
+  bool match(char expected);
+  void expect(char expected);
+};
+
+// Validates everything; the default for files from anywhere
+using BencodeParser =
+    BasicBencodeParser<StrictIntegers, BorrowedStrings, CheckedBounds>;
+// Memory-safe, but tolerates non-canonical integers
+using LenientBencodeParser =
+    BasicBencodeParser<LenientIntegers, BorrowedStrings, CheckedBounds>;
+// Fastest: for documents already validated by one of the above
+using TrustedBencodeParser =
+    BasicBencodeParser<LenientIntegers, BorrowedStrings, UncheckedBounds>;
+// Fully validating, with strings that do not depend on the source
+using OwningBencodeParser =
+    BasicBencodeParser<StrictIntegers, OwnedStrings, CheckedBounds>;
+
+extern template class BasicBencodeParser<StrictIntegers, BorrowedStrings,
+                                         CheckedBounds>;
+extern template class BasicBencodeParser<LenientIntegers, BorrowedStrings,
+                                         CheckedBounds>;
+extern template class BasicBencodeParser<LenientIntegers, BorrowedStrings,
+                                         UncheckedBounds>;
+extern template class BasicBencodeParser<StrictIntegers, OwnedStrings,
+                                         CheckedBounds>;
+
+/// @brief Resumable bencode parser for input that arrives in pieces: pipes,
+/// stdin, sockets or a file that is still being written. Feed chunks of any
+/// size as they are read; the open container stack and any token cut off at
+/// a chunk boundary are kept until the next call. Emits the same events, and
+/// honours the same actions and limits, as BencodeParser.
+/// String and key views are only valid during the callback: they point into
+/// the caller's chunk, or into a carry-over buffer when a token straddles two
+/// chunks (see releaseCarry()). Handlers that keep them must copy the bytes
+/// unless the caller's chunks stay put. Strings whose events
+/// are muted (skipped values and the contents of skipped containers) are
+/// dropped as they arrive instead of being carried over.
+class BencodePushParser {
+public:
+  explicit BencodePushParser(BencodeHandler &handler,
+                             const ParseLimits &limits = {});
+
+  // Consume one chunk. Returns true once the top-level value is complete or
+  // the handler asked to stop; anything fed after that is ignored.
+  bool feed(std::string_view chunk);
+
+  // Signal end of input; throws std::out_of_range if the value is incomplete
+  void finish() const;
+
+  bool complete() const { return done; }
+  // True if the handler stopped the parse before the value was complete
+  bool stopped() const { return halted; }
+
+  // Bytes of input consumed so far, including the token being reported
+  // during a callback; once complete, the document length
+  size_t position() const { return offset; }
+
+  // Bytes held back for a token cut off at the end of the last chunk
+  size_t carried() const { return carry.size(); }
+  // Bytes that token needs before it can be retried, counted from its start
+  size_t pending() const { return carry.empty() ? 0 : need; }
+  // Forget the carried bytes; the next chunk must start with them again.
+  // A caller that keeps its input in storage that never moves can then hand
+  // the whole token over at once, so its views point into that storage and
+  // the parser never holds a second copy.
+  void releaseCarry() { carry.clear(); }
+
+private:
+  BencodeHandler &handler;
+  ParseBudget budget;
+  bool done = false;
+  bool halted = false;
+  size_t offset = 0;
+
+  // Bytes of an unfinished token, and how many it needs before retrying
+  std::string carry;
+  size_t need = 0;
+  // The string budget is charged once per string, from its length prefix
+  bool length_charged = false;
+  // Bytes still to come of a muted string that is being dropped
+  size_t discard = 0;
+
+  struct Frame {
+    bool is_dict;
+    bool expect_key;
+  };
+  std::vector<Frame> frames;
+  // Events are suppressed while frames.size() > mute_depth (a container
+  // being skipped); skip_value mutes the value after a skipped key
+  static constexpr size_t not_muted = std::numeric_limits<size_t>::max();
+  size_t mute_depth = not_muted;
+  bool skip_value = false;
+
+  // Consume one token from the front of `input`; returns its length, or 0
+  // (setting `need`) if the token continues past the end of the input
+  size_t step(std::string_view input);
+  // A silent string cut off at the end of the input is consumed whole, the
+  // rest of its bytes left in `discard`, and `value` is then not set
+  size_t stringToken(std::string_view input, std::string_view &value,
+                     bool silent);
+  void beginContainer(bool is_dict, bool silent);
+  void endContainer();
+  void valueDone();
+  void act(BencodeAction action);
+};
@@ -0,0 +1,170 @@
+#include "bencode_projection.h"
+
+#include <algorithm>
+#include <utility>
+
+struct ProjectionHandler::Node {
+  std::vector<std::pair<std::string, std::unique_ptr<Node>>> keys;
+  std::unique_ptr<Node> element; // "*"
+  bool requested = false;        // the whole value is wanted
+  bool done = false;             // the value has been seen in full
+
+  Node *key(std::string_view name) const {
+    for (const auto &[k, child] : keys) {
+      if (k == name)
+        return child.get();
+    }
+    return nullptr;
+  }
+
+  // Nothing requested below here can still turn up
+  bool complete() const {
+    if (done)
+      return true;
+    // A list may always have another element
+    if (requested || element || keys.empty())
+      return false;
+    return std::all_of(keys.begin(), keys.end(), [](const auto &entry) {
+      return entry.second->complete();
+    });
+  }
+};
+
+namespace {
+
+// Only the target's Stop is passed on
+BencodeAction passStop(BencodeAction action) {
+  return action == BencodeAction::Stop ? action : BencodeAction::Continue;
+}
+
+} // namespace
+
+ProjectionHandler::ProjectionHandler(const std::vector<KeyPath> &paths,
+                                     BencodeHandler &target)
+    : root(std::make_unique<Node>()), target(target), next(root.get()) {
+  for (const auto &path : paths) {
+    Node *node = root.get();
+    for (const auto &name : path) {
+      if (name == "*") {
+        if (!node->element)
+          node->element = std::make_unique<Node>();
+        node = node->element.get();
+      } else if (Node *child = node->key(name)) {
+        node = child;
+      } else {
+        node = node->keys.emplace_back(name, std::make_unique<Node>())
+                   .second.get();
+      }
+    }
+    node->requested = true;
+  }
+}
+
+ProjectionHandler::~ProjectionHandler() = default;
+
+bool ProjectionHandler::complete() const { return root->complete(); }
+
+ProjectionHandler::Node *ProjectionHandler::valueNode() {
+  if (open.empty() || open.back().is_dict)
+    return std::exchange(next, nullptr); // set by onKey, or the root
+  return open.back().node->element.get();
+}
+
+BencodeAction ProjectionHandler::valueDone(Node *node) {
+  node->done = true;
+  if (!root->complete())
+    return BencodeAction::Continue;
+  // Leave the target with a finished tree
+  while (!open.empty()) {
+    if (open.back().is_dict)
+      target.onDictEnd();
+    else
+      target.onListEnd();
+    open.pop_back();
+  }
+  return BencodeAction::Stop;
+}
+
+template <typename Forward>
+BencodeAction ProjectionHandler::scalar(Forward forward) {
+  if (inside > 0)
+    return passStop(forward());
+  Node *node = valueNode();
+  if (!node)
+    return BencodeAction::Continue;
+  // A scalar where a container was expected matches nothing
+  if (node->requested && forward() == BencodeAction::Stop)
+    return BencodeAction::Stop;
+  return valueDone(node);
+}
+
+template <typename Forward>
+BencodeAction ProjectionHandler::begin(bool is_dict, Forward forward) {
+  if (inside > 0) {
+    ++inside;
+    return passStop(forward());
+  }
+  Node *node = valueNode();
+  if (!node)
+    return BencodeAction::Skip;
+  if (node->requested) {
+    inside = 1;
+    inside_node = node;
+    return passStop(forward());
+  }
+  const bool matches = is_dict ? !node->keys.empty() : node->element != nullptr;
+  if (!matches) {
+    const auto action = valueDone(node);
+    return action == BencodeAction::Stop ? action : BencodeAction::Skip;
+  }
+  open.push_back({node, is_dict});
+  return passStop(forward());
+}
+
+template <typename Forward>
+BencodeAction ProjectionHandler::end(Forward forward) {
+  if (inside > 0) {
+    if (forward() == BencodeAction::Stop)
+      return BencodeAction::Stop;
+    return --inside > 0 ? BencodeAction::Continue : valueDone(inside_node);
+  }
+  Node *node = open.back().node;
+  open.pop_back();
+  if (forward() == BencodeAction::Stop)
+    return BencodeAction::Stop;
+  return valueDone(node);
+}
+
+BencodeAction ProjectionHandler::onInt(const long long value) {
+  return scalar([&] { return target.onInt(value); });
+}
+
+BencodeAction ProjectionHandler::onString(const std::string_view value) {
+  return scalar([&] { return target.onString(value); });
+}
+
+BencodeAction ProjectionHandler::onListBegin() {
+  return begin(false, [&] { return target.onListBegin(); });
+}
+
+BencodeAction ProjectionHandler::onListEnd() {
+  return end([&] { return target.onListEnd(); });
+}
+
+BencodeAction ProjectionHandler::onDictBegin() {
+  return begin(true, [&] { return target.onDictBegin(); });
+}
+
+BencodeAction ProjectionHandler::onKey(const std::string_view key) {
+  if (inside > 0)
+    return passStop(target.onKey(key));
+  Node *child = open.back().node->key(key);
+  if (!child)
+    return BencodeAction::Skip;
+  next = child;
+  return passStop(target.onKey(key));
+}
+
+BencodeAction ProjectionHandler::onDictEnd() {
+  return end([&] { return target.onDictEnd(); });
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "bencode_parser.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// A path of dictionary keys from the root, e.g. {"info", "piece length"}.
+// "*" stands for every element of a list: {"info", "files", "*", "length"}.
+using KeyPath = std::vector<std::string>;
+
+/// @brief BencodeHandler filter that forwards to `target` only the events of
+/// the requested paths and of the containers leading to them. Everything
+/// else is skipped by the parser, so it is never allocated or converted.
+/// Once every path has been seen in full the parse stops early, and the
+/// containers still open in `target` are closed so its result is complete.
+/// A path that runs into a value of the wrong type matches nothing. Only a
+/// Stop from `target` is honoured; its other actions are ignored.
+class ProjectionHandler : public BencodeHandler {
+public:
+  ProjectionHandler(const std::vector<KeyPath> &paths, BencodeHandler &target);
+  ~ProjectionHandler() override;
+
+  BencodeAction onInt(long long value) override;
+  BencodeAction onString(std::string_view value) override;
+  BencodeAction onListBegin() override;
+  BencodeAction onListEnd() override;
+  BencodeAction onDictBegin() override;
+  BencodeAction onKey(std::string_view key) override;
+  BencodeAction onDictEnd() override;
+
+  // True once every requested path has been seen in full
+  bool complete() const;
+
+private:
+  // Trie of the requested paths
+  struct Node;
+  std::unique_ptr<Node> root;
+  BencodeHandler &target;
+
+  // Projected containers currently open, innermost last
+  struct Frame {
+    Node *node;
+    bool is_dict;
+  };
+  std::vector<Frame> open;
+  // Trie node of the next dictionary value (or the root), set by onKey
+  Node *next = nullptr;
+  // Depth inside a requested subtree, which is forwarded whole
+  size_t inside = 0;
+  Node *inside_node = nullptr;
+
+  // Trie node for the value starting now; nullptr if it is not wanted
+  Node *valueNode();
+  // Record a finished value; Stop once nothing else is wanted
+  BencodeAction valueDone(Node *node);
+  template <typename Forward> BencodeAction scalar(Forward forward);
+  template <typename Forward> BencodeAction begin(bool is_dict, Forward forward);
+  template <typename Forward> BencodeAction end(Forward forward);
+};
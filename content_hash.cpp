@@ -0,0 +1,79 @@
+#include "content_hash.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t prime1 = 11400714785074694791ULL;
+constexpr uint64_t prime2 = 14029467366897019727ULL;
+constexpr uint64_t prime3 = 1609587929392839161ULL;
+constexpr uint64_t prime4 = 9650029242287828579ULL;
+constexpr uint64_t prime5 = 2870177450012600261ULL;
+
+uint64_t read64(const char *p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t read32(const char *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t round(uint64_t acc, uint64_t input) {
+  acc += input * prime2;
+  return std::rotl(acc, 31) * prime1;
+}
+
+uint64_t merge(uint64_t acc, uint64_t value) {
+  acc ^= round(0, value);
+  return acc * prime1 + prime4;
+}
+
+} // namespace
+
+uint64_t contentHash(std::string_view bytes, uint64_t seed) {
+  const char *p = bytes.data();
+  const char *end = p + bytes.size();
+  uint64_t hash;
+  if (bytes.size() >= 32) {
+    // Four independent lanes keep the multipliers busy
+    uint64_t v1 = seed + prime1 + prime2;
+    uint64_t v2 = seed + prime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - prime1;
+    for (; end - p >= 32; p += 32) {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+    }
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+           std::rotl(v4, 18);
+    hash = merge(merge(merge(merge(hash, v1), v2), v3), v4);
+  } else {
+    hash = seed + prime5;
+  }
+  hash += bytes.size();
+
+  for (; end - p >= 8; p += 8)
+    hash = std::rotl(hash ^ round(0, read64(p)), 27) * prime1 + prime4;
+  if (end - p >= 4) {
+    hash = std::rotl(hash ^ (read32(p) * prime1), 23) * prime2 + prime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= static_cast<unsigned char>(*p) * prime5;
+    hash = std::rotl(hash, 11) * prime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  hash *= prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// 64-bit XXH64 of `bytes`: a fast non-cryptographic hash, used to recognise
+// unchanged content and to seed hash tables
+uint64_t contentHash(std::string_view bytes, uint64_t seed = 0);
@@ -0,0 +1,77 @@
+#include "cpu_features.h"
+
+#ifdef TORRENT_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef TORRENT_X86
+
+void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+  int out[4];
+  __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i)
+    regs[i] = static_cast<unsigned>(out[i]);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0: which register states the OS saves on context switch
+unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  unsigned eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+CpuFeatures detect() {
+  CpuFeatures features;
+  unsigned regs[4];
+  cpuid(0, 0, regs);
+  const unsigned max_leaf = regs[0];
+
+  cpuid(1, 0, regs);
+  features.sse2 = (regs[3] >> 26) & 1;
+  const bool ssse3 = (regs[2] >> 9) & 1;
+  const bool sse41 = (regs[2] >> 19) & 1;
+  const bool osxsave = (regs[2] >> 27) & 1;
+  const bool avx = (regs[2] >> 28) & 1;
+  // AVX state (XMM + YMM) must be enabled by the OS as well, and for
+  // AVX-512 the opmask and upper ZMM state too
+  const unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+  const bool ymm_enabled = (xcr0 & 0x6) == 0x6;
+  const bool zmm_enabled = (xcr0 & 0xe6) == 0xe6;
+
+  if (max_leaf >= 7) {
+    cpuid(7, 0, regs);
+    features.avx2 = avx && ymm_enabled && ((regs[1] >> 5) & 1);
+    features.avx512 = zmm_enabled && ((regs[1] >> 16) & 1) && // F
+                      ((regs[1] >> 30) & 1);                  // BW
+    features.sha_ni = ssse3 && sse41 && ((regs[1] >> 29) & 1);
+  }
+  return features;
+}
+
+#else
+
+CpuFeatures detect() { return {}; }
+
+#endif
+
+} // namespace
+
+const CpuFeatures &CpuFeatures::get() {
+  static const CpuFeatures features = detect();
+  return features;
+}
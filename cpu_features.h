@@ -0,0 +1,29 @@
+#pragma once
+
+/// @brief Instruction-set extensions usable on this machine, detected once
+/// at startup via CPUID (and XGETBV for OS support of the wide registers).
+/// Everything reports false on non-x86 targets, where callers use their
+/// portable code paths.
+struct CpuFeatures {
+  bool sse2 = false;
+  bool avx2 = false;
+  // AVX-512 Foundation and Byte/Word, with ZMM state enabled
+  bool avx512 = false;
+  // SHA extensions, together with the SSSE3/SSE4.1 their kernels need
+  bool sha_ni = false;
+
+  static const CpuFeatures &get();
+};
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define TORRENT_X86 1
+#endif
+
+// Marks a function as compiled for an extension the rest of the build does
+// not assume; MSVC accepts the intrinsics without it.
+#if defined(TORRENT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TORRENT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TORRENT_TARGET(isa)
+#endif
@@ -7,18 +7,161 @@
 #include "file_browser.h"
 #include "help_page.h"
 #include "multi_viewer.h"
+#include "piece_hash_index.h"
+#include "piece_map.h"
+#include "piece_verifier.h"
+#include "torrent_creator.h"
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
 #include <memory>
+#include <span>
+#include <stdexcept>
 #include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 using namespace ftxui;
 
+/// @brief Metainfo plus piece/file and digest indices of one open torrent,
+/// each built the first time something needs it and kept for the life of
+/// the tab: the map when the tree expands its file list or pieces, or 'v'
+/// or --find-piece run; the digest indices only for the pieces and
+/// --find-piece.
+struct PieceLayout
+{
+  const TorrentReader *reader = nullptr;
+  std::unique_ptr<TorrentMetainfo> meta;
+  std::unique_ptr<PieceMap> map;
+  std::unique_ptr<PieceHashIndex> hashes;
+  std::unique_ptr<PieceHashIndex> v2_hashes;
+  // Why meta is missing, if it is
+  std::string error;
+  bool tried = false;
+  bool hashes_tried = false;
+  bool v2_hashes_tried = false;
+
+  // nullptr unless the document is a torrent with v1 pieces
+  const PieceMap *Map()
+  {
+    if (!tried)
+    {
+      tried = true;
+      try
+      {
+        meta = std::make_unique<TorrentMetainfo>(*reader);
+        if (meta->pieceCount() > 0)
+          map = std::make_unique<PieceMap>(*meta);
+      }
+      catch (const std::exception &e)
+      {
+        meta.reset();
+        map.reset();
+        error = e.what();
+      }
+    }
+    return map.get();
+  }
+
+  // nullptr if the document is not a torrent; error then says why
+  const TorrentMetainfo *Meta()
+  {
+    Map();
+    return meta.get();
+  }
+
+  // nullptr unless Map() is; the digests are borrowed from the reader
+  const PieceHashIndex *Hashes()
+  {
+    if (!hashes_tried && Map())
+    {
+      hashes_tried = true;
+      try
+      {
+        hashes = std::make_unique<PieceHashIndex>(PieceHashIndex::v1(*meta));
+      }
+      catch (const std::exception &)
+      {
+        hashes.reset();
+      }
+    }
+    return hashes.get();
+  }
+
+  // Index of the v2 piece hashes; nullptr if the document is not a torrent
+  const PieceHashIndex *V2Hashes()
+  {
+    if (!v2_hashes_tried && Meta())
+    {
+      v2_hashes_tried = true;
+      try
+      {
+        v2_hashes =
+            std::make_unique<PieceHashIndex>(PieceHashIndex::v2(*meta));
+      }
+      catch (const std::exception &)
+      {
+        v2_hashes.reset();
+      }
+    }
+    return v2_hashes.get();
+  }
+
+  // By address, so telling the info dictionary apart builds nothing
+  bool IsInfo(const TorrentValue &value) const
+  {
+    const TorrentValue &root = reader->getRoot();
+    if (!root.isDict())
+      return false;
+    const auto info = root.asDict().find("info");
+    return info != root.asDict().end() && &info->second == &value;
+  }
+};
+
+// "dir/name" from a file's path components, v1 or v2
+std::string FilePath(std::span<const std::string_view> parts)
+{
+  std::string path;
+  for (const auto part : parts)
+    path += (path.empty() ? "" : "/") + std::string(part);
+  return path;
+}
+
+// "pieces 3-7" / "piece 3" / "no pieces"
+std::string PieceSpanLabel(const PieceMap::Span &span)
+{
+  if (span.empty())
+    return "no pieces";
+  if (span.size() == 1)
+    return "piece " + std::to_string(span.first);
+  return "pieces " + std::to_string(span.first) + "-" +
+         std::to_string(span.last - 1);
+}
+
+// The files a piece covers: the first one's path, and how many follow
+std::string FileSpanLabel(const PieceLayout &layout, const PieceMap::Span &span)
+{
+  std::string label = FilePath(layout.meta->files()[span.first].path);
+  if (span.size() > 1)
+    label += " +" + std::to_string(span.size() - 1) + " more";
+  return label;
+}
+
 /// Functions Unimplemented, From, FromList, FromDict, FromString, etc are
 /// heavily borrowed from json tui.
 Component Unimplemented() {
   return Renderer([] { return text("Unimplemented"); });
 }
+Component Broken(const std::string &message) {
+  return Renderer([message] { return text(message) | color(Color::Red); });
+}
 Component FakeHorizontal(const Component &a, const Component &b) {
   const auto c = Container::Vertical({a, b});
   c->SetActiveChild(b);
@@ -35,11 +178,11 @@ Component FakeHorizontal(const Component &a, const Component &b) {
  * beautifully for JSON tho
  */
 Component From(const TorrentValue &val, const bool is_last, const int depth,
-               TorrentExpander &expander) {
+               TorrentExpander &expander, PieceLayout *layout) {
   if (val.isDict()) {
-    return FromDict(Empty(), val, is_last, depth, expander);
+    return FromDict(Empty(), val, is_last, depth, expander, layout);
   } else if (val.isList()) {
-    return FromList(Empty(), val.asList(), is_last, depth, expander);
+    return FromList(Empty(), val, is_last, depth, expander);
   } else if (val.isInt()) {
     return FromNumber(val, is_last);
   } else if (val.isString()) {
@@ -52,40 +195,78 @@ Component From(const TorrentValue &val, const bool is_last, const int depth,
 /**
  * @brief Create a list view component
  */
-Component FromList(const Component &prefix, const TorrentList &list,
-                   bool is_last, int depth, TorrentExpander &expander) {
+Component FromList(const Component &prefix, const TorrentValue &list,
+                   bool is_last, int depth, TorrentExpander &expander,
+                   PieceLayout *file_pieces) {
   class Impl : public ComponentExpandable {
   public:
-    Impl(const Component &prefix, const TorrentList &list, const bool is_last,
-         const int depth, TorrentExpander &expander)
+    Impl(const Component &prefix, const TorrentValue &list, const bool is_last,
+         const int depth, TorrentExpander &expander, PieceLayout *file_pieces)
         : ComponentExpandable(expander), prefix_(prefix), tlist_(list),
-          is_last_(is_last), depth_(depth) {
+          file_pieces_(file_pieces), is_last_(is_last), depth_(depth) {
       Expanded() = (depth <= 0);
-      const auto children = Container::Vertical({});
+      items_ = Container::Vertical({});
+
+      const auto toggle = TorrentToggle("▼", is_last ? "▶" : "▶,", &Expanded());
+      auto upper = Container::Horizontal({FakeHorizontal(prefix_, toggle)});
+      Add(Container::Vertical({upper, Maybe(items_, &Expanded())}));
+    };
+
+    // The list is only parsed and its children only built once it is
+    // first expanded
+    Element OnRender() override {
+      if (Expanded() && !populated_)
+        Populate();
+      return ComponentExpandable::OnRender();
+    }
+
+    void Populate() {
+      populated_ = true;
+      // Only a damaged cache snapshot lets a lazy list fail to parse
+      const TorrentList *parsed = nullptr;
+      try {
+        parsed = &tlist_.asList();
+      } catch (const std::exception &e) {
+        items_->Add(Indentation(Broken(e.what())));
+        return;
+      }
+      const auto &list = *parsed;
+      const PieceMap *map = file_pieces_ ? file_pieces_->Map() : nullptr;
+      child_expanders_.reserve(list.size());
       int size = static_cast<int>(list.size());
+      size_t index = 0;
       for (auto &t : list) {
         const bool is_children_last = --size == 0;
-        auto child_expander = expander_->Child();
-        children->Add(
-            Indentation(From(t, is_children_last, depth + 1, child_expander)));
+        child_expanders_.push_back(expander_->Child());
+        if (map && t.isDict() && index < map->fileCount()) {
+          // A file entry, labelled with the pieces holding its bytes
+          const std::string label =
+              "[" + PieceSpanLabel(map->piecesOf(index)) + "] ";
+          const auto pieces = Renderer(
+              [label] { return text(label) | color(Color::GrayLight); });
+          items_->Add(Indentation(FromDict(pieces, t, is_children_last,
+                                           depth_ + 1,
+                                           child_expanders_.back())));
+        } else {
+          items_->Add(Indentation(From(t, is_children_last, depth_ + 1,
+                                       child_expanders_.back())));
+        }
+        ++index;
       }
       // TODO: These aren't needed since we're not pretending like it's JSON
-      if (is_last) {
-        children->Add(Renderer([] { return text(" "); }));
-      } else {
-        children->Add(Renderer([] { return text(" "); }));
-      }
+      items_->Add(Renderer([] { return text(" "); }));
+    }
 
-      const auto toggle = TorrentToggle("▼", is_last ? "▶" : "▶,", &Expanded());
-      auto upper = Container::Horizontal({FakeHorizontal(prefix_, toggle)});
-      Add(Container::Vertical({upper, Maybe(children, &Expanded())}));
-    };
     Component prefix_;
-    const TorrentList &tlist_;
+    Component items_;
+    const TorrentValue &tlist_;
+    PieceLayout *file_pieces_;
+    std::vector<TorrentExpander> child_expanders_;
     bool is_last_;
     int depth_;
+    bool populated_ = false;
   };
-  return Make<Impl>(prefix, list, is_last, depth, expander);
+  return Make<Impl>(prefix, list, is_last, depth, expander, file_pieces);
 }
 /**
  *
@@ -109,37 +290,163 @@ Component Basic(const std::string &value, Color c, bool is_last) {
  * @brief Create a dictionary view component
  */
 Component FromDict(const Component &prefix, const TorrentValue &val,
-                   bool is_last, int depth, TorrentExpander &expander) {
+                   bool is_last, int depth, TorrentExpander &expander,
+                   PieceLayout *layout) {
 
   class Impl : public ComponentExpandable {
   public:
     Impl(const Component &prefix, const TorrentValue &dict, const bool is_last,
-         const int depth, TorrentExpander &expander)
-        : ComponentExpandable(expander) {
+         const int depth, TorrentExpander &expander, PieceLayout *layout)
+        : ComponentExpandable(expander), dict_(dict), layout_(layout),
+          depth_(depth) {
       Expanded() = (depth < 2);
       // Auto-expand first 2 levels
-      const Component children = Container::Vertical({});
-      int size = static_cast<int>(dict.asDict().size());
+      items_ = Container::Vertical({});
+      const auto toggle = TorrentToggle("▼", is_last ? "▶" : "▶", &Expanded());
+      Add(Container::Vertical(
+          {FakeHorizontal(prefix, toggle), Maybe(items_, &Expanded())}));
+    };
+
+    // Collapsed dictionaries are neither parsed nor turned into components
+    // until they are first expanded
+    Element OnRender() override {
+      if (Expanded() && !populated_)
+        Populate();
+      return ComponentExpandable::OnRender();
+    }
 
-      for (const auto &[key, value] : dict.asDict()) {
+    void Populate() {
+      populated_ = true;
+      const TorrentDict *parsed = nullptr;
+      try {
+        parsed = &dict_.asDict();
+      } catch (const std::exception &e) {
+        items_->Add(Indentation(Broken(e.what())));
+        return;
+      }
+      const auto &dict = *parsed;
+      child_expanders_.reserve(dict.size());
+      int size = static_cast<int>(dict.size());
+
+      for (const auto &[key, value] : dict) {
         bool is_children_last = --size == 0;
         const auto newPrefix = Renderer([key, is_children_last]() {
-          auto element = text(key + ": ") | color(Color::Yellow);
+          auto element = text(std::string(key) + ": ") | color(Color::Yellow);
 
           return element;
         });
-        children->Add(newPrefix);
-        auto child_expander = expander_->Child();
-        children->Add(Indentation(
-            From(value, is_children_last, depth + 1, child_expander)));
+        items_->Add(newPrefix);
+        child_expanders_.push_back(expander_->Child());
+        items_->Add(Indentation(Child(key.str(), value, is_children_last)));
       }
-      const auto toggle = TorrentToggle("▼", is_last ? "▶" : "▶", &Expanded());
+    }
+
+    // The info dictionary's files and pieces are annotated from the
+    // layout, which they build once expanded; it is looked for right below
+    // the root only
+    Component Child(std::string_view key, const TorrentValue &value,
+                    bool is_last) {
+      TorrentExpander &expander = child_expanders_.back();
+      if (layout_ && depth_ == 0)
+        return From(value, is_last, depth_ + 1, expander, layout_);
+      if (layout_ && depth_ == 1 && (key == "files" || key == "pieces") &&
+          layout_->IsInfo(dict_)) {
+        if (key == "pieces" && value.isString())
+          return FromPieces(value, is_last, expander, *layout_);
+        if (key == "files" && value.isList())
+          return FromList(Empty(), value, is_last, depth_ + 1, expander,
+                          layout_);
+      }
+      return From(value, is_last, depth_ + 1, expander);
+    }
+
+    Component items_;
+    const TorrentValue &dict_;
+    PieceLayout *layout_;
+    std::vector<TorrentExpander> child_expanders_;
+    int depth_;
+    bool populated_ = false;
+  };
+  return Make<Impl>(prefix, val, is_last, depth, expander, layout);
+}
+// Rows built for info.pieces; torrents with more pieces list the first ones
+constexpr size_t max_piece_rows = 10000;
+
+Component FromPieces(const TorrentValue &val, const bool is_last,
+                     TorrentExpander &expander, PieceLayout &layout) {
+  class Impl : public ComponentExpandable {
+  public:
+    Impl(const TorrentValue &val, const bool is_last,
+         TorrentExpander &expander, PieceLayout &layout)
+        : ComponentExpandable(expander), layout_(layout),
+          summary_(formatValuePreview(val)) {
+      items_ = Container::Vertical({});
+      const auto toggle = TorrentToggle("▼", is_last ? "▶" : "▶,", &Expanded());
+      const auto header = Renderer(
+          [this] { return text(summary_ + " ") | color(Color::Green); });
       Add(Container::Vertical(
-          {FakeHorizontal(prefix, toggle), Maybe(children, &Expanded())}));
-    };
+          {FakeHorizontal(header, toggle), Maybe(items_, &Expanded())}));
+    }
+
+    Element OnRender() override {
+      if (Expanded() && !populated_)
+        Populate();
+      return ComponentExpandable::OnRender();
+    }
+
+    // One row per piece: number, SHA-1 and the files it spans, noting
+    // digests that are all zero or repeat an earlier piece's. The header
+    // gains the piece counts once the layout is built here.
+    void Populate() {
+      populated_ = true;
+      if (!layout_.Hashes()) {
+        items_->Add(Indentation(Renderer([] {
+          return text("no piece layout") | color(Color::GrayLight);
+        })));
+        return;
+      }
+      const TorrentMetainfo &meta = *layout_.meta;
+      const PieceMap &map = *layout_.map;
+      const PieceHashIndex &hashes = *layout_.Hashes();
+      size_t repeated = 0;
+      for (const auto &group : hashes.duplicates())
+        repeated += group.size() - 1;
+      summary_ += ", " + std::to_string(hashes.size()) + " pieces";
+      if (repeated > 0)
+        summary_ += ", " + std::to_string(repeated) + " repeated";
+      if (!hashes.zeroPieces().empty())
+        summary_ += ", " + std::to_string(hashes.zeroPieces().size()) +
+                    " all-zero";
+      const size_t rows = std::min(meta.pieceCount(), max_piece_rows);
+      for (size_t piece = 0; piece < rows; ++piece) {
+        std::string row = "#" + std::to_string(piece) + " " +
+                          toHex(meta.piece(piece));
+        if (piece < map.pieceCount())
+          row += "  " + FileSpanLabel(layout_, map.filesOf(piece));
+        const size_t first = hashes.find(meta.piece(piece));
+        if (first != piece)
+          row += "  (same as #" + std::to_string(first) + ")";
+        else if (std::ranges::all_of(meta.piece(piece),
+                                     [](unsigned char b) { return b == 0; }))
+          row += "  (all zero)";
+        items_->Add(Indentation(Basic(row, Color::Green, piece + 1 == rows)));
+      }
+      if (meta.pieceCount() > rows) {
+        const std::string more =
+            "... " + std::to_string(meta.pieceCount() - rows) + " more";
+        items_->Add(Indentation(
+            Renderer([more] { return text(more) | color(Color::GrayLight); })));
+      }
+    }
+
+    Component items_;
+    PieceLayout &layout_;
+    std::string summary_;
+    bool populated_ = false;
   };
-  return Make<Impl>(prefix, val, is_last, depth, expander);
+  return Make<Impl>(val, is_last, expander, layout);
 }
+
 Component FromString(const TorrentValue &val, const bool is_last) {
   return Basic(formatValuePreview(val), Color::Green, is_last);
 }
@@ -214,7 +521,7 @@ Component MakeFileBrowserModal(FileBrowser &fb, int *cursor, bool *shown,
     }
     for (int i = 0; i < static_cast<int>(entries.size()); ++i) {
       const auto &e = entries[i];
-      std::string icon = e.is_directory ? "📁 " : "📄 ";
+      std::string icon = e.is_archive ? "📦 " : e.is_directory ? "📁 " : "📄 ";
       std::string sel_mark = (!e.is_directory && fb.IsSelected(e.full_path)) ? "[x] " : "[ ] ";
       if (e.is_directory) sel_mark = "    ";
       bool is_cursor = (i == *cursor);
@@ -301,16 +608,158 @@ Element RenderTabBar(const MultiViewer &mv)
   return hbox(tabs) | center;
 }
 
+// ---------------------------------------------------------------------------
+// Stdin helpers
+// ---------------------------------------------------------------------------
+static bool StdinIsTerminal()
+{
+#ifdef _WIN32
+  return _isatty(_fileno(stdin));
+#else
+  return isatty(fileno(stdin));
+#endif
+}
+
+static bool ReopenStdinFromTerminal()
+{
+#ifdef _WIN32
+  return freopen("CONIN$", "r", stdin) != nullptr;
+#else
+  return freopen("/dev/tty", "r", stdin) != nullptr;
+#endif
+}
+
 // ---------------------------------------------------------------------------
 // Main
 // ---------------------------------------------------------------------------
 struct TorrentTab
 {
   std::unique_ptr<TorrentReader> reader;
+  // Shared by the tree and the verify panel; built on first use
+  PieceLayout layout;
   TorrentExpander expander;
   Component component;
+  // Piece check started with 'v'; hashing runs on its own worker pool
+  std::unique_ptr<PieceVerifier> verifier;
+  std::string verify_error;
 };
 
+// One-line summary of a piece check, plus the first failed pieces and,
+// for v1 checks, the files they span
+Element RenderVerifyPanel(TorrentTab &tab)
+{
+  if (!tab.verify_error.empty())
+    return text(" Verify: " + tab.verify_error) | color(Color::Red);
+  const auto progress = tab.verifier->progress();
+  const float done = static_cast<float>(progress.checked()) / progress.pieces;
+  std::string status = " " + std::to_string(progress.checked()) + "/" +
+                       std::to_string(progress.pieces) + " pieces, " +
+                       std::to_string(progress.good) + " good, " +
+                       std::to_string(progress.bad) + " bad, " +
+                       std::to_string(progress.missing) + " missing";
+  if (progress.unreadable > 0)
+    status += ", " + std::to_string(progress.unreadable) + " unreadable";
+  status += " ";
+  Elements rows;
+  rows.push_back(hbox({
+      text(std::string(progress.finished ? " Verified" : " Verifying") +
+           (tab.verifier->scheme() == PieceScheme::V2 ? " (v2) " : " (v1) ")),
+      gauge(done) | flex | color(progress.bad > 0 ? Color::Red : Color::Green),
+      text(status),
+  }));
+  if (progress.bad + progress.missing + progress.unreadable > 0)
+  {
+    std::string failed = " Failed pieces:";
+    const auto pieces = tab.verifier->failedPieces();
+    for (const size_t piece : pieces)
+      failed += " " + std::to_string(piece);
+    if (progress.bad + progress.missing + progress.unreadable > pieces.size())
+      failed += " ...";
+    rows.push_back(text(failed) | color(Color::Red));
+    const PieceMap *map = tab.layout.Map();
+    if (map && tab.verifier->scheme() == PieceScheme::V1)
+    {
+      for (size_t i = 0;
+           i < pieces.size() && i < 4 && pieces[i] < map->pieceCount(); ++i)
+        rows.push_back(text("   #" + std::to_string(pieces[i]) + " in " +
+                            FileSpanLabel(tab.layout, map->filesOf(pieces[i]))) |
+                       color(Color::Red));
+    }
+  }
+  return vbox(rows);
+}
+
+// --find-piece: look `hex` up in every loaded torrent's v1 pieces (20
+// bytes) or v2 piece layers (32 bytes) and print where it is
+int FindPiece(const std::string &hex,
+              const std::vector<std::unique_ptr<TorrentTab>> &tabs,
+              const MultiViewer &multi)
+{
+  const auto digest = fromHex(hex);
+  if (!digest || (digest->size() != TorrentMetainfo::digest_size &&
+                  digest->size() != TorrentMetainfo::v2_digest_size))
+  {
+    std::cerr << "--find-piece takes a 40 (SHA-1) or 64 (SHA-256) digit hex "
+                 "digest\n";
+    return 1;
+  }
+  bool found = false;
+  for (size_t i = 0; i < tabs.size(); ++i)
+  {
+    const std::string path = multi.PathAt(static_cast<int>(i));
+    try
+    {
+      // Reuses the tab's metainfo and indices, as the tree and 'v' do
+      PieceLayout &layout = tabs[i]->layout;
+      const TorrentMetainfo *cached = layout.Meta();
+      if (!cached)
+        throw std::runtime_error(layout.error);
+      const TorrentMetainfo &meta = *cached;
+      std::string where;
+      if (digest->size() == TorrentMetainfo::digest_size)
+      {
+        const PieceHashIndex *index = layout.Hashes();
+        const size_t piece =
+            index ? index->find(*digest) : PieceHashIndex::npos;
+        if (piece != PieceHashIndex::npos)
+        {
+          const PieceMap &map = *layout.map;
+          where = "piece " + std::to_string(piece);
+          if (piece < map.pieceCount())
+          {
+            const auto span = map.filesOf(piece);
+            for (size_t f = span.first; f < span.last; ++f)
+              where += (f == span.first ? " in " : ", ") +
+                       FilePath(meta.files()[f].path);
+          }
+        }
+      }
+      else
+      {
+        const PieceHashIndex *index = layout.V2Hashes();
+        const size_t piece =
+            index ? index->find(*digest) : PieceHashIndex::npos;
+        if (piece != PieceHashIndex::npos)
+        {
+          const auto at = index->filePiece(piece);
+          where = "v2 piece " + std::to_string(piece) + " (piece " +
+                  std::to_string(at.piece) + " of " +
+                  FilePath(meta.fileTree()[at.file].path) + ")";
+        }
+      }
+      if (!where.empty())
+        found = true;
+      std::cout << path << ": " << (where.empty() ? "not found" : where)
+                << '\n';
+    }
+    catch (const std::exception &e)
+    {
+      std::cout << path << ": " << e.what() << '\n';
+    }
+  }
+  return found ? 0 : 1;
+}
+
 int main(int argc, const char **argv)
 {
   // -- State --
@@ -320,34 +769,130 @@ int main(int argc, const char **argv)
   bool browser_shown = false;
   int browser_cursor = 0;
   std::string start_dir = ".";
+  // --cache-dir DIR: keep index snapshots there so large torrents reopen
+  // without being scanned again
+  std::string cache_dir;
+  // --data-dir DIR: where 'v' looks for downloaded data; defaults to the
+  // directory holding the torrent
+  std::string data_dir;
 
   // Helper: load a torrent into a new tab
   auto load_torrent = [&](const std::string &path) -> bool
   {
-    try
+    auto tab = std::make_unique<TorrentTab>();
+    // Lazy: only the levels the tree view expands get parsed. Files may
+    // come from anywhere, so bound nesting, values and string bytes to well
+    // above what real torrents use: a million-file torrent has under ten
+    // million values, and 256 MiB holds the pieces of a 3 TiB one.
+    TorrentReaderOptions options;
+    options.lazy = true;
+    options.arena = true;
+    options.limits.max_depth = 256;
+    options.limits.max_nodes = size_t{1} << 24;
+    options.limits.max_string_bytes = size_t{256} << 20;
+    options.cache_dir = cache_dir;
+    if (path == "-")
     {
-      auto tab = std::make_unique<TorrentTab>();
-      tab->reader = std::make_unique<TorrentReader>(path);
-      if (!tab->reader->isValidTorrent())
+      // Streams still report problems by throwing
+      try
+      {
+        tab->reader = std::make_unique<TorrentReader>(std::cin, options);
+      }
+      catch (const std::exception &)
+      {
         return false;
-      tab->expander = TorrentExpanderImpl::Root();
-      tab->component = From(tab->reader->getRoot(), true, 0, tab->expander);
-      tabs.push_back(std::move(tab));
-      multi.Add(path);
-      return true;
+      }
     }
-    catch (...)
+    else
     {
-      return false;
+      // Broken files are common when opening many; no unwinding for them
+      auto parsed = TorrentReader::parse(path, options);
+      if (!parsed)
+        return false;
+      tab->reader = std::make_unique<TorrentReader>(std::move(*parsed));
     }
+    if (!tab->reader->isValidTorrent())
+      return false;
+    tab->layout.reader = tab->reader.get();
+    tab->expander = TorrentExpanderImpl::Root();
+    tab->component = From(tab->reader->getRoot(), true, 0, tab->expander,
+                          &tab->layout);
+    tabs.push_back(std::move(tab));
+    multi.Add(path == "-" ? "<stdin>" : path);
+    return true;
   };
 
-  // Load files from command-line arguments
+  // Load files from command-line arguments; "-" (or no arguments with
+  // piped input) reads a torrent from stdin while it is still arriving.
+  // --create PATH builds a torrent from a file or directory first (see
+  // --output, --hybrid, --announce) and opens it in a tab.
+  // --find-piece HASH prints which piece (and file) of each torrent has
+  // that SHA-1 (v1) or SHA-256 (v2 piece layer) digest, then exits
+  std::vector<std::string> files;
+  std::string create_source, create_output, find_piece;
+  TorrentCreateOptions create_options;
   for (int i = 1; i < argc; ++i)
   {
-    load_torrent(argv[i]);
+    const std::string arg = argv[i];
+    if (arg == "--cache-dir" && i + 1 < argc)
+      cache_dir = argv[++i];
+    else if (arg == "--data-dir" && i + 1 < argc)
+      data_dir = argv[++i];
+    else if (arg == "--create" && i + 1 < argc)
+      create_source = argv[++i];
+    else if (arg == "--output" && i + 1 < argc)
+      create_output = argv[++i];
+    else if (arg == "--announce" && i + 1 < argc)
+      create_options.announce = argv[++i];
+    else if (arg == "--hybrid")
+      create_options.hybrid = true;
+    else if (arg == "--find-piece" && i + 1 < argc)
+      find_piece = argv[++i];
+    else
+      files.push_back(arg);
+  }
+  if (!create_source.empty())
+  {
+    try
+    {
+      const std::string torrent = createTorrent(create_source, create_options);
+      if (create_output.empty())
+      {
+        create_output = creationBase(create_source).filename().string() + ".torrent";
+      }
+      std::ofstream out(create_output, std::ios::binary);
+      if (!out.write(torrent.data(), static_cast<std::streamsize>(torrent.size())))
+        throw std::runtime_error("Cannot write " + create_output);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << e.what() << '\n';
+      return 1;
+    }
+    // Data sits where it was created from, so 'v' checks against that
+    if (data_dir.empty())
+      data_dir = creationDataRoot(create_source).string();
+    files.push_back(create_output);
+  }
+  bool read_stdin = files.empty() && !StdinIsTerminal();
+  for (const auto &file : files)
+  {
+    if (file == "-")
+      read_stdin = true;
+    else
+      load_torrent(file);
+  }
+  if (read_stdin)
+  {
+    load_torrent("-");
+    // The UI reads keys from stdin, so point it back at the terminal
+    if (find_piece.empty() && !ReopenStdinFromTerminal())
+      return 1;
   }
 
+  if (!find_piece.empty())
+    return FindPiece(find_piece, tabs, multi);
+
   // If nothing was loaded, show the browser immediately
   if (tabs.empty())
   {
@@ -389,12 +934,28 @@ int main(int argc, const char **argv)
     if (multi.Count() > 0) {
       std::string title = "Torrent Viewer: " + multi.PathAt(multi.ActiveIndex());
       layout.push_back(text(title) | bold | center | color(Color::Cyan));
+      int idx = multi.ActiveIndex();
+      if (idx >= 0 && idx < static_cast<int>(tabs.size()) && tabs[idx]->reader) {
+        const auto &hashes = tabs[idx]->reader->infoHashes();
+        if (hashes.v1)
+          layout.push_back(text("Info-hash v1: " + toHex(*hashes.v1)) | center | color(Color::GrayLight));
+        if (hashes.v2)
+          layout.push_back(text("Info-hash v2: " + toHex(*hashes.v2)) | center | color(Color::GrayLight));
+      }
     } else {
       layout.push_back(text("Torrent Viewer") | bold | center | color(Color::Cyan));
     }
     layout.push_back(separator());
     layout.push_back(text("Press ? for help") | italic | center | color(Color::GrayLight));
     layout.push_back(active_viewer_interactive->Render());
+    if (multi.Count() > 0) {
+      int idx = multi.ActiveIndex();
+      if (idx >= 0 && idx < static_cast<int>(tabs.size()) &&
+          (tabs[idx]->verifier || !tabs[idx]->verify_error.empty())) {
+        layout.push_back(separator());
+        layout.push_back(RenderVerifyPanel(*tabs[idx]));
+      }
+    }
     return vbox(layout) | border | center | bgcolor(Color::Grey23); });
 
   auto screen = ScreenInteractive::Fullscreen();
@@ -427,6 +988,36 @@ int main(int argc, const char **argv)
       return true;
     }
 
+    // 'v' checks the active torrent's pieces against local data, in the
+    // background; the panel redraws as batches finish
+    if (event == Event::Character('v') && !help_shown && !browser_shown &&
+        !tabs.empty()) {
+      int idx = multi.ActiveIndex();
+      if (idx < 0 || idx >= static_cast<int>(tabs.size())) return false;
+      auto &tab = *tabs[idx];
+      tab.verifier.reset();
+      tab.verify_error.clear();
+      std::filesystem::path root = data_dir;
+      if (root.empty())
+        root = std::filesystem::path(multi.PathAt(idx)).parent_path();
+      try {
+        // v2 and hybrid torrents are checked per file against their
+        // piece layers. The metainfo is the tab's, parsed at most once.
+        const TorrentMetainfo *cached = tab.layout.Meta();
+        if (!cached)
+          throw std::runtime_error(tab.layout.error);
+        const TorrentMetainfo &meta = *cached;
+        tab.verifier = std::make_unique<PieceVerifier>(
+            meta, root.empty() ? "." : root, 0,
+            PieceVerifier::preferredScheme(meta));
+        tab.verifier->start([&screen] { screen.PostEvent(Event::Custom); });
+      } catch (const std::exception &e) {
+        tab.verifier.reset();
+        tab.verify_error = e.what();
+      }
+      return true;
+    }
+
     // Tab navigation: Tab / l = next, Shift-Tab / h = prev
     if (!help_shown && !browser_shown && multi.Count() > 1) {
       if (event == Event::Tab || event == Event::Character('l')) {
@@ -488,6 +1079,9 @@ int main(int argc, const char **argv)
   wrapped_component |= Modal(file_browser_component, &browser_shown);
   wrapped_component |= Modal(help_component, &help_shown);
   screen.Loop(wrapped_component);
+  // Stop verification before the screen its updates are posted to is gone
+  for (auto &tab : tabs)
+    tab->verifier.reset();
 
   return EXIT_SUCCESS;
 }
@@ -1,4 +1,5 @@
 #include "file_browser.h"
+#include "torrent_archive.h"
 #include <algorithm>
 
 FileBrowser::FileBrowser(const std::string &start_dir)
@@ -10,6 +11,11 @@ void FileBrowser::Refresh() { BuildListing(); }
 
 void FileBrowser::BuildListing() {
   entries_.clear();
+  std::string archive, member;
+  if (splitArchivePath(current_dir_, archive, member)) {
+    BuildArchiveListing(archive);
+    return;
+  }
   if (!fs::exists(current_dir_) || !fs::is_directory(current_dir_))
     return;
 
@@ -26,30 +32,60 @@ void FileBrowser::BuildListing() {
       fe.is_directory = true;
       entries_.push_back(fe);
     } else if (entry.is_regular_file()) {
-      // Only show .torrent files
-      auto ext = entry.path().extension().string();
-      std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-      if (ext == ".torrent") {
+      // Only show torrent files (possibly compressed) and tar bundles
+      if (isTorrentName(fe.name)) {
         fe.is_directory = false;
         entries_.push_back(fe);
+      } else if (isArchiveName(fe.name)) {
+        fe.is_directory = true;
+        fe.is_archive = true;
+        entries_.push_back(fe);
       }
     }
   }
   std::sort(entries_.begin(), entries_.end());
 }
 
+void FileBrowser::BuildArchiveListing(const std::string &archive) {
+  std::vector<ArchiveMember> members;
+  try {
+    members = listArchive(archive);
+  } catch (const std::exception &) {
+    return; // unreadable or corrupt: show it as empty
+  }
+  // Members keep their paths inside the archive as names
+  for (const auto &member : members) {
+    if (!isTorrentName(member.name))
+      continue;
+    FileEntry fe;
+    fe.name = member.name;
+    fe.full_path = archiveMemberPath(archive, member.name);
+    fe.is_directory = false;
+    entries_.push_back(fe);
+  }
+  std::sort(entries_.begin(), entries_.end());
+}
+
 bool FileBrowser::Enter(int index) {
   if (index < 0 || index >= static_cast<int>(entries_.size()))
     return false;
   const auto &entry = entries_[index];
   if (!entry.is_directory)
     return false;
-  current_dir_ = entry.full_path;
+  current_dir_ = entry.is_archive ? archiveMemberPath(entry.full_path, "")
+                                  : entry.full_path;
   BuildListing();
   return true;
 }
 
 bool FileBrowser::GoUp() {
+  std::string archive, member;
+  if (splitArchivePath(current_dir_, archive, member)) {
+    // Leave the archive for the directory holding it
+    current_dir_ = fs::path(archive).parent_path().string();
+    BuildListing();
+    return true;
+  }
   fs::path parent = fs::path(current_dir_).parent_path();
   if (parent == current_dir_)
     return false; // already at root
@@ -105,7 +141,9 @@ bool FileBrowser::IsSelected(const std::string &path) const {
 std::vector<std::string> FileBrowser::SelectedPaths() const {
   std::vector<std::string> paths;
   for (const auto &p : selected_) {
-    if (fs::exists(p)) {
+    // Archive members exist as long as their archive does
+    std::string archive, member;
+    if (fs::exists(splitArchivePath(p, archive, member) ? archive : p)) {
       paths.push_back(p);
     }
   }
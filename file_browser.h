@@ -13,6 +13,8 @@ struct FileEntry {
   std::string name;
   std::string full_path;
   bool is_directory;
+  // A tar bundle: entered like a directory, listing its torrent members
+  bool is_archive = false;
 
   bool operator<(const FileEntry &other) const {
     // Directories first, then alphabetical
@@ -24,6 +26,9 @@ struct FileEntry {
 
 /// @brief Logic for browsing the filesystem and selecting torrent files.
 /// Separates file system logic from the UI so it can be unit-tested.
+/// Compressed torrents (.torrent.gz/.zst) are listed alongside plain ones,
+/// and tar archives can be entered to pick members without extracting them;
+/// member paths take the "bundle.tar!/member" form TorrentReader opens.
 class FileBrowser {
 public:
   explicit FileBrowser(const std::string &start_dir = ".");
@@ -57,6 +62,7 @@ private:
   std::set<std::string> selected_;
 
   void BuildListing();
+  void BuildArchiveListing(const std::string &archive);
 };
 
 #endif
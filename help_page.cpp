@@ -15,6 +15,7 @@ HelpPage::HelpPage() {
            {"Tab / l", "Next torrent tab"},
            {"Shift-Tab / h", "Previous torrent tab"},
            {"1-9", "Jump to torrent tab N"},
+           {"v", "Verify pieces against local data"},
        }},
       {"File Browser",
        {
@@ -0,0 +1,205 @@
+#include "index_cache.h"
+
+#include "content_hash.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// --- Snapshot format ---
+// header | path, padded to 8 bytes | containers
+// Containers are stored exactly as they sit in memory, so loading is a
+// mapping; byte_order rejects snapshots from a machine with different
+// endianness. The delimiter bitmap is not stored: rebuilding it from the
+// source is one SIMD pass, no dearer than checking a stored copy would be,
+// and a wrong bitmap would send lazy parsing to the wrong bytes.
+
+namespace {
+
+// Containers are mapped as-is, which needs 64-bit size_t
+constexpr bool snapshots_supported =
+    sizeof(StructuralIndex::Container) == 3 * sizeof(uint64_t);
+
+constexpr char snapshot_magic[8] = {'T', 'I', 'D', 'X', 0, 0, 0, 2};
+constexpr uint64_t native_order = 0x0102030405060708ULL;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint64_t byte_order;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+  uint64_t path_size;
+  uint64_t containers;
+  uint64_t max_depth;
+  uint64_t nodes;
+  uint64_t string_bytes;
+  uint64_t payload_hash; // of everything after the header
+};
+
+uint64_t padded(uint64_t size) { return (size + 7) / 8 * 8; }
+
+std::string canonical(const std::string &path) {
+  std::error_code error;
+  const auto absolute = fs::absolute(path, error);
+  return error ? path : absolute.lexically_normal().string();
+}
+
+// A snapshot must describe a preorder of properly nested containers of
+// `source` even when its hash matches: it may have been written by a buggy
+// or hostile process. One pass, O(containers). Whether it lists every
+// container, and only real ones, is left to the parsers, which check each
+// container they jump over against the byte they are at.
+bool plausible(const std::span<const StructuralIndex::Container> nodes,
+               const std::string_view source) {
+  // A container root is node 0, which lazy readers open without looking
+  const bool container_root =
+      !source.empty() && (source[0] == 'd' || source[0] == 'l');
+  if (container_root != (!nodes.empty() && nodes[0].begin == 0))
+    return false;
+  std::vector<size_t> open; // ancestors of the current node, innermost last
+  size_t closed_end = 0;    // end of the last container left behind
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    while (!open.empty() && open.back() + nodes[open.back()].descendants < i) {
+      closed_end = nodes[open.back()].end;
+      open.pop_back();
+    }
+    const auto &node = nodes[i];
+    if (node.begin >= node.end || node.end > source.size() ||
+        node.begin < closed_end ||
+        (source[node.begin] != 'd' && source[node.begin] != 'l') ||
+        source[node.end - 1] != 'e' ||
+        (i > 0 && node.begin <= nodes[i - 1].begin) ||
+        node.descendants >= nodes.size() - i)
+      return false;
+    if (!open.empty()) {
+      const auto &parent = nodes[open.back()];
+      if (node.end > parent.end ||
+          i + node.descendants > open.back() + parent.descendants)
+        return false;
+    }
+    open.push_back(i);
+  }
+  return true;
+}
+
+// Modification time in the filesystem clock's ticks; 0 if unavailable
+int64_t modified(const std::string &path) {
+  std::error_code error;
+  const auto time = fs::last_write_time(path, error);
+  return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+IndexCache::IndexCache(std::string directory)
+    : directory(std::move(directory)) {}
+
+std::string IndexCache::entryPath(const std::string &path) const {
+  char name[24];
+  std::snprintf(name, sizeof(name), "%016llx.idx",
+                static_cast<unsigned long long>(contentHash(canonical(path))));
+  return (fs::path(directory) / name).string();
+}
+
+std::unique_ptr<StructuralIndex> IndexCache::load(const std::string &path,
+                                                  std::string_view source,
+                                                  MappedFile &storage) const {
+  if constexpr (!snapshots_supported)
+    return nullptr;
+  MappedFile snapshot;
+  if (!snapshot.open(entryPath(path)))
+    return nullptr;
+  const std::string_view bytes = snapshot.view();
+  SnapshotHeader header;
+  if (bytes.size() < sizeof(header))
+    return nullptr;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  // Cheap checks first: format, then whether the source looks unchanged
+  if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+      header.byte_order != native_order ||
+      header.source_size != source.size() ||
+      header.source_mtime != modified(path) ||
+      header.containers > source.size() || header.path_size > bytes.size())
+    return nullptr;
+  const std::string key = canonical(path);
+  const size_t containers_at = sizeof(header) + padded(header.path_size);
+  if (bytes.size() != containers_at + header.containers *
+                                          sizeof(StructuralIndex::Container) ||
+      bytes.substr(sizeof(header), header.path_size) != key)
+    return nullptr;
+
+  // Then the content: a snapshot is only trusted for these exact bytes
+  if (contentHash(bytes.substr(sizeof(header))) != header.payload_hash ||
+      contentHash(source) != header.source_hash)
+    return nullptr;
+
+  const std::span containers(
+      reinterpret_cast<const StructuralIndex::Container *>(bytes.data() +
+                                                           containers_at),
+      header.containers);
+  if (!plausible(containers, source))
+    return nullptr;
+  auto index = std::make_unique<StructuralIndex>(
+      source, containers, StructuralBitmap(source),
+      StructuralIndex::Stats{header.max_depth, header.nodes,
+                             header.string_bytes});
+  storage = std::move(snapshot);
+  return index;
+}
+
+void IndexCache::store(const std::string &path, std::string_view source,
+                       const StructuralIndex &index) const {
+  if constexpr (!snapshots_supported)
+    return;
+  const std::string key = canonical(path);
+  const auto containers = index.containers();
+
+  std::string payload(padded(key.size()), '\0');
+  key.copy(payload.data(), key.size());
+  payload.append(reinterpret_cast<const char *>(containers.data()),
+                 containers.size_bytes());
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+  header.byte_order = native_order;
+  header.source_size = source.size();
+  header.source_mtime = modified(path);
+  header.source_hash = contentHash(source);
+  header.path_size = key.size();
+  header.containers = containers.size();
+  header.max_depth = index.stats().max_depth;
+  header.nodes = index.stats().nodes;
+  header.string_bytes = index.stats().string_bytes;
+  header.payload_hash = contentHash(payload);
+
+  // Write beside the entry and rename over it, so readers never see a
+  // partial snapshot
+  std::error_code error;
+  fs::create_directories(directory, error);
+  const std::string entry = entryPath(path);
+  const std::string temp =
+      entry + ".tmp" +
+      std::to_string(
+          std::chrono::steady_clock::now().time_since_epoch().count());
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if (!out) {
+      out.close();
+      fs::remove(temp, error);
+      return;
+    }
+  }
+  fs::rename(temp, entry, error);
+  if (error)
+    fs::remove(temp, error);
+}
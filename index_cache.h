@@ -0,0 +1,40 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "structural_index.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/// @brief Directory of StructuralIndex snapshots, so reopening a large
+/// torrent maps its index instead of scanning the file again. One entry per
+/// source path, stamped with the source's size, modification time and
+/// content hash; an entry is only used if all three still match the bytes
+/// being opened, and a damaged entry (checked by its own hash) is ignored.
+/// The cache is best effort: unwritable directories and I/O errors just mean
+/// no entry. A hit skips the validating scan and the container walk, but
+/// still reads the whole source twice: once to hash it (XXH64) and once to
+/// rebuild the delimiter bitmap, which is not stored. Only lazy and threaded
+/// reads of regular, uncompressed files consult the cache.
+class IndexCache {
+public:
+  explicit IndexCache(std::string directory);
+
+  // Index for `source`, the current contents of `path`, borrowed from a
+  // snapshot mapped into `storage`; nullptr if there is no valid entry
+  std::unique_ptr<StructuralIndex> load(const std::string &path,
+                                        std::string_view source,
+                                        MappedFile &storage) const;
+
+  // Write (or replace) the entry for `path`
+  void store(const std::string &path, std::string_view source,
+             const StructuralIndex &index) const;
+
+  // Snapshot file used for `path`
+  std::string entryPath(const std::string &path) const;
+
+private:
+  std::string directory;
+};
@@ -0,0 +1,124 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &filepath) {
+  close();
+  HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size;
+  if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return false;
+  }
+  if (file_size.QuadPart == 0) {
+    // Zero-length files cannot be mapped; report them as empty.
+    CloseHandle(file);
+    return true;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!view)
+    return false;
+
+  data_ = static_cast<const char *>(view);
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void MappedFile::adviseSequential() const {}
+
+void MappedFile::close() {
+  if (data_)
+    UnmapViewOfFile(data_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &filepath) {
+  close();
+  const int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+  if (st.st_size == 0) {
+    // mmap rejects zero-length mappings; report the file as empty.
+    ::close(fd);
+    return true;
+  }
+
+  void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+
+  data_ = static_cast<const char *>(view);
+  size_ = static_cast<size_t>(st.st_size);
+  return true;
+}
+
+void MappedFile::adviseSequential() const {
+  if (data_)
+    madvise(const_cast<char *>(data_), size_, MADV_SEQUENTIAL);
+}
+
+void MappedFile::close() {
+  if (data_)
+    munmap(const_cast<char *>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// @brief Read-only memory mapping of a whole file.
+/// The mapping is released when the object is destroyed; moving transfers
+/// ownership without touching the mapped pages, so views into data() stay
+/// valid for as long as some MappedFile owns them.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  /// Map the file at the given path. Returns false if the file cannot be
+  /// opened or is not a regular file (pipes, devices); the caller should then
+  /// fall back to ordinary reads. Empty files succeed with size() == 0.
+  bool open(const std::string &filepath);
+
+  /// Unmap and reset to the empty state.
+  void close();
+
+  /// Hint that the mapping will be read front to back, so the kernel reads
+  /// ahead aggressively. No effect where unsupported.
+  void adviseSequential() const;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+  std::string_view view() const { return {data_, size_}; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+
+// Well-known metainfo keys (BEP 3, 12, 19, 27, 52)
+enum class MetaKey : uint8_t {
+  Unknown,
+  Announce,
+  AnnounceList,
+  Comment,
+  CreatedBy,
+  CreationDate,
+  Encoding,
+  Info,
+  Name,
+  PieceLength,
+  Pieces,
+  Private,
+  Files,
+  Length,
+  Path,
+  Md5sum,
+  Attr,
+  MetaVersion,
+  FileTree,
+  PiecesRoot,
+  PieceLayers,
+  UrlList,
+  Source,
+};
+
+namespace metakey_detail {
+
+// Names in MetaKey order, after Unknown
+inline constexpr std::array<std::string_view, 22> names{
+    "announce",     "announce-list", "comment",      "created by",
+    "creation date", "encoding",     "info",         "name",
+    "piece length", "pieces",        "private",      "files",
+    "length",       "path",          "md5sum",       "attr",
+    "meta version", "file tree",     "pieces root",  "piece layers",
+    "url-list",     "source"};
+
+// The names again, back to back in one object: string literals need not be
+// merged, so this is what gives each name a single address program-wide
+inline constexpr size_t name_bytes = [] {
+  size_t total = 0;
+  for (const auto name : names)
+    total += name.size();
+  return total;
+}();
+
+inline constexpr auto name_storage = [] {
+  std::array<char, name_bytes> bytes{};
+  size_t at = 0;
+  for (const auto name : names)
+    for (const char c : name)
+      bytes[at++] = c;
+  return bytes;
+}();
+
+inline constexpr auto name_offsets = [] {
+  std::array<size_t, names.size()> offsets{};
+  size_t at = 0;
+  for (size_t i = 0; i < names.size(); ++i) {
+    offsets[i] = at;
+    at += names[i].size();
+  }
+  return offsets;
+}();
+
+inline constexpr size_t slot_bits = 6;
+
+// FNV-1a, with the seed folded into the offset basis; the top bits pick
+// the slot
+constexpr size_t slot(std::string_view key, uint64_t seed) {
+  uint64_t hash = 14695981039346656037ULL ^ seed;
+  for (const char c : key)
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+  return static_cast<size_t>(hash >> (64 - slot_bits));
+}
+
+// First seed that gives every name its own slot
+constexpr uint64_t findSeed() {
+  for (uint64_t seed = 0;; ++seed) {
+    std::array<bool, size_t{1} << slot_bits> used{};
+    bool collision = false;
+    for (const auto name : names) {
+      auto &taken = used[slot(name, seed)];
+      collision = collision || taken;
+      taken = true;
+    }
+    if (!collision)
+      return seed;
+  }
+}
+
+inline constexpr uint64_t seed = findSeed();
+
+constexpr std::array<MetaKey, size_t{1} << slot_bits> buildSlots() {
+  std::array<MetaKey, size_t{1} << slot_bits> slots{};
+  for (size_t i = 0; i < names.size(); ++i)
+    slots[slot(names[i], seed)] = static_cast<MetaKey>(i + 1);
+  return slots;
+}
+
+inline constexpr auto slots = buildSlots();
+
+} // namespace metakey_detail
+
+/// @brief Which well-known key `key` is, by a perfect hash built at compile
+/// time: one hash, one table load and one compare, whatever the key.
+constexpr MetaKey metaKey(std::string_view key) {
+  using namespace metakey_detail;
+  const MetaKey candidate = slots[slot(key, seed)];
+  if (candidate == MetaKey::Unknown ||
+      names[static_cast<size_t>(candidate) - 1] != key)
+    return MetaKey::Unknown;
+  return candidate;
+}
+
+constexpr std::string_view metaKeyName(MetaKey key) {
+  using namespace metakey_detail;
+  if (key == MetaKey::Unknown)
+    return {};
+  const size_t i = static_cast<size_t>(key) - 1;
+  return {name_storage.data() + name_offsets[i], names[i].size()};
+}
+
+/// @brief A dictionary key: its bytes, and which well-known key it is.
+/// Like a TorrentString the bytes are borrowed from the document's source,
+/// so a key must not outlive it; well-known keys point at the static names
+/// above instead. Keys compare by MetaKey when either side is well known,
+/// so matching "info" or "length" is one byte compare, and by bytes
+/// otherwise. Nothing is interned: a document's keys cost no shared state
+/// and are gone with it. Default-constructed keys are the empty string.
+class TorrentKey {
+public:
+  TorrentKey() = default;
+  // Throws std::length_error for keys of 4 GiB or more
+  constexpr explicit TorrentKey(std::string_view key)
+      : TorrentKey(key, metaKey(key)) {}
+  // For callers that already looked the key up; `known` must be
+  // metaKey(key)
+  constexpr TorrentKey(std::string_view key, MetaKey known)
+      : meta_key(known) {
+    if (key.size() > std::numeric_limits<uint32_t>::max())
+      throw std::length_error("Dictionary key too long");
+    if (meta_key != MetaKey::Unknown)
+      key = metaKeyName(meta_key);
+    key_data = key.data();
+    key_size = static_cast<uint32_t>(key.size());
+  }
+
+  // MetaKey::Unknown for keys that are not well known
+  constexpr MetaKey known() const { return meta_key; }
+  constexpr std::string_view str() const { return {key_data, key_size}; }
+  constexpr operator std::string_view() const { return str(); }
+
+  friend constexpr bool operator==(TorrentKey a, TorrentKey b) {
+    if (a.meta_key != MetaKey::Unknown || b.meta_key != MetaKey::Unknown)
+      return a.meta_key == b.meta_key;
+    return a.str() == b.str();
+  }
+  friend constexpr bool operator==(TorrentKey a, std::string_view b) {
+    return a.str() == b;
+  }
+  friend std::ostream &operator<<(std::ostream &os, TorrentKey key) {
+    return os << key.str();
+  }
+
+private:
+  // Packed into 16 bytes, since every dictionary entry holds one
+  const char *key_data = "";
+  uint32_t key_size = 0;
+  MetaKey meta_key = MetaKey::Unknown;
+};
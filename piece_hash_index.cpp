@@ -0,0 +1,126 @@
+#include "piece_hash_index.h"
+
+#include "content_hash.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+
+PieceHashIndex::PieceHashIndex(const size_t digest_size)
+    : width(digest_size), seed(std::random_device{}()) {}
+
+PieceHashIndex::PieceHashIndex(const std::span<const unsigned char> digests,
+                               const size_t digest_size)
+    : PieceHashIndex(digest_size) {
+  owned_digests.assign(digests.begin(), digests.end());
+  adopt(owned_digests);
+}
+
+PieceHashIndex PieceHashIndex::v1(const TorrentMetainfo &meta) {
+  PieceHashIndex index(TorrentMetainfo::digest_size);
+  index.adopt(meta.pieces());
+  return index;
+}
+
+PieceHashIndex PieceHashIndex::v2(const TorrentMetainfo &meta) {
+  std::vector<unsigned char> hashes;
+  std::vector<size_t> starts;
+  for (const auto &file : meta.fileTree()) {
+    starts.push_back(hashes.size() / TorrentMetainfo::v2_digest_size);
+    if (file.length == 0)
+      continue;
+    if (file.length <= meta.pieceLength())
+      hashes.insert(hashes.end(), file.root.begin(), file.root.end());
+    else
+      hashes.insert(hashes.end(), file.layer.begin(), file.layer.end());
+  }
+  PieceHashIndex index(TorrentMetainfo::v2_digest_size);
+  index.owned_digests = std::move(hashes);
+  index.adopt(index.owned_digests);
+  starts.push_back(index.size());
+  index.file_starts = std::move(starts);
+  return index;
+}
+
+uint64_t
+PieceHashIndex::hash(const std::span<const unsigned char> digest) const {
+  return contentHash(
+      {reinterpret_cast<const char *>(digest.data()), digest.size()}, seed);
+}
+
+void PieceHashIndex::adopt(const std::span<const unsigned char> digests) {
+  if (width == 0 || digests.size() % width != 0)
+    throw std::runtime_error("Invalid torrent: piece hashes are not a whole "
+                             "number of digests");
+  digest_bytes = digests;
+  if (size() >= std::numeric_limits<uint32_t>::max())
+    throw std::runtime_error("Invalid torrent: too many pieces");
+  file_starts = {0, size()};
+  build();
+}
+
+void PieceHashIndex::build() {
+  const size_t count = size();
+  slots.assign(std::max<size_t>(16, std::bit_ceil(2 * count)), {0, 0});
+  const size_t mask = slots.size() - 1;
+  const std::vector<unsigned char> zero(width, 0);
+  // Per digest's first piece, the later pieces that repeat it
+  std::vector<std::pair<size_t, size_t>> repeats;
+  for (size_t piece = 0; piece < count; ++piece) {
+    const auto bytes = digest(piece);
+    if (std::ranges::equal(bytes, zero))
+      zero_pieces.push_back(piece);
+    const uint64_t h = hash(bytes);
+    const auto tag = static_cast<uint32_t>(h >> 32);
+    for (size_t at = h & mask;; at = (at + 1) & mask) {
+      Slot &slot = slots[at];
+      if (slot.piece == 0) {
+        slot = {tag, static_cast<uint32_t>(piece + 1)};
+        break;
+      }
+      if (slot.tag == tag &&
+          std::ranges::equal(digest(slot.piece - 1), bytes)) {
+        repeats.emplace_back(slot.piece - 1, piece);
+        break;
+      }
+    }
+  }
+
+  // Pieces arrive in order, so sorting by first piece keeps each group's
+  // repeats ascending
+  std::ranges::stable_sort(repeats, {}, &std::pair<size_t, size_t>::first);
+  for (size_t i = 0; i < repeats.size(); ++i) {
+    if (i == 0 || repeats[i].first != repeats[i - 1].first)
+      duplicate_groups.push_back({repeats[i].first});
+    duplicate_groups.back().push_back(repeats[i].second);
+  }
+}
+
+size_t
+PieceHashIndex::find(const std::span<const unsigned char> digest) const {
+  if (digest.size() != width)
+    return npos;
+  const size_t mask = slots.size() - 1;
+  const uint64_t h = hash(digest);
+  const auto tag = static_cast<uint32_t>(h >> 32);
+  for (size_t at = h & mask;; at = (at + 1) & mask) {
+    const Slot &slot = slots[at];
+    if (slot.piece == 0)
+      return npos;
+    if (slot.tag == tag &&
+        std::ranges::equal(this->digest(slot.piece - 1), digest))
+      return slot.piece - 1;
+  }
+}
+
+PieceHashIndex::FilePiece
+PieceHashIndex::filePiece(const size_t piece) const {
+  // Last file starting at or before the piece; empty files share their
+  // successor's start and are passed over
+  const auto file =
+      std::upper_bound(file_starts.begin(), file_starts.end() - 1, piece) - 1;
+  return {static_cast<size_t>(file - file_starts.begin()), piece - *file};
+}
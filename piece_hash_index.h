@@ -0,0 +1,88 @@
+#pragma once
+
+#include "torrent_metainfo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// @brief Open-addressing hash table over a torrent's piece digests, for
+/// finding a piece from its hash. Built once in a single pass that also
+/// groups duplicate digests and notes all-zero ones, which real data never
+/// hashes to. Each distinct digest takes one slot of a power-of-two table
+/// kept at most half full and probed linearly; a slot holds a 32-bit tag
+/// from the digest's hash next to the piece number, so most mismatches are
+/// settled without touching the digests. The hash is seeded per index, so
+/// crafted digests cannot pile into one probe run. v1() borrows the digests
+/// from the reader's bytes, which must outlive the index; the others own
+/// theirs.
+class PieceHashIndex {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // A v2 piece as a file of the file tree and a piece within that file
+  struct FilePiece {
+    size_t file;
+    size_t piece;
+  };
+
+  // A copy of `digests` back to back, `digest_size` bytes each. Throws
+  // std::runtime_error if the bytes are not a whole number of digests.
+  PieceHashIndex(std::span<const unsigned char> digests, size_t digest_size);
+
+  // Digests may point into the index itself, so it moves but does not copy
+  PieceHashIndex(PieceHashIndex &&) = default;
+  PieceHashIndex &operator=(PieceHashIndex &&) = default;
+
+  // The SHA-1 digests of "pieces", borrowed rather than copied
+  static PieceHashIndex v1(const TorrentMetainfo &meta);
+  // The SHA-256 hashes of the v2 pieces, numbered consecutively in file
+  // tree order as PieceVerifier does: a file's piece layer, or its pieces
+  // root if it fits in one piece. Files without a layer are skipped.
+  static PieceHashIndex v2(const TorrentMetainfo &meta);
+
+  size_t size() const { return digest_bytes.size() / width; }
+  size_t digestSize() const { return width; }
+  std::span<const unsigned char> digest(size_t piece) const {
+    return digest_bytes.subspan(piece * width, width);
+  }
+
+  // Lowest-numbered piece with this digest; npos if there is none or the
+  // digest is not digestSize() bytes
+  size_t find(std::span<const unsigned char> digest) const;
+  // Every digest held by more than one piece, as the ascending list of
+  // those pieces; ordered by first piece
+  const std::vector<std::vector<size_t>> &duplicates() const {
+    return duplicate_groups;
+  }
+  // Pieces whose digest is all zero bytes, ascending
+  const std::vector<size_t> &zeroPieces() const { return zero_pieces; }
+
+  // Indices built by v2(): the file of the file tree holding `piece`, and
+  // its index among that file's pieces. Other indices see a single file.
+  FilePiece filePiece(size_t piece) const;
+
+private:
+  struct Slot {
+    uint32_t tag;
+    uint32_t piece; // piece + 1; 0 marks an empty slot
+  };
+
+  size_t width;
+  uint64_t seed;
+  std::vector<unsigned char> owned_digests;
+  std::span<const unsigned char> digest_bytes;
+  std::vector<Slot> slots;
+  std::vector<std::vector<size_t>> duplicate_groups;
+  std::vector<size_t> zero_pieces;
+  // v2: first piece of each file of the file tree, then the piece count
+  std::vector<size_t> file_starts;
+
+  explicit PieceHashIndex(size_t digest_size);
+
+  uint64_t hash(std::span<const unsigned char> digest) const;
+  // Index `digests`, which must outlive the index or be owned_digests
+  void adopt(std::span<const unsigned char> digests);
+  void build();
+};
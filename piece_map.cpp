@@ -0,0 +1,45 @@
+#include "piece_map.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+PieceMap::PieceMap(const TorrentMetainfo &meta)
+    : piece_length(meta.pieceLength()), pieces(0) {
+  const auto &files = meta.files();
+  starts.reserve(files.size() + 1);
+  for (const auto &file : files)
+    starts.push_back(file.offset);
+  starts.push_back(meta.totalSize());
+  // Even without content: piecesOf() divides by it
+  if (piece_length == 0)
+    throw std::runtime_error("Invalid torrent: piece length is zero");
+  if (starts.back() == 0)
+    return;
+  pieces = static_cast<size_t>((starts.back() - 1) / piece_length + 1);
+}
+
+PieceMap::Span PieceMap::piecesOf(const size_t file) const {
+  const uint64_t begin = starts[file];
+  const uint64_t end = starts[file + 1];
+  const size_t first = static_cast<size_t>(begin / piece_length);
+  if (begin == end)
+    return {first, first};
+  return {first, static_cast<size_t>((end - 1) / piece_length + 1)};
+}
+
+PieceMap::Span PieceMap::filesOf(const size_t piece) const {
+  const uint64_t begin = piece * piece_length;
+  const uint64_t end = std::min(begin + piece_length, starts.back());
+  // First file ending after `begin`, then the first starting at `end` or
+  // later; starts[i + 1] is where file i ends
+  const auto first = std::upper_bound(starts.begin() + 1, starts.end(), begin);
+  const auto last = std::lower_bound(first - 1, starts.end() - 1, end);
+  return {static_cast<size_t>(first - (starts.begin() + 1)),
+          static_cast<size_t>(last - starts.begin())};
+}
+
+size_t PieceMap::fileAt(const uint64_t offset) const {
+  return static_cast<size_t>(
+      std::upper_bound(starts.begin() + 1, starts.end(), offset) -
+      (starts.begin() + 1));
+}
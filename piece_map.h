@@ -0,0 +1,56 @@
+#pragma once
+
+#include "torrent_metainfo.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Index between a torrent's v1 pieces and the files they cover,
+/// built once per document from a prefix-sum table of file offsets. Files
+/// are numbered as in info.files (pad files included), or 0 for a
+/// single-file torrent. Both directions are answered without walking the
+/// file list: a file's pieces from its offsets, a piece's files by binary
+/// search over the offsets. Copies what it needs, so the metainfo may go
+/// away.
+class PieceMap {
+public:
+  // Half-open range of indices [first, last)
+  struct Span {
+    size_t first = 0;
+    size_t last = 0;
+
+    bool empty() const { return first == last; }
+    size_t size() const { return last - first; }
+  };
+
+  // Throws std::runtime_error for a torrent with no piece length, even one
+  // whose files are all empty
+  explicit PieceMap(const TorrentMetainfo &meta);
+
+  size_t fileCount() const { return starts.size() - 1; }
+  // Pieces the content is cut into; matches the "pieces" count of a
+  // well-formed torrent
+  size_t pieceCount() const { return pieces; }
+  uint64_t pieceLength() const { return piece_length; }
+  uint64_t totalSize() const { return starts.back(); }
+
+  uint64_t fileOffset(size_t file) const { return starts[file]; }
+  uint64_t fileLength(size_t file) const {
+    return starts[file + 1] - starts[file];
+  }
+
+  // Pieces holding any of the file's bytes; empty for an empty file
+  Span piecesOf(size_t file) const;
+  // Files holding any of the piece's bytes, in content order. Empty files
+  // between two of them are included; none at the piece's edges are.
+  Span filesOf(size_t piece) const;
+  // File holding content byte `offset` (< totalSize())
+  size_t fileAt(uint64_t offset) const;
+
+private:
+  uint64_t piece_length;
+  size_t pieces;
+  // starts[i] is the offset of file i; the last entry is the total size
+  std::vector<uint64_t> starts;
+};
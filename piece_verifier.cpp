@@ -0,0 +1,363 @@
+#include "piece_verifier.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Bytes of neighbouring pieces hashed by one task: large enough for the
+// read-ahead to pay off, small enough to keep every worker busy to the end
+constexpr uint64_t batch_bytes = 16 << 20;
+constexpr long long update_interval_ms = 50;
+
+// One torrent path component as one directory level: nothing that could
+// climb out of the data directory
+std::filesystem::path component(const std::string_view part) {
+  if (part.empty() || part == "." || part == ".." ||
+      part.find_first_of("/\\") != std::string_view::npos)
+    throw std::runtime_error("Invalid torrent: unsafe file path");
+  return std::filesystem::path(part);
+}
+
+long long nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+PieceVerifier::PieceVerifier(const TorrentMetainfo &meta,
+                             const std::filesystem::path &root,
+                             const size_t threads, const PieceScheme scheme)
+    : hash_scheme(scheme), sha_kernel(bestShaKernel()),
+      piece_length(meta.pieceLength()), total_size(0), pool(threads) {
+  if (scheme == PieceScheme::V1)
+    planV1(meta, root);
+  else
+    planV2(meta, root);
+  mappings.resize(files.size());
+  opened = std::vector<std::once_flag>(files.size());
+  states = std::vector<std::atomic<PieceState>>(
+      scheme == PieceScheme::V1 ? digests.size() : slices.size());
+  users = std::vector<std::atomic<size_t>>(files.size());
+  for (size_t piece = 0; piece < states.size(); ++piece) {
+    const auto [first, last] = filesOf(piece);
+    for (size_t file = first; file < last; ++file)
+      ++users[file];
+  }
+}
+
+PieceScheme PieceVerifier::preferredScheme(const TorrentMetainfo &meta) {
+  return meta.fileTree().empty() ? PieceScheme::V1 : PieceScheme::V2;
+}
+
+void PieceVerifier::planV1(const TorrentMetainfo &meta,
+                           const std::filesystem::path &root) {
+  total_size = meta.totalSize();
+  const size_t count = meta.pieceCount();
+  if (count == 0)
+    throw std::runtime_error("Torrent has no v1 pieces to verify");
+  if (piece_length == 0 ||
+      (total_size + piece_length - 1) / piece_length != count)
+    throw std::runtime_error(
+        "Invalid torrent: piece count does not match the total size");
+
+  digests.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    std::ranges::copy(meta.piece(i), digests[i].begin());
+
+  const std::filesystem::path base =
+      meta.isMultiFile() ? root / component(meta.name()) : root;
+  for (const auto &file : meta.files()) {
+    std::filesystem::path path = base;
+    for (const std::string_view part : file.path)
+      path /= component(part);
+    files.push_back(std::move(path));
+    extents.push_back({file.offset, file.length, file.pad});
+  }
+}
+
+void PieceVerifier::planV2(const TorrentMetainfo &meta,
+                           const std::filesystem::path &root) {
+  const auto &tree = meta.fileTree();
+  if (tree.empty())
+    throw std::runtime_error("Torrent has no v2 file tree to verify");
+  if (piece_length < merkle_block_size || !std::has_single_bit(piece_length))
+    throw std::runtime_error("Invalid torrent: v2 piece length must be a "
+                             "power of two of at least 16 KiB");
+  const size_t piece_leaves = piece_length / merkle_block_size;
+  const Sha256Digest pad = merklePad(piece_leaves);
+
+  // A lone top-level file is a single-file torrent, saved as root/name
+  const bool single = tree.size() == 1 && tree[0].path.size() == 1;
+  const std::filesystem::path base =
+      single ? root : root / component(meta.name());
+  for (const auto &file : tree) {
+    std::filesystem::path path = base;
+    for (const std::string_view part : file.path)
+      path /= component(part);
+    const size_t index = files.size();
+    files.push_back(std::move(path));
+    total_size += file.length;
+    if (file.length == 0)
+      continue;
+
+    Sha256Digest root_hash;
+    std::ranges::copy(file.root, root_hash.begin());
+    if (file.length <= piece_length) {
+      // The whole file is one piece, checked against the root itself
+      const uint64_t blocks =
+          (file.length + merkle_block_size - 1) / merkle_block_size;
+      slices.push_back({index, 0, file.length,
+                        std::bit_ceil(static_cast<size_t>(blocks))});
+      layer_hashes.push_back(root_hash);
+      continue;
+    }
+
+    if (file.layer.empty())
+      throw std::runtime_error("Invalid torrent: no piece layer for " +
+                               files.back().string());
+    // Check the layer itself against the root before trusting it per piece
+    constexpr size_t digest = TorrentMetainfo::v2_digest_size;
+    const size_t count = file.layer.size() / digest;
+    std::vector<Sha256Digest> layer(count);
+    for (size_t i = 0; i < count; ++i)
+      std::ranges::copy(file.layer.subspan(i * digest, digest),
+                        layer[i].begin());
+    if (merkleRoot(layer, std::bit_ceil(count), pad) != root_hash)
+      throw std::runtime_error("Invalid torrent: piece layer of " +
+                               files.back().string() +
+                               " does not match its pieces root");
+    for (size_t i = 0; i < count; ++i) {
+      const uint64_t offset = i * piece_length;
+      slices.push_back({index, offset,
+                        std::min(piece_length, file.length - offset),
+                        piece_leaves});
+    }
+    layer_hashes.insert(layer_hashes.end(), layer.begin(), layer.end());
+  }
+  if (slices.empty())
+    throw std::runtime_error("Torrent has no v2 pieces to verify");
+}
+
+PieceVerifier::~PieceVerifier() {
+  cancel();
+  wait();
+}
+
+void PieceVerifier::start(std::function<void()> update) {
+  on_update = std::move(update);
+  // V1 batches fill every lane of the SHA-1 kernel at least once
+  const uint64_t min_batch =
+      hash_scheme == PieceScheme::V1 ? shaKernelLanes(sha_kernel) : 1;
+  const size_t per_batch = static_cast<size_t>(
+      std::max<uint64_t>(min_batch, batch_bytes / piece_length));
+  const size_t count = states.size();
+  batches_left = (count + per_batch - 1) / per_batch;
+  for (size_t first = 0; first < count; first += per_batch) {
+    const size_t last = std::min(count, first + per_batch);
+    batches.push_back(
+        pool.submit([this, first, last] { runBatch(first, last); }));
+  }
+}
+
+void PieceVerifier::wait() {
+  for (auto &batch : batches)
+    if (batch.valid())
+      batch.wait();
+}
+
+PieceVerifier::Progress PieceVerifier::progress() const {
+  Progress result;
+  result.pieces = states.size();
+  result.good = good;
+  result.bad = bad;
+  result.missing = missing;
+  result.unreadable = unreadable;
+  result.bytes = hashed_bytes;
+  result.finished = !batches.empty() && batches_left == 0;
+  return result;
+}
+
+std::vector<size_t> PieceVerifier::failedPieces() const {
+  const std::lock_guard lock(failed_mutex);
+  return failed;
+}
+
+const MappedFile &PieceVerifier::mapping(const size_t file) {
+  std::call_once(opened[file], [&] {
+    // A file that cannot be mapped stays empty; its bytes are then read
+    if (mappings[file].open(files[file].string()))
+      mappings[file].adviseSequential();
+  });
+  return mappings[file];
+}
+
+PieceState PieceVerifier::read(const size_t file, const uint64_t offset,
+                               const uint64_t length,
+                               std::string &buffer) const {
+  std::error_code error;
+  const uint64_t size = std::filesystem::file_size(files[file], error);
+  if (error)
+    return error == std::errc::no_such_file_or_directory ||
+                   error == std::errc::not_a_directory
+               ? PieceState::Missing
+               : PieceState::Unreadable;
+  if (size < offset + length)
+    return PieceState::Missing;
+  std::ifstream in(files[file], std::ios::binary);
+  buffer.resize(static_cast<size_t>(length));
+  if (!in.seekg(static_cast<std::streamoff>(offset)) ||
+      !in.read(buffer.data(), static_cast<std::streamsize>(length)))
+    return PieceState::Unreadable;
+  return PieceState::Good;
+}
+
+std::pair<size_t, size_t> PieceVerifier::filesOf(const size_t piece) const {
+  if (hash_scheme == PieceScheme::V2)
+    return {slices[piece].file, slices[piece].file + 1};
+  const uint64_t offset = piece * piece_length;
+  const uint64_t end = std::min(offset + piece_length, total_size);
+  const auto first =
+      std::ranges::upper_bound(extents, offset, {}, &Extent::offset) - 1;
+  const auto last = std::ranges::lower_bound(extents, end, {}, &Extent::offset);
+  return {static_cast<size_t>(first - extents.begin()),
+          static_cast<size_t>(last - extents.begin())};
+}
+
+PieceState PieceVerifier::check(const size_t piece, std::string &buffer) {
+  uint64_t offset = piece * piece_length;
+  uint64_t remaining = std::min(piece_length, total_size - offset);
+  // First file holding the piece's first byte; empty files hold none
+  auto extent = std::ranges::upper_bound(extents, offset, {}, &Extent::offset);
+  size_t file = static_cast<size_t>(extent - extents.begin()) - 1;
+
+  Sha1 hash;
+  for (; remaining > 0; ++file) {
+    const Extent &e = extents[file];
+    if (offset >= e.offset + e.length)
+      continue;
+    const uint64_t within = offset - e.offset;
+    const uint64_t take = std::min(remaining, e.length - within);
+    if (e.pad) {
+      static const std::string zeros(merkle_block_size, '\0');
+      for (uint64_t left = take; left > 0;) {
+        const size_t chunk =
+            static_cast<size_t>(std::min<uint64_t>(left, zeros.size()));
+        hash.update(std::string_view(zeros).substr(0, chunk));
+        left -= chunk;
+      }
+      offset += take;
+      remaining -= take;
+      continue;
+    }
+    // Read rather than mapped: a piece may span thousands of small files
+    const PieceState got = read(file, within, take, buffer);
+    if (got != PieceState::Good)
+      return got;
+    hash.update(buffer);
+    hashed_bytes += take;
+    offset += take;
+    remaining -= take;
+  }
+  return hash.finish() == digests[piece] ? PieceState::Good : PieceState::Bad;
+}
+
+std::string_view PieceVerifier::contiguous(const size_t piece) {
+  const uint64_t offset = piece * piece_length;
+  const uint64_t length = std::min(piece_length, total_size - offset);
+  auto extent = std::ranges::upper_bound(extents, offset, {}, &Extent::offset);
+  const size_t file = static_cast<size_t>(extent - extents.begin()) - 1;
+  const Extent &e = extents[file];
+  if (e.pad || offset + length > e.offset + e.length)
+    return {};
+  const MappedFile &data = mapping(file);
+  if (data.size() < offset - e.offset + length)
+    return {};
+  return data.view().substr(offset - e.offset, length);
+}
+
+PieceState PieceVerifier::checkSlice(const size_t piece, std::string &buffer) {
+  const Slice &slice = slices[piece];
+  const MappedFile &data = mapping(slice.file);
+  std::string_view bytes;
+  if (data.size() >= slice.offset + slice.length) {
+    bytes = data.view().substr(slice.offset, slice.length);
+  } else {
+    const PieceState got = read(slice.file, slice.offset, slice.length, buffer);
+    if (got != PieceState::Good)
+      return got;
+    bytes = buffer;
+  }
+  const Sha256Digest hash = merkleRoot(bytes, slice.leaves);
+  hashed_bytes += slice.length;
+  return hash == layer_hashes[piece] ? PieceState::Good : PieceState::Bad;
+}
+
+void PieceVerifier::record(const size_t piece, const PieceState state) {
+  states[piece] = state;
+  (state == PieceState::Good      ? good
+   : state == PieceState::Bad     ? bad
+   : state == PieceState::Missing ? missing
+                                  : unreadable)++;
+  if (state != PieceState::Good) {
+    const std::lock_guard lock(failed_mutex);
+    if (failed.size() < failed_limit || piece < failed.back()) {
+      failed.insert(std::ranges::upper_bound(failed, piece), piece);
+      if (failed.size() > failed_limit)
+        failed.pop_back();
+    }
+  }
+  // Nothing still pending reads these files once their count hits zero
+  const auto [first, last] = filesOf(piece);
+  for (size_t file = first; file < last; ++file)
+    if (--users[file] == 0)
+      mappings[file].close();
+}
+
+void PieceVerifier::runBatch(const size_t first, const size_t last) {
+  std::string buffer;
+  if (hash_scheme == PieceScheme::V2) {
+    for (size_t piece = first; piece < last && !cancelled; ++piece)
+      record(piece, checkSlice(piece, buffer));
+  } else {
+    // A group of pieces at a time: those lying in one file go to the
+    // multi-buffer kernel together, the rest are hashed one by one
+    const size_t group = shaKernelLanes(sha_kernel);
+    std::vector<size_t> direct;
+    std::vector<std::string_view> views;
+    std::vector<Sha1Digest> hashes(group);
+    for (size_t piece = first; piece < last && !cancelled;) {
+      const size_t end = std::min(last, piece + group);
+      direct.clear();
+      views.clear();
+      for (; piece < end; ++piece) {
+        const std::string_view bytes = contiguous(piece);
+        if (bytes.empty()) {
+          record(piece, check(piece, buffer));
+          continue;
+        }
+        direct.push_back(piece);
+        views.push_back(bytes);
+      }
+      sha1Many(views, hashes, sha_kernel);
+      for (size_t i = 0; i < direct.size(); ++i) {
+        hashed_bytes += views[i].size();
+        record(direct[i], hashes[i] == digests[direct[i]] ? PieceState::Good
+                                                          : PieceState::Bad);
+      }
+    }
+  }
+  const bool finished = --batches_left == 0;
+  if (!on_update)
+    return;
+  const long long now = nowMs();
+  long long last_call = last_update;
+  if (finished || (now - last_call >= update_interval_ms &&
+                   last_update.compare_exchange_strong(last_call, now)))
+    on_update();
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "sha.h"
+#include "thread_pool.h"
+#include "torrent_metainfo.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class PieceState : unsigned char {
+  Unchecked, // not hashed yet, or verification was cancelled first
+  Good,
+  Bad,     // data present but its hash does not match
+  Missing, // some of the piece's bytes are in a missing or short file
+  Unreadable, // the files are there, but reading them failed
+};
+
+// Which of a torrent's piece hashes to check the data against
+enum class PieceScheme {
+  V1, // SHA-1 per piece over the concatenated files
+  V2, // BEP 52 per-file merkle trees, checked against "piece layers"
+};
+
+/// @brief Checks local data against a torrent's piece hashes.
+/// V1: the files are laid end to end as in the metainfo and pieces are cut
+/// from that stream, so a piece may span several files. V2: every file has
+/// its own pieces, numbered consecutively in file tree order; a piece's
+/// 16 KiB blocks are hashed and reduced to the piece's merkle subtree root,
+/// so one large file fans out across all workers. Files are memory-mapped
+/// with a sequential read-ahead hint and hashed on a ThreadPool in batches
+/// of neighbouring pieces, so each worker streams through one region of the
+/// data; V1 pieces within one file are hashed several at a time by the
+/// multi-buffer SHA-1 kernel. A mapping is released as soon as the last
+/// piece that needs it is hashed. V1 pieces spanning several files, and
+/// files that cannot be mapped, are read with ordinary reads instead, so
+/// torrents of many small files never hold many mappings at once.
+/// Everything needed is copied from the metainfo up front: the reader it
+/// came from may go away.
+class PieceVerifier {
+public:
+  struct Progress {
+    size_t pieces = 0; // in the torrent
+    size_t good = 0;
+    size_t bad = 0;
+    size_t missing = 0;
+    size_t unreadable = 0;
+    uint64_t bytes = 0; // hashed so far
+    bool finished = false;
+
+    size_t checked() const { return good + bad + missing + unreadable; }
+  };
+
+  // Data is looked for under `root` the way clients save it: root/name for
+  // single-file torrents, root/name/path... for multi-file ones. Throws
+  // std::runtime_error for torrents without hashes of that scheme, whose
+  // hashes do not match their size or whose paths would leave `root`. V2
+  // also rejects piece layers that do not reduce to their file's root.
+  PieceVerifier(const TorrentMetainfo &meta, const std::filesystem::path &root,
+                size_t threads = 0, PieceScheme scheme = PieceScheme::V1);
+
+  // V2 when the torrent has a file tree (v2 or hybrid), else V1
+  static PieceScheme preferredScheme(const TorrentMetainfo &meta);
+  // Cancels, then waits for the workers
+  ~PieceVerifier();
+
+  PieceVerifier(const PieceVerifier &) = delete;
+  PieceVerifier &operator=(const PieceVerifier &) = delete;
+
+  // Queue every piece and return at once. `on_update` is called from worker
+  // threads as batches complete, at most every 50 ms, and always once the
+  // last one is done. Call at most once.
+  void start(std::function<void()> on_update = {});
+  // Pieces not yet hashed stay Unchecked
+  void cancel() { cancelled = true; }
+  // Block until every queued batch has finished
+  void wait();
+
+  Progress progress() const;
+  size_t pieceCount() const { return states.size(); }
+  PieceState state(size_t piece) const { return states[piece]; }
+  // The lowest-numbered pieces found Bad, Missing or Unreadable so far,
+  // ascending and at most failed_limit of them; progress() has the totals
+  static constexpr size_t failed_limit = 16;
+  std::vector<size_t> failedPieces() const;
+  // Where each file of the torrent is read from, in content (V1) or file
+  // tree (V2) order
+  const std::vector<std::filesystem::path> &paths() const { return files; }
+  PieceScheme scheme() const { return hash_scheme; }
+
+private:
+  struct Extent {
+    uint64_t offset; // in the concatenated content
+    uint64_t length;
+    bool pad; // BEP 47 padding: zeros, not read from disk
+  };
+
+  // A V2 piece: one file's bytes [offset, offset + length), hashed as a
+  // merkle subtree of `leaves` blocks
+  struct Slice {
+    size_t file;
+    uint64_t offset;
+    uint64_t length;
+    size_t leaves;
+  };
+
+  PieceScheme hash_scheme;
+  ShaKernel sha_kernel;
+  uint64_t piece_length;
+  uint64_t total_size;
+  std::vector<Sha1Digest> digests;
+  std::vector<std::filesystem::path> files;
+  std::vector<Extent> extents;
+  std::vector<Slice> slices;
+  std::vector<Sha256Digest> layer_hashes; // one per V2 piece
+
+  // Files are mapped on first use by whichever worker needs them, and
+  // unmapped once `users` (pieces touching the file not yet recorded)
+  // drops to zero
+  std::vector<MappedFile> mappings;
+  std::vector<std::once_flag> opened;
+  std::vector<std::atomic<size_t>> users;
+
+  std::vector<std::atomic<PieceState>> states;
+  std::atomic<size_t> good{0}, bad{0}, missing{0}, unreadable{0};
+  mutable std::mutex failed_mutex;
+  std::vector<size_t> failed; // kept by record(), see failedPieces()
+  std::atomic<uint64_t> hashed_bytes{0};
+  std::atomic<size_t> batches_left{0};
+  std::atomic<bool> cancelled{false};
+  std::atomic<long long> last_update{0};
+  std::function<void()> on_update;
+  std::vector<std::future<void>> batches;
+  // Last, so the workers are joined before anything they use is destroyed
+  ThreadPool pool;
+
+  const MappedFile &mapping(size_t file);
+  // Read bytes [offset, offset + length) of a file into `buffer`. Good when
+  // all were read, Missing if the file is absent or too short, else
+  // Unreadable.
+  PieceState read(size_t file, uint64_t offset, uint64_t length,
+                  std::string &buffer) const;
+  // Files a piece takes bytes from, [first, last)
+  std::pair<size_t, size_t> filesOf(size_t piece) const;
+  void planV1(const TorrentMetainfo &meta, const std::filesystem::path &root);
+  void planV2(const TorrentMetainfo &meta, const std::filesystem::path &root);
+  // A V1 piece's bytes when they all lie in one mapped file, else empty
+  std::string_view contiguous(size_t piece);
+  PieceState check(size_t piece, std::string &buffer);
+  PieceState checkSlice(size_t piece, std::string &buffer);
+  void record(size_t piece, PieceState state);
+  void runBatch(size_t first, size_t last);
+};
@@ -0,0 +1,721 @@
+#include "sha.h"
+
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef TORRENT_X86
+#include <immintrin.h>
+#endif
+
+#if defined(TORRENT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TORRENT_SHA_LANES 1
+#endif
+
+namespace {
+
+uint32_t loadBig(const unsigned char *p) {
+  return uint32_t{p[0]} << 24 | uint32_t{p[1]} << 16 | uint32_t{p[2]} << 8 |
+         uint32_t{p[3]};
+}
+
+void storeBig(unsigned char *p, uint32_t value) {
+  p[0] = static_cast<unsigned char>(value >> 24);
+  p[1] = static_cast<unsigned char>(value >> 16);
+  p[2] = static_cast<unsigned char>(value >> 8);
+  p[3] = static_cast<unsigned char>(value);
+}
+
+void sha1Blocks(std::array<uint32_t, 5> &state, const unsigned char *data,
+                size_t blocks) {
+  for (; blocks > 0; --blocks, data += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i)
+      w[i] = loadBig(data + 4 * i);
+    for (int i = 16; i < 80; ++i)
+      w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4];
+    for (int i = 0; i < 80; ++i) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5a827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ed9eba1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8f1bbcdc;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xca62c1d6;
+      }
+      const uint32_t t = std::rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = std::rotl(b, 30);
+      b = a;
+      a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
+}
+
+constexpr uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+void sha256Blocks(std::array<uint32_t, 8> &state, const unsigned char *data,
+                  size_t blocks) {
+  for (; blocks > 0; --blocks, data += 64) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+      w[i] = loadBig(data + 4 * i);
+    for (int i = 16; i < 64; ++i) {
+      const uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^
+                          (w[i - 15] >> 3);
+      const uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^
+                          (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+      const uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+      const uint32_t ch = (e & f) ^ (~e & g);
+      const uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+      const uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+      const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + s0 + maj;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+using Sha1State = std::array<uint32_t, 5>;
+using Sha256State = std::array<uint32_t, 8>;
+using Sha1Compress = void (*)(Sha1State &, const unsigned char *, size_t);
+using Sha256Compress = void (*)(Sha256State &, const unsigned char *, size_t);
+
+constexpr Sha1State sha1_init{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476,
+                              0xc3d2e1f0};
+constexpr Sha256State sha256_init{0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                  0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                  0x1f83d9ab, 0x5be0cd19};
+
+#ifdef TORRENT_X86
+
+// --- SHA extensions: one message, four rounds per instruction ---
+
+// Rounds 4g..4g+3. w[g % 4] holds this group's message words; the schedule
+// for the groups ahead is advanced alongside. e[g % 2] is consumed and
+// e[(g + 1) % 2] takes the state for the next group.
+template <int G>
+TORRENT_TARGET("sha,ssse3,sse4.1")
+inline void sha1Group(__m128i &abcd, __m128i (&e)[2], __m128i (&w)[4]) {
+  __m128i &cur = e[G % 2];
+  if constexpr (G == 0)
+    cur = _mm_add_epi32(cur, w[0]);
+  else
+    cur = _mm_sha1nexte_epu32(cur, w[G % 4]);
+  e[(G + 1) % 2] = abcd;
+  if constexpr (G >= 3 && G <= 18)
+    w[(G + 1) % 4] = _mm_sha1msg2_epu32(w[(G + 1) % 4], w[G % 4]);
+  abcd = _mm_sha1rnds4_epu32(abcd, cur, G / 5);
+  if constexpr (G >= 1 && G <= 16)
+    w[(G + 3) % 4] = _mm_sha1msg1_epu32(w[(G + 3) % 4], w[G % 4]);
+  if constexpr (G >= 2 && G <= 17)
+    w[(G + 2) % 4] = _mm_xor_si128(w[(G + 2) % 4], w[G % 4]);
+}
+
+template <int... G>
+TORRENT_TARGET("sha,ssse3,sse4.1")
+inline void sha1Rounds(std::integer_sequence<int, G...>, __m128i &abcd,
+                       __m128i (&e)[2], __m128i (&w)[4]) {
+  (sha1Group<G>(abcd, e, w), ...);
+}
+
+TORRENT_TARGET("sha,ssse3,sse4.1")
+void sha1BlocksShaNi(Sha1State &state, const unsigned char *data,
+                     size_t blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i abcd = _mm_shuffle_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(state.data())), 0x1b);
+  __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+  for (; blocks > 0; --blocks, data += 64) {
+    const __m128i abcd_save = abcd, e_save = e0;
+    __m128i w[4];
+    for (int i = 0; i < 4; ++i)
+      w[i] = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)),
+          byte_swap);
+    __m128i e[2] = {e0, _mm_setzero_si128()};
+    sha1Rounds(std::make_integer_sequence<int, 20>(), abcd, e, w);
+    // After group 19, e[0] holds the state that began it
+    e0 = _mm_sha1nexte_epu32(e[0], e_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data()),
+                   _mm_shuffle_epi32(abcd, 0x1b));
+  state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+// Rounds 4g..4g+3 of SHA-256, with the schedule kept in w as for SHA-1
+template <int G>
+TORRENT_TARGET("sha,ssse3,sse4.1")
+inline void sha256Group(__m128i &state0, __m128i &state1, __m128i (&w)[4]) {
+  __m128i message = _mm_add_epi32(
+      w[G % 4],
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(sha256_k + 4 * G)));
+  state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+  if constexpr (G >= 3 && G <= 14) {
+    const __m128i carry = _mm_alignr_epi8(w[G % 4], w[(G + 3) % 4], 4);
+    w[(G + 1) % 4] = _mm_sha256msg2_epu32(
+        _mm_add_epi32(w[(G + 1) % 4], carry), w[G % 4]);
+  }
+  message = _mm_shuffle_epi32(message, 0x0e);
+  state0 = _mm_sha256rnds2_epu32(state0, state1, message);
+  if constexpr (G >= 1 && G <= 12)
+    w[(G + 3) % 4] = _mm_sha256msg1_epu32(w[(G + 3) % 4], w[G % 4]);
+}
+
+template <int... G>
+TORRENT_TARGET("sha,ssse3,sse4.1")
+inline void sha256Rounds(std::integer_sequence<int, G...>, __m128i &state0,
+                         __m128i &state1, __m128i (&w)[4]) {
+  (sha256Group<G>(state0, state1, w), ...);
+}
+
+TORRENT_TARGET("sha,ssse3,sse4.1")
+void sha256BlocksShaNi(Sha256State &state, const unsigned char *data,
+                       size_t blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  // The instructions want the state as ABEF and CDGH
+  __m128i dcba =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(state.data()));
+  __m128i hgfe =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(state.data() + 4));
+  dcba = _mm_shuffle_epi32(dcba, 0xb1);
+  hgfe = _mm_shuffle_epi32(hgfe, 0x1b);
+  __m128i state0 = _mm_alignr_epi8(dcba, hgfe, 8);
+  __m128i state1 = _mm_blend_epi16(hgfe, dcba, 0xf0);
+  for (; blocks > 0; --blocks, data += 64) {
+    const __m128i save0 = state0, save1 = state1;
+    __m128i w[4];
+    for (int i = 0; i < 4; ++i)
+      w[i] = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)),
+          byte_swap);
+    sha256Rounds(std::make_integer_sequence<int, 16>(), state0, state1, w);
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+  }
+  const __m128i feba = _mm_shuffle_epi32(state0, 0x1b);
+  const __m128i dchg = _mm_shuffle_epi32(state1, 0xb1);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data()),
+                   _mm_blend_epi16(feba, dchg, 0xf0));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data() + 4),
+                   _mm_alignr_epi8(dchg, feba, 8));
+}
+
+#endif
+
+#ifdef TORRENT_SHA_LANES
+
+// --- Multi-buffer: one message per 32-bit lane ---
+// Written once over GCC/Clang vector types and instantiated inside
+// functions compiled for AVX2 (8 lanes) or AVX-512 (16 lanes). States are
+// passed word-major, state[word * L + lane], so no vector crosses an ABI
+// boundary. Rotation is a macro, not a function, so that no helper has a
+// vector in its signature.
+
+template <size_t L> struct LaneVector {
+  typedef uint32_t type __attribute__((vector_size(4 * L)));
+};
+
+#define TORRENT_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+template <size_t L>
+__attribute__((always_inline)) inline void
+sha1Lanes(uint32_t *state, const unsigned char *const *lanes, size_t blocks) {
+  using V = typename LaneVector<L>::type;
+  V s[5];
+  __builtin_memcpy(s, state, sizeof(s));
+  for (size_t offset = 0; blocks > 0; --blocks, offset += 64) {
+    V w[16];
+    for (int t = 0; t < 16; ++t)
+      for (size_t lane = 0; lane < L; ++lane)
+        w[t][lane] = loadBig(lanes[lane] + offset + 4 * t);
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+    for (int i = 0; i < 80; ++i) {
+      if (i >= 16)
+        w[i & 15] = TORRENT_ROTL(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^
+                                     w[(i - 14) & 15] ^ w[i & 15],
+                                 1);
+      V f;
+      uint32_t k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5a827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ed9eba1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8f1bbcdc;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xca62c1d6;
+      }
+      const V t = TORRENT_ROTL(a, 5) + f + e + k + w[i & 15];
+      e = d;
+      d = c;
+      c = TORRENT_ROTL(b, 30);
+      b = a;
+      a = t;
+    }
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+  }
+  __builtin_memcpy(state, s, sizeof(s));
+}
+
+template <size_t L>
+__attribute__((always_inline)) inline void
+sha256Lanes(uint32_t *state, const unsigned char *const *lanes,
+            size_t blocks) {
+  using V = typename LaneVector<L>::type;
+  V s[8];
+  __builtin_memcpy(s, state, sizeof(s));
+  for (size_t offset = 0; blocks > 0; --blocks, offset += 64) {
+    V w[16];
+    for (int t = 0; t < 16; ++t)
+      for (size_t lane = 0; lane < L; ++lane)
+        w[t][lane] = loadBig(lanes[lane] + offset + 4 * t);
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6],
+      h = s[7];
+    for (int i = 0; i < 64; ++i) {
+      if (i >= 16) {
+        const V w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+        const V s0 =
+            TORRENT_ROTL(w15, 25) ^ TORRENT_ROTL(w15, 14) ^ (w15 >> 3);
+        const V s1 =
+            TORRENT_ROTL(w2, 15) ^ TORRENT_ROTL(w2, 13) ^ (w2 >> 10);
+        w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+      }
+      const V s1 =
+          TORRENT_ROTL(e, 26) ^ TORRENT_ROTL(e, 21) ^ TORRENT_ROTL(e, 7);
+      const V ch = (e & f) ^ (~e & g);
+      const V t1 = h + s1 + ch + sha256_k[i] + w[i & 15];
+      const V s0 =
+          TORRENT_ROTL(a, 30) ^ TORRENT_ROTL(a, 19) ^ TORRENT_ROTL(a, 10);
+      const V maj = (a & b) ^ (a & c) ^ (b & c);
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + s0 + maj;
+    }
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+    s[5] += f;
+    s[6] += g;
+    s[7] += h;
+  }
+  __builtin_memcpy(state, s, sizeof(s));
+}
+
+TORRENT_TARGET("avx2")
+void sha1Avx2(uint32_t *state, const unsigned char *const *lanes,
+              size_t blocks) {
+  sha1Lanes<8>(state, lanes, blocks);
+}
+
+TORRENT_TARGET("avx2")
+void sha256Avx2(uint32_t *state, const unsigned char *const *lanes,
+                size_t blocks) {
+  sha256Lanes<8>(state, lanes, blocks);
+}
+
+TORRENT_TARGET("avx512f,avx512bw")
+void sha1Avx512(uint32_t *state, const unsigned char *const *lanes,
+                size_t blocks) {
+  sha1Lanes<16>(state, lanes, blocks);
+}
+
+TORRENT_TARGET("avx512f,avx512bw")
+void sha256Avx512(uint32_t *state, const unsigned char *const *lanes,
+                  size_t blocks) {
+  sha256Lanes<16>(state, lanes, blocks);
+}
+
+#undef TORRENT_ROTL
+
+#endif
+
+// Shared Merkle–Damgård buffering: whole blocks go straight to `compress`,
+// the tail waits in `block`
+template <typename State, typename Compress>
+void absorb(State &state, std::array<unsigned char, 64> &block,
+            size_t &buffered, uint64_t &length, std::string_view bytes,
+            Compress compress) {
+  const auto *data = reinterpret_cast<const unsigned char *>(bytes.data());
+  size_t size = bytes.size();
+  length += size;
+  if (buffered > 0) {
+    const size_t take = std::min(size, 64 - buffered);
+    std::copy_n(data, take, block.data() + buffered);
+    buffered += take;
+    data += take;
+    size -= take;
+    if (buffered < 64)
+      return;
+    compress(state, block.data(), 1);
+    buffered = 0;
+  }
+  compress(state, data, size / 64);
+  data += size / 64 * 64;
+  buffered = size % 64;
+  std::copy_n(data, buffered, block.data());
+}
+
+// Append the 0x80 terminator, zero padding and the bit length
+template <typename State, typename Compress>
+void pad(State &state, std::array<unsigned char, 64> &block, size_t buffered,
+         uint64_t length, Compress compress) {
+  block[buffered++] = 0x80;
+  if (buffered > 56) {
+    std::fill(block.begin() + buffered, block.end(), 0);
+    compress(state, block.data(), 1);
+    buffered = 0;
+  }
+  std::fill(block.begin() + buffered, block.begin() + 56, 0);
+  const uint64_t bits = length * 8;
+  storeBig(block.data() + 56, static_cast<uint32_t>(bits >> 32));
+  storeBig(block.data() + 60, static_cast<uint32_t>(bits));
+  compress(state, block.data(), 1);
+}
+
+Sha256Digest hashPair(const Sha256Digest &left, const Sha256Digest &right) {
+  Sha256 hash;
+  hash.update({reinterpret_cast<const char *>(left.data()), left.size()});
+  hash.update({reinterpret_cast<const char *>(right.data()), right.size()});
+  return hash.finish();
+}
+
+// Single-message compression: the SHA extensions when present
+Sha1Compress sha1Compress() {
+#ifdef TORRENT_X86
+  if (CpuFeatures::get().sha_ni)
+    return sha1BlocksShaNi;
+#endif
+  return sha1Blocks;
+}
+
+Sha256Compress sha256Compress() {
+#ifdef TORRENT_X86
+  if (CpuFeatures::get().sha_ni)
+    return sha256BlocksShaNi;
+#endif
+  return sha256Blocks;
+}
+
+// Hashes every message with `compress`, or `lanes` messages at a time with
+// `parallel` when given. Messages are grouped by length so the lanes of a
+// group share as many whole blocks as possible; the blocks past the
+// shortest lane, and the padding, are finished one message at a time. A
+// lane kernel runs every lane whether used or not, so a last partial group
+// is left to `compress` as well.
+template <typename State, typename Digest>
+void hashMany(std::span<const std::string_view> messages,
+              std::span<Digest> digests, const State &init,
+              void (*compress)(State &, const unsigned char *, size_t),
+              void (*parallel)(uint32_t *, const unsigned char *const *,
+                               size_t),
+              size_t lanes) {
+  if (digests.size() < messages.size())
+    throw std::invalid_argument("Fewer digests than messages");
+  auto finish = [&](size_t message, State state, size_t done) {
+    std::array<unsigned char, 64> block;
+    size_t buffered = 0;
+    uint64_t length = done;
+    absorb(state, block, buffered, length, messages[message].substr(done),
+           compress);
+    pad(state, block, buffered, length, compress);
+    for (size_t i = 0; i < state.size(); ++i)
+      storeBig(digests[message].data() + 4 * i, state[i]);
+  };
+
+  std::vector<size_t> order(messages.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  size_t first = 0;
+  if (parallel) {
+    std::ranges::sort(order, std::greater<>(),
+                      [&](size_t i) { return messages[i].size(); });
+    constexpr size_t words = std::tuple_size_v<State>;
+    std::vector<uint32_t> lane_state(words * lanes);
+    std::vector<const unsigned char *> pointers(lanes);
+    for (; first + lanes <= order.size(); first += lanes) {
+      // Sorted longest first, so the group's last message bounds it
+      const size_t blocks = messages[order[first + lanes - 1]].size() / 64;
+      for (size_t lane = 0; lane < lanes; ++lane)
+        pointers[lane] = reinterpret_cast<const unsigned char *>(
+            messages[order[first + lane]].data());
+      for (size_t w = 0; w < words; ++w)
+        std::fill_n(lane_state.begin() + w * lanes, lanes, init[w]);
+      if (blocks > 0)
+        parallel(lane_state.data(), pointers.data(), blocks);
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        State state;
+        for (size_t w = 0; w < words; ++w)
+          state[w] = lane_state[w * lanes + lane];
+        finish(order[first + lane], state, blocks * 64);
+      }
+    }
+  }
+  for (; first < order.size(); ++first)
+    finish(order[first], init, 0);
+}
+
+} // namespace
+
+Sha1::Sha1() : state(sha1_init) {}
+
+void Sha1::update(const std::string_view bytes) {
+  absorb(state, block, buffered, length, bytes, sha1Compress());
+}
+
+Sha1Digest Sha1::finish() {
+  pad(state, block, buffered, length, sha1Compress());
+  Sha1Digest digest;
+  for (size_t i = 0; i < state.size(); ++i)
+    storeBig(digest.data() + 4 * i, state[i]);
+  return digest;
+}
+
+Sha256::Sha256() : state(sha256_init) {}
+
+void Sha256::update(const std::string_view bytes) {
+  absorb(state, block, buffered, length, bytes, sha256Compress());
+}
+
+Sha256Digest Sha256::finish() {
+  pad(state, block, buffered, length, sha256Compress());
+  Sha256Digest digest;
+  for (size_t i = 0; i < state.size(); ++i)
+    storeBig(digest.data() + 4 * i, state[i]);
+  return digest;
+}
+
+Sha1Digest sha1(const std::string_view bytes) {
+  Sha1 hash;
+  hash.update(bytes);
+  return hash.finish();
+}
+
+Sha256Digest sha256(const std::string_view bytes) {
+  Sha256 hash;
+  hash.update(bytes);
+  return hash.finish();
+}
+
+ShaKernel bestShaKernel() {
+  const auto &cpu = CpuFeatures::get();
+  if (cpu.avx512)
+    return ShaKernel::AVX512;
+  if (cpu.sha_ni)
+    return ShaKernel::SHANI;
+  if (cpu.avx2)
+    return ShaKernel::AVX2;
+  return ShaKernel::Scalar;
+}
+
+bool shaKernelSupported(const ShaKernel kernel) {
+  const auto &cpu = CpuFeatures::get();
+  switch (kernel) {
+  case ShaKernel::Scalar:
+    return true;
+  case ShaKernel::SHANI:
+    return cpu.sha_ni;
+#ifdef TORRENT_SHA_LANES
+  case ShaKernel::AVX2:
+    return cpu.avx2;
+  case ShaKernel::AVX512:
+    return cpu.avx512;
+#endif
+  default:
+    return false;
+  }
+}
+
+size_t shaKernelLanes(const ShaKernel kernel) {
+  switch (kernel) {
+  case ShaKernel::AVX2:
+    return 8;
+  case ShaKernel::AVX512:
+    return 16;
+  default:
+    return 1;
+  }
+}
+
+void sha1Many(const std::span<const std::string_view> messages,
+              const std::span<Sha1Digest> digests, ShaKernel kernel) {
+  if (!shaKernelSupported(kernel))
+    kernel = ShaKernel::Scalar;
+  switch (kernel) {
+#ifdef TORRENT_X86
+  case ShaKernel::SHANI:
+    return hashMany(messages, digests, sha1_init, sha1BlocksShaNi, nullptr, 1);
+#endif
+#ifdef TORRENT_SHA_LANES
+  case ShaKernel::AVX2:
+    return hashMany(messages, digests, sha1_init, sha1Compress(), sha1Avx2, 8);
+  case ShaKernel::AVX512:
+    return hashMany(messages, digests, sha1_init, sha1Compress(), sha1Avx512,
+                    16);
+#endif
+  default:
+    return hashMany(messages, digests, sha1_init, sha1Blocks, nullptr, 1);
+  }
+}
+
+void sha256Many(const std::span<const std::string_view> messages,
+                const std::span<Sha256Digest> digests, ShaKernel kernel) {
+  if (!shaKernelSupported(kernel))
+    kernel = ShaKernel::Scalar;
+  switch (kernel) {
+#ifdef TORRENT_X86
+  case ShaKernel::SHANI:
+    return hashMany(messages, digests, sha256_init, sha256BlocksShaNi,
+                    nullptr, 1);
+#endif
+#ifdef TORRENT_SHA_LANES
+  case ShaKernel::AVX2:
+    return hashMany(messages, digests, sha256_init, sha256Compress(),
+                    sha256Avx2, 8);
+  case ShaKernel::AVX512:
+    return hashMany(messages, digests, sha256_init, sha256Compress(),
+                    sha256Avx512, 16);
+#endif
+  default:
+    return hashMany(messages, digests, sha256_init, sha256Blocks, nullptr, 1);
+  }
+}
+
+Sha256Digest merkleRoot(const std::span<const Sha256Digest> hashes,
+                        size_t width, const Sha256Digest &pad) {
+  // Reduced in place one level at a time; `filler` tracks the padding
+  // subtree's hash at the current level
+  std::vector<Sha256Digest> level(hashes.begin(), hashes.end());
+  Sha256Digest filler = pad;
+  for (; width > 1; width /= 2) {
+    const size_t pairs = (level.size() + 1) / 2;
+    for (size_t i = 0; i < pairs; ++i) {
+      const Sha256Digest &right =
+          2 * i + 1 < level.size() ? level[2 * i + 1] : filler;
+      level[i] = hashPair(level[2 * i], right);
+    }
+    level.resize(pairs);
+    filler = hashPair(filler, filler);
+  }
+  return level.empty() ? filler : level.front();
+}
+
+Sha256Digest merkleRoot(const std::string_view data, const size_t leaves) {
+  // The blocks are independent messages, so they share the lanes
+  std::vector<std::string_view> blocks;
+  blocks.reserve((data.size() + merkle_block_size - 1) / merkle_block_size);
+  for (size_t at = 0; at < data.size(); at += merkle_block_size)
+    blocks.push_back(data.substr(at, merkle_block_size));
+  std::vector<Sha256Digest> hashes(blocks.size());
+  sha256Many(blocks, hashes);
+  return merkleRoot(hashes, leaves);
+}
+
+Sha256Digest merklePad(size_t leaves) {
+  Sha256Digest filler{};
+  for (; leaves > 1; leaves /= 2)
+    filler = hashPair(filler, filler);
+  return filler;
+}
+
+std::string toHex(const std::span<const unsigned char> bytes) {
+  static constexpr char digits[] = "0123456789abcdef";
+  std::string hex(bytes.size() * 2, '\0');
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    hex[2 * i] = digits[bytes[i] >> 4];
+    hex[2 * i + 1] = digits[bytes[i] & 0xf];
+  }
+  return hex;
+}
+
+std::optional<std::vector<unsigned char>> fromHex(const std::string_view hex) {
+  auto digit = [](const char c) -> int {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  };
+  if (hex.size() % 2 != 0)
+    return std::nullopt;
+  std::vector<unsigned char> bytes(hex.size() / 2);
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    const int high = digit(hex[2 * i]), low = digit(hex[2 * i + 1]);
+    if (high < 0 || low < 0)
+      return std::nullopt;
+    bytes[i] = static_cast<unsigned char>(high << 4 | low);
+  }
+  return bytes;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using Sha1Digest = std::array<unsigned char, 20>;
+using Sha256Digest = std::array<unsigned char, 32>;
+
+/// @brief Incremental SHA-1 (FIPS 180-4): feed bytes to update() in pieces
+/// of any size, then call finish() once. Uses the SHA extensions when the
+/// CPU has them.
+class Sha1 {
+public:
+  static constexpr size_t block_size = 64;
+
+  Sha1();
+  void update(std::string_view bytes);
+  Sha1Digest finish();
+
+private:
+  std::array<uint32_t, 5> state;
+  std::array<unsigned char, block_size> block;
+  size_t buffered = 0;
+  uint64_t length = 0;
+};
+
+/// @brief Incremental SHA-256 (FIPS 180-4), used the same way as Sha1.
+class Sha256 {
+public:
+  static constexpr size_t block_size = 64;
+
+  Sha256();
+  void update(std::string_view bytes);
+  Sha256Digest finish();
+
+private:
+  std::array<uint32_t, 8> state;
+  std::array<unsigned char, block_size> block;
+  size_t buffered = 0;
+  uint64_t length = 0;
+};
+
+Sha1Digest sha1(std::string_view bytes);
+Sha256Digest sha256(std::string_view bytes);
+
+// Ways to hash many independent messages, such as the pieces of a torrent.
+// SHANI runs one message at a time on the SHA extensions; AVX2 and AVX512
+// hash 8 or 16 messages side by side, one per 32-bit lane. The lane kernels
+// need GCC or Clang vector extensions and are unsupported elsewhere.
+enum class ShaKernel { Scalar, SHANI, AVX2, AVX512 };
+
+// The fastest kernel this CPU supports for equal-length messages
+ShaKernel bestShaKernel();
+bool shaKernelSupported(ShaKernel kernel);
+// Messages hashed per pass: 1, 8 or 16
+size_t shaKernelLanes(ShaKernel kernel);
+
+// digests[i] = sha1(messages[i]) (sha256 for sha256Many), computed with
+// `kernel`, or Scalar if the CPU lacks it. Throws std::invalid_argument if
+// `digests` is shorter than `messages`.
+void sha1Many(std::span<const std::string_view> messages,
+              std::span<Sha1Digest> digests,
+              ShaKernel kernel = bestShaKernel());
+void sha256Many(std::span<const std::string_view> messages,
+                std::span<Sha256Digest> digests,
+                ShaKernel kernel = bestShaKernel());
+
+// BEP 52 merkle trees: leaves are the SHA-256 of each 16 KiB block, and a
+// level with an odd or missing right child is padded with zero hashes
+inline constexpr size_t merkle_block_size = 16 << 10;
+
+// Root over `hashes` padded to `width` leaves (a power of two, at least
+// hashes.size()) with copies of `pad`
+Sha256Digest merkleRoot(std::span<const Sha256Digest> hashes, size_t width,
+                        const Sha256Digest &pad = {});
+// Root over the 16 KiB blocks of `data`, padded with zero leaves to
+// `leaves` (a power of two, at least the block count)
+Sha256Digest merkleRoot(std::string_view data, size_t leaves);
+// Root of `leaves` zero leaves: how piece layers pad a short last level
+Sha256Digest merklePad(size_t leaves);
+
+// Lowercase hex, two characters per byte
+std::string toHex(std::span<const unsigned char> bytes);
+// Bytes of a hex string in either case; nullopt if it has an odd length or
+// a character that is not a hex digit
+std::optional<std::vector<unsigned char>> fromHex(std::string_view hex);
@@ -0,0 +1,157 @@
+#include "string_kind.h"
+
+#include "cpu_features.h"
+
+#include <bit>
+
+#ifdef TORRENT_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool isPlain(const unsigned char c) {
+  return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Number of leading plain bytes in [p, p + n)
+size_t plainRunScalar(const unsigned char *p, const size_t n) {
+  size_t i = 0;
+  while (i < n && isPlain(p[i]))
+    ++i;
+  return i;
+}
+
+#ifdef TORRENT_X86
+
+// Signed compares: bytes >= 0x80 are negative, so "c < 0x20" also catches
+// every non-ASCII byte; DEL and the allowed whitespace are fixed up after.
+size_t plainRunSSE2(const unsigned char *p, const size_t n) {
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i del = _mm_set1_epi8(0x7F);
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    const __m128i special = _mm_or_si128(_mm_cmplt_epi8(bytes, space),
+                                         _mm_cmpeq_epi8(bytes, del));
+    const __m128i allowed = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, tab),
+                     _mm_cmpeq_epi8(bytes, newline)),
+        _mm_cmpeq_epi8(bytes, cr));
+    const auto mask = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_andnot_si128(allowed, special)));
+    if (mask)
+      return i + std::countr_zero(mask);
+  }
+  return i + plainRunScalar(p + i, n - i);
+}
+
+TORRENT_TARGET("avx2")
+size_t plainRunAVX2(const unsigned char *p, const size_t n) {
+  const __m256i space = _mm256_set1_epi8(0x20);
+  const __m256i del = _mm256_set1_epi8(0x7F);
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    const __m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space, bytes),
+                                            _mm256_cmpeq_epi8(bytes, del));
+    const __m256i allowed = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, tab),
+                        _mm256_cmpeq_epi8(bytes, newline)),
+        _mm256_cmpeq_epi8(bytes, cr));
+    const auto mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_andnot_si256(allowed, special)));
+    if (mask)
+      return i + std::countr_zero(mask);
+  }
+  // Not plainRunSSE2: mixing legacy SSE into AVX code stalls on the
+  // transition between the two register states
+  return i + plainRunScalar(p + i, n - i);
+}
+
+#endif
+
+// Length of the well-formed UTF-8 sequence starting at p[0] (a byte >= 0x80),
+// or 0 if there is none (Unicode Table 3-7)
+size_t utf8Sequence(const unsigned char *p, const size_t n) {
+  const unsigned char lead = p[0];
+  size_t length;
+  unsigned char low = 0x80, high = 0xBF; // bounds for the second byte
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    if (lead == 0xE0)
+      low = 0xA0; // no overlongs
+    else if (lead == 0xED)
+      high = 0x9F; // no surrogates
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    if (lead == 0xF0)
+      low = 0x90;
+    else if (lead == 0xF4)
+      high = 0x8F; // nothing past U+10FFFF
+  } else {
+    return 0;
+  }
+  if (n < length || p[1] < low || p[1] > high)
+    return 0;
+  for (size_t i = 2; i < length; ++i) {
+    if (p[i] < 0x80 || p[i] > 0xBF)
+      return 0;
+  }
+  return length;
+}
+
+} // namespace
+
+StringKind classifyString(const std::string_view bytes,
+                          StructuralBitmap::Kernel kernel) {
+#ifndef TORRENT_X86
+  kernel = StructuralBitmap::Kernel::Scalar;
+#endif
+  const auto *p = reinterpret_cast<const unsigned char *>(bytes.data());
+  const size_t n = bytes.size();
+  StringKind kind = StringKind::Ascii;
+  size_t i = 0;
+  while (true) {
+    const unsigned char *rest = p + i;
+    const size_t left = n - i;
+    // Short runs (most names and path components) are cheapest bytewise
+    if (left < 16 || kernel == StructuralBitmap::Kernel::Scalar)
+      i += plainRunScalar(rest, left);
+#ifdef TORRENT_X86
+    else if (kernel == StructuralBitmap::Kernel::AVX2 && left >= 64)
+      i += plainRunAVX2(rest, left);
+    else
+      i += plainRunSSE2(rest, left);
+#endif
+    if (i == n)
+      return kind;
+    // A control byte, DEL or the start of a multi-byte sequence
+    if (p[i] < 0x80)
+      return StringKind::Binary;
+    const size_t length = utf8Sequence(p + i, n - i);
+    if (length == 0)
+      return StringKind::Binary;
+    kind = StringKind::Utf8;
+    i += length;
+  }
+}
+
+std::string_view utf8Prefix(const std::string_view text, size_t limit) {
+  if (limit >= text.size())
+    return text;
+  // Back off over continuation bytes to the start of the cut sequence
+  while (limit > 0 && (static_cast<unsigned char>(text[limit]) & 0xC0) == 0x80)
+    --limit;
+  return text.substr(0, limit);
+}
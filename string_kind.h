@@ -0,0 +1,26 @@
+#pragma once
+
+#include "structural_bitmap.h"
+
+#include <cstdint>
+#include <string_view>
+
+// What a bencoded string holds, for display purposes
+enum class StringKind : uint8_t {
+  Ascii,  // printable ASCII, tabs and line breaks
+  Utf8,   // the above plus well-formed multi-byte UTF-8 sequences
+  Binary, // control bytes or invalid UTF-8 (hashes, pieces, ...)
+};
+
+/// @brief Classify a string in one pass. Runs of plain ASCII are skipped 16
+/// or 32 bytes at a time with the same runtime-dispatched kernels as
+/// StructuralBitmap; multi-byte sequences are validated as they are met
+/// (rejecting overlongs, surrogates and code points past U+10FFFF), and the
+/// scan stops at the first byte that makes the string binary.
+StringKind classifyString(
+    std::string_view bytes,
+    StructuralBitmap::Kernel kernel = StructuralBitmap::bestKernel());
+
+// Longest prefix of `text` of at most `limit` bytes that does not split a
+// UTF-8 sequence
+std::string_view utf8Prefix(std::string_view text, size_t limit);
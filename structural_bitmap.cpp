@@ -0,0 +1,192 @@
+#include "structural_bitmap.h"
+
+#include "cpu_features.h"
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef TORRENT_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct BlockMasks {
+  uint64_t colon;
+  uint64_t end;
+  uint64_t digit;
+};
+
+BlockMasks classifyScalar(const unsigned char *block) {
+  BlockMasks masks{0, 0, 0};
+  for (int i = 0; i < 64; ++i) {
+    const unsigned char c = block[i];
+    const uint64_t bit = uint64_t{1} << i;
+    if (c == ':')
+      masks.colon |= bit;
+    else if (c == 'e')
+      masks.end |= bit;
+    else if (c >= '0' && c <= '9')
+      masks.digit |= bit;
+  }
+  return masks;
+}
+
+#ifdef TORRENT_X86
+
+BlockMasks classifySSE2(const unsigned char *block) {
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i end = _mm_set1_epi8('e');
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i nine = _mm_set1_epi8(9);
+  BlockMasks masks{0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    const __m128i bytes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(block + 16 * i));
+    // c - '0' <= 9 (unsigned) <=> min(c - '0', 9) == c - '0'
+    const __m128i offset = _mm_sub_epi8(bytes, zero);
+    const __m128i is_digit =
+        _mm_cmpeq_epi8(_mm_min_epu8(offset, nine), offset);
+    const int shift = 16 * i;
+    masks.colon |= uint64_t(uint32_t(_mm_movemask_epi8(
+                       _mm_cmpeq_epi8(bytes, colon))))
+                   << shift;
+    masks.end |= uint64_t(uint32_t(_mm_movemask_epi8(
+                     _mm_cmpeq_epi8(bytes, end))))
+                 << shift;
+    masks.digit |= uint64_t(uint32_t(_mm_movemask_epi8(is_digit))) << shift;
+  }
+  return masks;
+}
+
+TORRENT_TARGET("avx2")
+BlockMasks classifyAVX2(const unsigned char *block) {
+  const __m256i colon = _mm256_set1_epi8(':');
+  const __m256i end = _mm256_set1_epi8('e');
+  const __m256i zero = _mm256_set1_epi8('0');
+  const __m256i nine = _mm256_set1_epi8(9);
+  BlockMasks masks{0, 0, 0};
+  for (int i = 0; i < 2; ++i) {
+    const __m256i bytes = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(block + 32 * i));
+    const __m256i offset = _mm256_sub_epi8(bytes, zero);
+    const __m256i is_digit =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(offset, nine), offset);
+    const int shift = 32 * i;
+    masks.colon |= uint64_t(uint32_t(_mm256_movemask_epi8(
+                       _mm256_cmpeq_epi8(bytes, colon))))
+                   << shift;
+    masks.end |= uint64_t(uint32_t(_mm256_movemask_epi8(
+                     _mm256_cmpeq_epi8(bytes, end))))
+                 << shift;
+    masks.digit |= uint64_t(uint32_t(_mm256_movemask_epi8(is_digit)))
+                   << shift;
+  }
+  return masks;
+}
+
+#endif
+
+} // namespace
+
+StructuralBitmap::Kernel StructuralBitmap::bestKernel() {
+  const auto &cpu = CpuFeatures::get();
+  if (cpu.avx2)
+    return Kernel::AVX2;
+  if (cpu.sse2)
+    return Kernel::SSE2;
+  return Kernel::Scalar;
+}
+
+StructuralBitmap::StructuralBitmap(std::string_view source, Kernel kernel)
+    : length(source.size()) {
+#ifndef TORRENT_X86
+  kernel = Kernel::Scalar;
+#endif
+  const size_t words = wordCount(length);
+  owned.resize(3 * words);
+  uint64_t *colon_words = owned.data();
+  uint64_t *end_words = colon_words + words;
+  uint64_t *digit_words = end_words + words;
+
+  const auto *bytes = reinterpret_cast<const unsigned char *>(source.data());
+  // The final partial block is classified from a zero-padded copy, and zero
+  // bytes fall in none of the classes.
+  unsigned char tail[64];
+  for (size_t w = 0; w < words; ++w) {
+    const unsigned char *block = bytes + 64 * w;
+    if (64 * w + 64 > length) {
+      std::memset(tail, 0, sizeof(tail));
+      std::memcpy(tail, block, length - 64 * w);
+      block = tail;
+    }
+
+    BlockMasks masks;
+    switch (kernel) {
+#ifdef TORRENT_X86
+    case Kernel::AVX2:
+      masks = classifyAVX2(block);
+      break;
+    case Kernel::SSE2:
+      masks = classifySSE2(block);
+      break;
+#endif
+    default:
+      masks = classifyScalar(block);
+      break;
+    }
+    colon_words[w] = masks.colon;
+    end_words[w] = masks.end;
+    digit_words[w] = masks.digit;
+  }
+  point(owned);
+}
+
+StructuralBitmap StructuralBitmap::borrow(size_t length,
+                                          std::span<const uint64_t> words) {
+  if (words.size() != 3 * wordCount(length))
+    throw std::invalid_argument("StructuralBitmap: wrong number of words");
+  StructuralBitmap bitmap;
+  bitmap.length = length;
+  bitmap.point(words);
+  return bitmap;
+}
+
+void StructuralBitmap::point(std::span<const uint64_t> words) {
+  const size_t count = words.size() / 3;
+  all = words;
+  colons = words.subspan(0, count);
+  ends = words.subspan(count, count);
+  digits = words.subspan(2 * count, count);
+}
+
+size_t StructuralBitmap::next(std::span<const uint64_t> bits,
+                              size_t pos) const {
+  if (pos >= length)
+    return npos;
+  size_t w = pos / 64;
+  uint64_t word = bits[w] & (~uint64_t{0} << (pos % 64));
+  while (word == 0) {
+    if (++w == bits.size())
+      return npos;
+    word = bits[w];
+  }
+  return w * 64 + std::countr_zero(word);
+}
+
+size_t StructuralBitmap::digitRun(size_t pos) const {
+  size_t run = 0;
+  while (pos < length) {
+    const size_t w = pos / 64;
+    const unsigned shift = pos % 64;
+    const int ones = std::countr_one(digits[w] >> shift);
+    // A run that reaches the top of the word may continue in the next one
+    const unsigned available = 64 - shift;
+    if (static_cast<unsigned>(ones) < available)
+      return run + ones;
+    run += available;
+    pos += available;
+  }
+  return run;
+}
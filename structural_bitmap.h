@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/// @brief Bitmaps marking every ':' , 'e' and ASCII digit in a buffer, one
+/// bit per byte, built 64 bytes at a time with SSE2/AVX2 where available.
+/// Bencode strings are length-prefixed, so a marked byte may sit inside
+/// string content; callers only ever ask for "the next ':' / 'e' at or after
+/// a position they already know is structural", which makes the answer exact
+/// and turns every delimiter search into a few bit scans.
+class StructuralBitmap {
+public:
+  enum class Kernel { Scalar, SSE2, AVX2 };
+
+  // Widest kernel supported by this CPU
+  static Kernel bestKernel();
+
+  StructuralBitmap() = default;
+  explicit StructuralBitmap(std::string_view source,
+                            Kernel kernel = bestKernel());
+
+  // Adopt the words() of a bitmap built earlier over `length` bytes, such
+  // as a mapped snapshot, without copying; they must outlive this bitmap
+  static StructuralBitmap borrow(size_t length,
+                                 std::span<const uint64_t> words);
+
+  // The bitmaps may live in owned storage that views point into
+  StructuralBitmap(const StructuralBitmap &) = delete;
+  StructuralBitmap &operator=(const StructuralBitmap &) = delete;
+  StructuralBitmap(StructuralBitmap &&) = default;
+  StructuralBitmap &operator=(StructuralBitmap &&) = default;
+
+  // Words needed for a source of `length` bytes, per class
+  static size_t wordCount(size_t length) { return (length + 63) / 64; }
+  // All three classes back to back: colons, ends, digits
+  std::span<const uint64_t> words() const { return all; }
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // Offset of the first ':' / 'e' at or after pos, or npos
+  size_t nextColon(size_t pos) const { return next(colons, pos); }
+  size_t nextEnd(size_t pos) const { return next(ends, pos); }
+
+  // Number of consecutive digits starting at pos
+  size_t digitRun(size_t pos) const;
+
+private:
+  size_t length = 0;
+  std::vector<uint64_t> owned;
+  std::span<const uint64_t> all;
+  std::span<const uint64_t> colons;
+  std::span<const uint64_t> ends;
+  std::span<const uint64_t> digits;
+
+  void point(std::span<const uint64_t> words);
+  size_t next(std::span<const uint64_t> bits, size_t pos) const;
+};
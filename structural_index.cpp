@@ -0,0 +1,159 @@
+#include "structural_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// A container still waiting for its closing 'e'
+struct OpenContainer {
+  size_t node;
+  bool is_dict;
+  bool expect_key; // dictionaries alternate key, value, key, ...
+};
+
+// The same text ParseBudget throws, kept as the error's detail
+ParseError overBudget(const char *what, size_t limit, size_t pos) {
+  return {ParseErrorKind::LimitExceeded, pos,
+          std::string("Parse limit exceeded: ") + what + " > " +
+              std::to_string(limit)};
+}
+
+} // namespace
+
+StructuralIndex::StructuralIndex(std::string_view source,
+                                 const ParseLimits &limits,
+                                 const StructuralBitmap::Kernel kernel)
+    : source_data(source), bits(source, kernel) {
+  const auto error = scan(limits);
+  if (!error)
+    return;
+  switch (error->kind) {
+  case ParseErrorKind::EmptyInput:
+  case ParseErrorKind::UnexpectedEnd:
+    if (error->offset >= source_data.size())
+      throw std::out_of_range("Unexpected End Of File");
+    break;
+  case ParseErrorKind::LimitExceeded:
+    throw ParseLimitError(error->detail);
+  default:
+    break;
+  }
+  throw std::runtime_error(error->message());
+}
+
+std::expected<StructuralIndex, ParseError>
+StructuralIndex::build(std::string_view source, const ParseLimits &limits,
+                       const StructuralBitmap::Kernel kernel) {
+  StructuralIndex index(source, StructuralBitmap(source, kernel));
+  if (auto error = index.scan(limits))
+    return std::unexpected(std::move(*error));
+  return index;
+}
+
+StructuralIndex::StructuralIndex(std::string_view source,
+                                 StructuralBitmap bits)
+    : source_data(source), bits(std::move(bits)) {}
+
+std::optional<ParseError>
+StructuralIndex::scan(const ParseLimits &limits) {
+  // Iterative walk: delimiters come from the bitmap, so each token costs a
+  // couple of bit scans rather than a byte-by-byte search, and an explicit
+  // stack replaces recursion. Errors match validateBencode's kind and offset.
+  const auto fail = [](ParseErrorKind kind, size_t at) {
+    return ParseError{kind, at, {}};
+  };
+  const size_t size = source_data.size();
+  std::vector<OpenContainer> open;
+  size_t nodes_seen = 0;
+  size_t string_bytes = 0;
+  size_t pos = 0;
+  do {
+    if (pos >= size)
+      return fail(size == 0 ? ParseErrorKind::EmptyInput
+                            : ParseErrorKind::UnexpectedEnd,
+                  pos);
+    const char c = source_data[pos];
+    const bool key = !open.empty() && open.back().is_dict &&
+                     open.back().expect_key;
+
+    if (c == 'e' && !open.empty()) {
+      if (open.back().is_dict && !open.back().expect_key)
+        return fail(ParseErrorKind::MissingValue, pos);
+      auto &container = owned[open.back().node];
+      container.end = pos + 1;
+      container.descendants = owned.size() - open.back().node - 1;
+      open.pop_back();
+      ++pos;
+    } else if (key && !(c >= '0' && c <= '9')) {
+      return fail(ParseErrorKind::KeyNotString, pos);
+    } else if (c >= '0' && c <= '9') {
+      // Keys are not values, so only count them towards the byte budget
+      if (!key && ++nodes_seen > limits.max_nodes)
+        return overBudget("node count", limits.max_nodes, pos);
+      const size_t colon = bits.nextColon(pos);
+      size_t len = 0;
+      if (colon == StructuralBitmap::npos)
+        return fail(ParseErrorKind::UnexpectedEnd, pos);
+      if (bits.digitRun(pos) != colon - pos ||
+          !readBencodeLength(source_data.substr(pos, colon - pos), len))
+        return fail(ParseErrorKind::InvalidLength, pos);
+      if (len > size - colon - 1)
+        return fail(ParseErrorKind::StringOutOfBounds, pos);
+      if (len > limits.max_string_bytes - string_bytes)
+        return overBudget("string bytes", limits.max_string_bytes, pos);
+      string_bytes += len;
+      pos = colon + 1 + len;
+    } else if (c == 'i') {
+      if (++nodes_seen > limits.max_nodes)
+        return overBudget("node count", limits.max_nodes, pos);
+      const size_t end = bits.nextEnd(pos + 1);
+      long long value = 0;
+      if (end == StructuralBitmap::npos)
+        return fail(ParseErrorKind::UnexpectedEnd, pos);
+      if (!readBencodeInteger(source_data.substr(pos + 1, end - pos - 1),
+                              value))
+        return fail(ParseErrorKind::InvalidInteger, pos);
+      pos = end + 1;
+    } else if (c == 'l' || c == 'd') {
+      if (++nodes_seen > limits.max_nodes)
+        return overBudget("node count", limits.max_nodes, pos);
+      if (open.size() + 1 > limits.max_depth)
+        return overBudget("depth", limits.max_depth, pos);
+      document_stats.max_depth =
+          std::max(document_stats.max_depth, open.size() + 1);
+      open.push_back({owned.size(), c == 'd', true});
+      owned.push_back({pos, 0, 0});
+      ++pos;
+      continue; // the container itself is not a complete value yet
+    } else {
+      return fail(ParseErrorKind::UnknownType, pos);
+    }
+
+    // A key or value just finished inside a dictionary
+    if (!open.empty() && open.back().is_dict)
+      open.back().expect_key = !open.back().expect_key;
+  } while (!open.empty());
+
+  nodes = owned;
+  document_stats.nodes = nodes_seen;
+  document_stats.string_bytes = string_bytes;
+  return std::nullopt;
+}
+
+StructuralIndex::StructuralIndex(std::string_view source,
+                                 std::span<const Container> containers,
+                                 StructuralBitmap bits, const Stats &stats)
+    : source_data(source), bits(std::move(bits)), nodes(containers),
+      document_stats(stats) {}
+
+void StructuralIndex::checkLimits(const ParseLimits &limits) const {
+  // Replay the totals through a budget so the errors match a real parse
+  ParseBudget budget(limits);
+  budget.enter(document_stats.max_depth);
+  if (document_stats.nodes > limits.max_nodes)
+    throw ParseLimitError("Parse limit exceeded: node count > " +
+                          std::to_string(limits.max_nodes));
+  budget.string(document_stats.string_bytes);
+}
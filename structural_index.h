@@ -0,0 +1,91 @@
+#pragma once
+
+#include "bencode_parser.h"
+#include "structural_bitmap.h"
+
+#include <cstddef>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/// @brief Begin/end offsets of every list and dictionary in a bencoded
+/// document, recorded in one pass without building any values. The pass
+/// walks a StructuralBitmap rather than the raw bytes; the bitmap is kept so
+/// parsers working from the index can reuse it.
+/// Containers are numbered in preorder (the order their opening byte appears),
+/// so a container's descendants are exactly the next `descendants` entries and
+/// the whole subtree can be stepped over in O(1).
+class StructuralIndex {
+public:
+  struct Container {
+    size_t begin;       // offset of the opening 'l' / 'd'
+    size_t end;         // one past the closing 'e'
+    size_t descendants; // nested containers inside this one
+  };
+
+  // What the document charges against ParseLimits
+  struct Stats {
+    size_t max_depth;
+    size_t nodes;
+    size_t string_bytes;
+  };
+
+  // Scans and validates the whole document; throws std::runtime_error /
+  // std::out_of_range on malformed input like BencodeParser does, and
+  // ParseLimitError as soon as one of the limits is exceeded.
+  explicit StructuralIndex(
+      std::string_view source, const ParseLimits &limits = {},
+      StructuralBitmap::Kernel kernel = StructuralBitmap::bestKernel());
+
+  // The same scan with failures reported as values, with the kind and offset
+  // validateBencode would give; a LimitExceeded detail names the budget
+  static std::expected<StructuralIndex, ParseError>
+  build(std::string_view source, const ParseLimits &limits = {},
+        StructuralBitmap::Kernel kernel = StructuralBitmap::bestKernel());
+
+  // Adopt the containers() and bitmap of an index built earlier over the
+  // same bytes, such as a mapped snapshot, without copying or validating;
+  // the arrays must outlive the index
+  StructuralIndex(std::string_view source,
+                  std::span<const Container> containers, StructuralBitmap bits,
+                  const Stats &stats);
+
+  // Containers may point into the index itself, so it moves but does not
+  // copy
+  StructuralIndex(StructuralIndex &&) = default;
+  StructuralIndex &operator=(StructuralIndex &&) = default;
+
+  // Throws ParseLimitError if the document exceeds `limits`
+  void checkLimits(const ParseLimits &limits) const;
+
+  std::string_view source() const { return source_data; }
+  const StructuralBitmap &bitmap() const { return bits; }
+  size_t size() const { return nodes.size(); }
+  std::span<const Container> containers() const { return nodes; }
+  const Stats &stats() const { return document_stats; }
+  const Container &operator[](size_t node) const { return nodes[node]; }
+
+  bool isDict(size_t node) const {
+    return source_data[nodes[node].begin] == 'd';
+  }
+  bool isList(size_t node) const {
+    return source_data[nodes[node].begin] == 'l';
+  }
+
+  // Node number of the first container after this one's subtree
+  size_t next(size_t node) const { return node + 1 + nodes[node].descendants; }
+
+private:
+  StructuralIndex(std::string_view source, StructuralBitmap bits);
+
+  // Fills in the containers and stats; the first error stops the scan
+  std::optional<ParseError> scan(const ParseLimits &limits);
+
+  std::string_view source_data;
+  StructuralBitmap bits;
+  std::vector<Container> owned;
+  std::span<const Container> nodes;
+  Stats document_stats{};
+};
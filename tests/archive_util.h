@@ -0,0 +1,83 @@
+#pragma once
+
+#ifdef TORRENT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef TORRENT_HAVE_ZLIB
+inline constexpr bool gzip_supported = true;
+
+// gzip-compress `data` in one go (a single gzip member)
+inline std::string GzipCompress(const std::string& data) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                 Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+#else
+// Builds without zlib cannot read gzip, so tests check gzip_supported and
+// skip the gzip cases
+inline constexpr bool gzip_supported = false;
+
+inline std::string GzipCompress(const std::string&) {
+    throw std::logic_error("gzip is not supported by this build");
+}
+#endif
+
+namespace archive_util_detail {
+
+inline std::string TarHeader(const std::string& name, size_t size, char type) {
+    std::string block(512, '\0');
+    name.copy(block.data(), std::min<size_t>(name.size(), 100));
+    std::snprintf(block.data() + 100, 8, "%07o", 0644);
+    std::snprintf(block.data() + 108, 8, "%07o", 0);
+    std::snprintf(block.data() + 116, 8, "%07o", 0);
+    std::snprintf(block.data() + 124, 12, "%011zo", size);
+    std::snprintf(block.data() + 136, 12, "%011o", 0);
+    block[156] = type;
+    std::string("ustar\0" "00", 8).copy(block.data() + 257, 8);
+    block.replace(148, 8, 8, ' ');
+    unsigned sum = 0;
+    for (unsigned char c : block)
+        sum += c;
+    std::snprintf(block.data() + 148, 8, "%06o", sum);
+    return block;
+}
+
+inline std::string TarData(const std::string& data) {
+    return data + std::string((512 - data.size() % 512) % 512, '\0');
+}
+
+} // namespace archive_util_detail
+
+// A ustar archive of (name, content) regular files; names over 100 bytes get
+// a GNU long-name entry. Directories are given as names ending in '/'.
+inline std::string MakeTar(
+    const std::vector<std::pair<std::string, std::string>>& files) {
+    using namespace archive_util_detail;
+    std::string tar;
+    for (const auto& [name, content] : files) {
+        if (name.size() > 100) {
+            tar += TarHeader("././@LongLink", name.size() + 1, 'L');
+            tar += TarData(name + '\0');
+        }
+        const bool directory = !name.empty() && name.back() == '/';
+        tar += TarHeader(name, content.size(), directory ? '5' : '0');
+        tar += TarData(content);
+    }
+    return tar + std::string(1024, '\0');
+}
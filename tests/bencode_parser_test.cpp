@@ -0,0 +1,523 @@
+#include <gtest/gtest.h>
+#include "bencode_parser.h"
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Records every event as a short token so sequences are easy to compare
+class RecordingHandler : public BencodeHandler {
+public:
+  BencodeAction onInt(long long value) override {
+    events.push_back("i:" + std::to_string(value));
+    return BencodeAction::Continue;
+  }
+  BencodeAction onString(std::string_view value) override {
+    events.push_back("s:" + std::string(value));
+    return BencodeAction::Continue;
+  }
+  BencodeAction onListBegin() override {
+    events.push_back("[");
+    return BencodeAction::Continue;
+  }
+  BencodeAction onListEnd() override {
+    events.push_back("]");
+    return BencodeAction::Continue;
+  }
+  BencodeAction onDictBegin() override {
+    events.push_back("{");
+    return BencodeAction::Continue;
+  }
+  BencodeAction onKey(std::string_view key) override {
+    events.push_back("k:" + std::string(key));
+    return key == skip_key ? BencodeAction::Skip : BencodeAction::Continue;
+  }
+  BencodeAction onDictEnd() override {
+    events.push_back("}");
+    return BencodeAction::Continue;
+  }
+
+  std::string skip_key;
+  std::vector<std::string> events;
+};
+
+// Test events for scalars
+TEST(BencodeParserTest, ScalarEvents) {
+  RecordingHandler handler;
+  BencodeParser ints("i-7e");
+  EXPECT_TRUE(ints.parse(handler));
+  BencodeParser strings("5:hello");
+  EXPECT_TRUE(strings.parse(handler));
+
+  EXPECT_EQ(handler.events, (std::vector<std::string>{"i:-7", "s:hello"}));
+}
+
+// Test events for nested containers arrive in document order
+TEST(BencodeParserTest, NestedEvents) {
+  RecordingHandler handler;
+  BencodeParser parser("d4:listli1e1:xe4:named1:ai2eee");
+  EXPECT_TRUE(parser.parse(handler));
+
+  EXPECT_EQ(handler.events,
+            (std::vector<std::string>{"{", "k:list", "[", "i:1", "s:x", "]",
+                                      "k:name", "{", "k:a", "i:2", "}",
+                                      "}"}));
+  EXPECT_EQ(parser.position(), 30u);
+}
+
+// Test Skip from onKey drops that value but keeps parsing
+TEST(BencodeParserTest, SkipKeyValue) {
+  RecordingHandler handler;
+  handler.skip_key = "pieces";
+  BencodeParser parser("d6:lengthi5e6:piecesld1:ai1eee4:zzzz1:ze");
+  EXPECT_TRUE(parser.parse(handler));
+
+  EXPECT_EQ(handler.events,
+            (std::vector<std::string>{"{", "k:length", "i:5", "k:pieces",
+                                      "k:zzzz", "s:z", "}"}));
+}
+
+// Test Skip from a container begin suppresses the rest of the container
+TEST(BencodeParserTest, SkipContainer) {
+  class SkipLists : public RecordingHandler {
+  public:
+    BencodeAction onListBegin() override {
+      RecordingHandler::onListBegin();
+      return BencodeAction::Skip;
+    }
+  } handler;
+
+  BencodeParser parser("d1:ali1ei2ee1:bi3ee");
+  EXPECT_TRUE(parser.parse(handler));
+  EXPECT_EQ(handler.events, (std::vector<std::string>{"{", "k:a", "[", "k:b",
+                                                       "i:3", "}"}));
+}
+
+// Test Stop ends the parse early without consuming the remainder
+TEST(BencodeParserTest, StopEarly) {
+  class FirstKeyOnly : public BencodeHandler {
+  public:
+    BencodeAction onKey(std::string_view key) override {
+      found = std::string(key);
+      return BencodeAction::Stop;
+    }
+    std::string found;
+  } handler;
+
+  // Everything after the first key is garbage and must never be looked at
+  BencodeParser parser("d8:announce!!!garbage");
+  EXPECT_FALSE(parser.parse(handler));
+  EXPECT_EQ(handler.found, "announce");
+}
+
+// Test a counting handler needs no tree at all
+TEST(BencodeParserTest, CountWithoutTree) {
+  class FileCounter : public BencodeHandler {
+  public:
+    BencodeAction onKey(std::string_view key) override {
+      if (key == "length")
+        ++files;
+      return BencodeAction::Continue;
+    }
+    int files = 0;
+  } counter;
+
+  BencodeParser parser("d5:filesld6:lengthi1eed6:lengthi2eed6:lengthi3eeee");
+  EXPECT_TRUE(parser.parse(counter));
+  EXPECT_EQ(counter.files, 3);
+}
+
+// Test skip() advances past a value without events
+TEST(BencodeParserTest, SkipValue) {
+  BencodeParser parser("d1:ali1eee5:after");
+  parser.skip();
+  EXPECT_EQ(parser.position(), 10u);
+
+  RecordingHandler handler;
+  EXPECT_TRUE(parser.parse(handler));
+  EXPECT_EQ(handler.events, (std::vector<std::string>{"s:after"}));
+}
+
+// Test malformed input throws
+TEST(BencodeParserTest, ErrorsThrow) {
+  BencodeHandler handler;
+  EXPECT_THROW(BencodeParser("li1e").parse(handler), std::out_of_range);
+  EXPECT_THROW(BencodeParser("x").parse(handler), std::runtime_error);
+  EXPECT_THROW(BencodeParser("i12").parse(handler), std::runtime_error);
+  EXPECT_THROW(BencodeParser("9:abc").parse(handler), std::runtime_error);
+}
+
+// Test hostile nesting is handled without recursion
+TEST(BencodeParserTest, DeepNestingDoesNotOverflow) {
+  const size_t depth = 1000000;
+  std::string doc(depth, 'l');
+  doc += std::string(depth, 'e');
+
+  class DepthCounter : public BencodeHandler {
+  public:
+    BencodeAction onListBegin() override {
+      ++lists;
+      return BencodeAction::Continue;
+    }
+    size_t lists = 0;
+  } handler;
+
+  BencodeParser parser(doc);
+  EXPECT_TRUE(parser.parse(handler));
+  EXPECT_EQ(handler.lists, depth);
+  EXPECT_EQ(parser.position(), doc.size());
+
+  // Unterminated nesting fails cleanly at end of input
+  BencodeParser truncated(std::string_view(doc).substr(0, depth));
+  EXPECT_THROW(truncated.parse(handler), std::out_of_range);
+}
+
+// Test the depth budget fails fast
+TEST(BencodeParserTest, DepthLimit) {
+  ParseLimits limits;
+  limits.max_depth = 3;
+  BencodeHandler handler;
+
+  EXPECT_TRUE(BencodeParser("llleee", limits).parse(handler));
+  // Fails on the fourth 'l' even though the rest is never valid
+  EXPECT_THROW(BencodeParser("lllll!garbage", limits).parse(handler),
+               ParseLimitError);
+  // Skipped subtrees are bounded too
+  ParseLimits skip_limits;
+  skip_limits.max_depth = 2;
+  RecordingHandler skipper;
+  skipper.skip_key = "a";
+  EXPECT_THROW(BencodeParser("d1:allleeee", skip_limits).parse(skipper),
+               ParseLimitError);
+}
+
+// Test the node budget counts values of every type
+TEST(BencodeParserTest, NodeLimit) {
+  ParseLimits limits;
+  limits.max_nodes = 4;
+  BencodeHandler handler;
+
+  EXPECT_TRUE(BencodeParser("li1ei2e1:xe", limits).parse(handler));
+  EXPECT_THROW(BencodeParser("li1ei2ei3ei4ee", limits).parse(handler),
+               ParseLimitError);
+}
+
+// Test the string budget is charged from the length prefix
+TEST(BencodeParserTest, StringBytesLimit) {
+  ParseLimits limits;
+  limits.max_string_bytes = 10;
+  BencodeHandler handler;
+
+  EXPECT_TRUE(BencodeParser("d3:key7:12345ABe", limits).parse(handler));
+  // A huge length prefix is rejected before bounds are even considered
+  EXPECT_THROW(BencodeParser("999999999:x", limits).parse(handler),
+               std::runtime_error);
+  EXPECT_THROW(BencodeParser("d3:key8:12345ABCe", limits).parse(handler),
+               ParseLimitError);
+}
+
+// --- BencodePushParser ---
+
+// Feeds `doc` to a push parser in chunks of `size` bytes
+static bool FeedInChunks(BencodePushParser &parser, std::string_view doc,
+                         size_t size) {
+  bool done = false;
+  for (size_t i = 0; i < doc.size() && !done; i += size)
+    done = parser.feed(doc.substr(i, size));
+  return done;
+}
+
+// Test any chunking produces the same events as the one-shot parser
+TEST(BencodePushParserTest, ChunkBoundariesAreInvisible) {
+  const std::string doc =
+      "d8:announce17:http://x/announce4:infod6:lengthi-12345e4:name11:hello "
+      "world6:pieces20:ABCDEFGHIJKLMNOPQRST5:filesld1:ai1eeleeee";
+  RecordingHandler expected;
+  BencodeParser(doc).parse(expected);
+
+  for (size_t size : {1u, 2u, 3u, 7u, 64u, 1000u}) {
+    RecordingHandler handler;
+    BencodePushParser parser(handler);
+    EXPECT_TRUE(FeedInChunks(parser, doc, size)) << "chunk size " << size;
+    EXPECT_NO_THROW(parser.finish());
+    EXPECT_EQ(handler.events, expected.events) << "chunk size " << size;
+    EXPECT_EQ(parser.position(), doc.size());
+  }
+}
+
+// Test completion is reported only once the top-level value closes
+TEST(BencodePushParserTest, ReportsCompletion) {
+  RecordingHandler handler;
+  BencodePushParser parser(handler);
+  EXPECT_FALSE(parser.feed("d4:name"));
+  EXPECT_FALSE(parser.complete());
+  EXPECT_THROW(parser.finish(), std::out_of_range);
+  EXPECT_FALSE(parser.feed("5:hel"));
+  EXPECT_FALSE(parser.feed("lo"));
+  EXPECT_TRUE(parser.feed("etrailing"));
+  EXPECT_TRUE(parser.complete());
+  EXPECT_EQ(parser.position(), 15u);
+  // Later input is ignored
+  EXPECT_TRUE(parser.feed("garbage"));
+  EXPECT_EQ(handler.events,
+            (std::vector<std::string>{"{", "k:name", "s:hello", "}"}));
+}
+
+// Test Skip and Stop behave as in BencodeParser across chunk boundaries
+TEST(BencodePushParserTest, SkipAndStop) {
+  RecordingHandler skipper;
+  skipper.skip_key = "pieces";
+  BencodePushParser parser(skipper);
+  EXPECT_TRUE(
+      FeedInChunks(parser, "d6:lengthi5e6:piecesld1:ai1eee4:zzzz1:ze", 3));
+  EXPECT_EQ(skipper.events,
+            (std::vector<std::string>{"{", "k:length", "i:5", "k:pieces",
+                                      "k:zzzz", "s:z", "}"}));
+
+  class FirstKeyOnly : public BencodeHandler {
+  public:
+    BencodeAction onKey(std::string_view) override {
+      return BencodeAction::Stop;
+    }
+  } stopper;
+  BencodePushParser stopping(stopper);
+  EXPECT_FALSE(stopping.feed("d8:annou"));
+  EXPECT_TRUE(stopping.feed("nce!!!garbage"));
+  EXPECT_TRUE(stopping.stopped());
+}
+
+// Test malformed input and limits are reported as soon as they are seen
+TEST(BencodePushParserTest, ErrorsAndLimits) {
+  BencodeHandler handler;
+  EXPECT_THROW(BencodePushParser(handler).feed("x"), std::runtime_error);
+  EXPECT_THROW(BencodePushParser(handler).feed("di1ei2ee"),
+               std::runtime_error);
+  EXPECT_THROW(BencodePushParser(handler).feed("d1:ae"), std::runtime_error);
+  EXPECT_THROW(BencodePushParser(handler).feed("i-0e"), std::runtime_error);
+  EXPECT_THROW(BencodePushParser(handler).feed(std::string(64, '1')),
+               std::runtime_error);
+
+  ParseLimits limits;
+  limits.max_string_bytes = 10;
+  // Rejected from the prefix, long before the payload would arrive
+  EXPECT_THROW(BencodePushParser(handler, limits).feed("999999999:"),
+               ParseLimitError);
+  limits.max_depth = 2;
+  EXPECT_THROW(BencodePushParser(handler, limits).feed("lll"),
+               ParseLimitError);
+}
+
+// Test a long string split over many chunks is delivered whole
+TEST(BencodePushParserTest, LongStringAcrossChunks) {
+  const std::string payload(100000, 'x');
+  const std::string doc = "l" + std::to_string(payload.size()) + ":" +
+                          payload + "e";
+
+  class Lengths : public BencodeHandler {
+  public:
+    BencodeAction onString(std::string_view value) override {
+      length = value.size();
+      return BencodeAction::Continue;
+    }
+    size_t length = 0;
+  } handler;
+  BencodePushParser parser(handler);
+  EXPECT_TRUE(FeedInChunks(parser, doc, 4096));
+  EXPECT_EQ(handler.length, payload.size());
+}
+
+// Test skipped strings are dropped as they arrive rather than carried whole
+TEST(BencodePushParserTest, SkippedStringsAreNotCarried) {
+  const std::string payload(100000, 'x');
+  const std::string pieces = std::to_string(payload.size()) + ":" + payload;
+  const std::string doc =
+      "d6:pieces" + pieces + "4:skipd1:l" + pieces + "e4:zzzz1:ze";
+
+  // Skips the value of "pieces" and every nested dictionary
+  class SkipDicts : public RecordingHandler {
+  public:
+    BencodeAction onDictBegin() override {
+      RecordingHandler::onDictBegin();
+      return events.size() > 1 ? BencodeAction::Skip
+                               : BencodeAction::Continue;
+    }
+  } skipper;
+  skipper.skip_key = "pieces";
+  BencodePushParser skipping(skipper);
+  bool done = false;
+  for (size_t i = 0; i < doc.size() && !done; i += 1000) {
+    done = skipping.feed(std::string_view(doc).substr(i, 1000));
+    EXPECT_LT(skipping.carried(), 16u) << "at byte " << i;
+  }
+  EXPECT_TRUE(done);
+  EXPECT_EQ(skipping.position(), doc.size());
+  EXPECT_EQ(skipper.events,
+            (std::vector<std::string>{"{", "k:pieces", "k:skip", "{",
+                                      "k:zzzz", "s:z", "}"}));
+
+  // A lying length prefix on a skipped value is never buffered either
+  RecordingHandler liar;
+  liar.skip_key = "pieces";
+  BencodePushParser parser(liar);
+  EXPECT_FALSE(parser.feed("d6:pieces999999999999:"));
+  EXPECT_FALSE(parser.feed(std::string(4096, 'x')));
+  EXPECT_EQ(parser.carried(), 0u);
+  EXPECT_THROW(parser.finish(), std::out_of_range);
+}
+
+// Test a released carry is taken from the caller's next chunk instead, so
+// the string view points into that chunk
+TEST(BencodePushParserTest, ReleasedCarryComesFromNextChunk) {
+  class Views : public BencodeHandler {
+  public:
+    BencodeAction onString(std::string_view value) override {
+      view = value;
+      return BencodeAction::Continue;
+    }
+    std::string_view view;
+  } handler;
+  BencodePushParser parser(handler);
+  EXPECT_FALSE(parser.feed("l4:sp"));
+  EXPECT_EQ(parser.carried(), 4u);
+  EXPECT_EQ(parser.pending(), 6u);
+  parser.releaseCarry();
+  EXPECT_EQ(parser.pending(), 0u);
+  const std::string rest = "4:spame";
+  EXPECT_TRUE(parser.feed(rest));
+  EXPECT_EQ(handler.view, "spam");
+  EXPECT_EQ(handler.view.data(), rest.data() + 2);
+  EXPECT_EQ(parser.position(), 8u);
+}
+
+// --- Policy instantiations ---
+
+// Test lenient integers accept non-canonical forms but not garbage
+TEST(BencodeParserPolicyTest, LenientIntegers) {
+  RecordingHandler handler;
+  EXPECT_THROW(BencodeParser("i007e").parse(handler), std::runtime_error);
+  EXPECT_THROW(BencodeParser("i-0e").parse(handler), std::runtime_error);
+
+  EXPECT_TRUE(LenientBencodeParser("li007ei-0e03:abce").parse(handler));
+  EXPECT_EQ(handler.events,
+            (std::vector<std::string>{"[", "i:7", "i:0", "s:abc", "]"}));
+  EXPECT_THROW(LenientBencodeParser("i12x4e").parse(handler),
+               std::runtime_error);
+  EXPECT_THROW(LenientBencodeParser("i99999999999999999999e").parse(handler),
+               std::runtime_error);
+  EXPECT_THROW(LenientBencodeParser("ie").parse(handler), std::runtime_error);
+  // Bounds are still checked
+  EXPECT_THROW(LenientBencodeParser("9:abc").parse(handler),
+               std::runtime_error);
+}
+
+// Test the unchecked parser reads valid documents like the strict one
+TEST(BencodeParserPolicyTest, TrustedMatchesStrict) {
+  const std::string doc = "d4:listli1e1:xe4:named1:ai-2eee";
+  RecordingHandler strict, trusted;
+  BencodeParser checked(doc);
+  TrustedBencodeParser unchecked(doc);
+  EXPECT_TRUE(checked.parse(strict));
+  EXPECT_TRUE(unchecked.parse(trusted));
+  EXPECT_EQ(trusted.events, strict.events);
+  EXPECT_EQ(unchecked.position(), checked.position());
+}
+
+// Test validation reports where and why a document is malformed
+TEST(BencodeValidateTest, ReportsKindAndOffset) {
+  EXPECT_EQ(validateBencode("d4:name5:helloe").value(), 15u);
+  EXPECT_EQ(validateBencode("i1eXYZ").value(), 3u); // trailing bytes ignored
+
+  const auto error = [](std::string_view doc, ParseLimits limits = {}) {
+    const auto result = validateBencode(doc, limits);
+    EXPECT_FALSE(result.has_value()) << doc;
+    return result ? ParseError{ParseErrorKind::Io, 0, {}} : result.error();
+  };
+  struct Case {
+    std::string_view doc;
+    ParseErrorKind kind;
+    size_t offset;
+  };
+  for (const auto &[doc, kind, offset] : std::initializer_list<Case>{
+           {"", ParseErrorKind::EmptyInput, 0},
+           {"d4:name5:hel", ParseErrorKind::StringOutOfBounds, 7},
+           {"d4:namei12", ParseErrorKind::UnexpectedEnd, 7},
+           {"d4:name", ParseErrorKind::UnexpectedEnd, 7},
+           {"li1ei01ee", ParseErrorKind::InvalidInteger, 4},
+           {"li-0ee", ParseErrorKind::InvalidInteger, 1},
+           {"l4x:abce", ParseErrorKind::InvalidLength, 1},
+           {"l-1:ae", ParseErrorKind::UnknownType, 1},
+           {"di1ei2ee", ParseErrorKind::KeyNotString, 1},
+           {"d1:ae", ParseErrorKind::MissingValue, 4},
+           {"lxe", ParseErrorKind::UnknownType, 1},
+       }) {
+    const ParseError e = error(doc);
+    EXPECT_EQ(e.kind, kind) << doc;
+    EXPECT_EQ(e.offset, offset) << doc;
+  }
+  EXPECT_EQ(error("d4:name5:hel").message(),
+            "String content out of bounds at position 7");
+
+  ParseLimits limits;
+  limits.max_depth = 2;
+  EXPECT_EQ(error("llleee", limits).kind, ParseErrorKind::LimitExceeded);
+  EXPECT_EQ(error("llleee", limits).offset, 2u);
+  limits = {};
+  limits.max_string_bytes = 4;
+  EXPECT_EQ(error("l2:ab3:abce", limits).offset, 5u);
+
+  // Lenient integers
+  EXPECT_TRUE(validateBencode("li007ei-0ee", {}, false).has_value());
+  EXPECT_FALSE(validateBencode("li1x2ee", {}, false).has_value());
+}
+
+// Test the from_chars conversions reject what std::stoll let through
+TEST(BencodeValidateTest, ReadsNumbersWithoutThrowing) {
+  long long value = 0;
+  EXPECT_TRUE(readBencodeInteger("-42", value));
+  EXPECT_EQ(value, -42);
+  EXPECT_FALSE(readBencodeInteger("+1", value));
+  EXPECT_FALSE(readBencodeInteger(" 1", value));
+  EXPECT_FALSE(readBencodeInteger("", value));
+  EXPECT_FALSE(readBencodeInteger("9223372036854775808", value));
+  EXPECT_TRUE(readBencodeInteger("007", value, false));
+  EXPECT_EQ(value, 7);
+
+  size_t length = 0;
+  EXPECT_TRUE(readBencodeLength("12", length));
+  EXPECT_EQ(length, 12u);
+  EXPECT_FALSE(readBencodeLength("-1", length));
+  EXPECT_FALSE(readBencodeLength("99999999999999999999999", length));
+  RecordingHandler handler;
+  EXPECT_THROW(BencodeParser("+3:abc").parse(handler), std::runtime_error);
+}
+
+// Test owned strings survive the source buffer
+TEST(BencodeParserPolicyTest, OwnedStringsOutliveSource) {
+  class Collector : public BencodeHandler {
+  public:
+    BencodeAction onString(std::string_view value) override {
+      values.push_back(value);
+      return BencodeAction::Continue;
+    }
+    BencodeAction onKey(std::string_view key) override {
+      values.push_back(key);
+      return BencodeAction::Continue;
+    }
+    std::vector<std::string_view> values;
+  } collector;
+
+  std::pmr::monotonic_buffer_resource arena;
+  auto source = std::make_unique<std::string>("d4:name5:helloe");
+  OwningBencodeParser parser(*source, {}, OwnedStrings(&arena));
+  EXPECT_TRUE(parser.parse(collector));
+  const char *begin = source->data();
+  const char *end = begin + source->size();
+  source.reset();
+
+  ASSERT_EQ(collector.values.size(), 2u);
+  EXPECT_EQ(collector.values[0], "name");
+  EXPECT_EQ(collector.values[1], "hello");
+  for (const auto value : collector.values)
+    EXPECT_TRUE(value.data() < begin || value.data() >= end);
+}
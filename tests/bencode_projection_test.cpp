@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "bencode_projection.h"
+#include "torrent_reader.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const std::string kTorrent =
+    "d8:announce10:http://t/a"
+    "4:infod5:filesl"
+    "d6:lengthi10e4:pathl1:aee"
+    "d6:lengthi20e4:pathl1:bee"
+    "e4:name4:demo12:piece lengthi16384e6:pieces20:aaaaaaaaaaaaaaaaaaaa"
+    "e8:url-listl5:http:ee";
+
+// Project `paths` out of `doc` and print the resulting tree
+std::string Project(const std::string& doc, const std::vector<KeyPath>& paths,
+                     size_t* consumed = nullptr) {
+    TorrentTreeBuilder builder;
+    ProjectionHandler projection(paths, builder);
+    BencodeParser parser(doc);
+    parser.parse(projection);
+    if (consumed)
+        *consumed = parser.position();
+    std::ostringstream out;
+    out << builder.result();
+    return out.str();
+}
+
+// Records every event that reaches it
+class EventLog : public BencodeHandler {
+public:
+    BencodeAction onInt(long long v) override { return log("i" + std::to_string(v)); }
+    BencodeAction onString(std::string_view v) override { return log("s" + std::string(v)); }
+    BencodeAction onListBegin() override { return log("["); }
+    BencodeAction onListEnd() override { return log("]"); }
+    BencodeAction onDictBegin() override { return log("{"); }
+    BencodeAction onKey(std::string_view k) override { return log("k" + std::string(k)); }
+    BencodeAction onDictEnd() override { return log("}"); }
+
+    std::string events;
+
+private:
+    BencodeAction log(const std::string& event) {
+        events += event + " ";
+        return BencodeAction::Continue;
+    }
+};
+
+} // namespace
+
+// Test only the requested paths and their ancestors are built
+TEST(BencodeProjectionTest, KeepsRequestedPaths) {
+    EXPECT_EQ(Project(kTorrent, {{"info", "name"}, {"info", "piece length"}}),
+              "{\"info\": {\"name\": \"demo\", \"piece length\": 16384}}");
+    EXPECT_EQ(Project(kTorrent, {{"announce"}}), "{\"announce\": \"http://t/a\"}");
+}
+
+// Test "*" selects a field from every list element
+TEST(BencodeProjectionTest, WildcardListElements) {
+    EXPECT_EQ(Project(kTorrent, {{"info", "files", "*", "length"}}),
+              "{\"info\": {\"files\": [{\"length\": 10}, {\"length\": 20}]}}");
+    EXPECT_EQ(Project(kTorrent, {{"url-list", "*"}}),
+              "{\"url-list\": [\"http:\"]}");
+}
+
+// Test a requested container is kept whole
+TEST(BencodeProjectionTest, KeepsWholeSubtrees) {
+    EXPECT_EQ(Project(kTorrent, {{"info", "files"}, {"info", "files", "*", "length"}}),
+              "{\"info\": {\"files\": [{\"length\": 10, \"path\": [\"a\"]}, "
+              "{\"length\": 20, \"path\": [\"b\"]}]}}");
+}
+
+// Test skipped subtrees never reach the target
+TEST(BencodeProjectionTest, SkippedValuesProduceNoEvents) {
+    EventLog log;
+    ProjectionHandler projection({{"info", "name"}}, log);
+    BencodeParser(kTorrent).parse(projection);
+    EXPECT_EQ(log.events, "{ kinfo { kname sdemo } } ");
+}
+
+// Test the parse stops once every path has been seen
+TEST(BencodeProjectionTest, StopsEarly) {
+    size_t consumed = 0;
+    Project(kTorrent, {{"announce"}}, &consumed);
+    EXPECT_EQ(consumed, kTorrent.find("4:info"));
+
+    // A wildcard is finished when its list ends
+    Project(kTorrent, {{"info", "files", "*", "length"}}, &consumed);
+    EXPECT_EQ(consumed, kTorrent.find("4:name"));
+
+    // A missing key is known to be absent once its dictionary closes
+    Project(kTorrent, {{"info", "private"}}, &consumed);
+    EXPECT_EQ(consumed, kTorrent.find("8:url-list"));
+}
+
+// Test paths through values of the wrong type match nothing
+TEST(BencodeProjectionTest, TypeMismatchesMatchNothing) {
+    // Containers on the way are still kept
+    EXPECT_EQ(Project(kTorrent, {{"announce", "x"}, {"info", "name", "*"}}),
+              "{\"info\": {}}");
+    EXPECT_EQ(Project(kTorrent, {{"missing"}}), "{}");
+}
+
+// Test an empty path selects the whole document
+TEST(BencodeProjectionTest, EmptyPathKeepsEverything) {
+    TorrentTreeBuilder builder;
+    BencodeParser(kTorrent).parse(builder);
+    std::ostringstream all;
+    all << builder.result();
+    EXPECT_EQ(Project(kTorrent, {{}}), all.str());
+}
+
+// Test TorrentReader applies a projection to files and streams
+TEST(BencodeProjectionTest, TorrentReaderProjection) {
+    TorrentReaderOptions options;
+    options.projection = {{"info", "name"}, {"info", "files", "*", "length"}};
+    options.lazy = true; // ignored in favour of the projection
+    const std::string expected =
+        "{\"info\": {\"files\": [{\"length\": 10}, {\"length\": 20}], \"name\": \"demo\"}}";
+
+    std::istringstream stream(kTorrent);
+    TorrentReader streamed(stream, options);
+    std::ostringstream a;
+    a << streamed.getRoot();
+    EXPECT_EQ(a.str(), expected);
+
+    const auto path = std::filesystem::temp_directory_path() / "projection_test.torrent";
+    std::ofstream(path, std::ios::binary) << kTorrent;
+    TorrentReader mapped(path.string(), options);
+    std::ostringstream b;
+    b << mapped.getRoot();
+    EXPECT_EQ(b.str(), expected);
+    EXPECT_TRUE(mapped.isValidTorrent());
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+#include "content_hash.h"
+#include <string>
+
+// Test contentHash is XXH64
+TEST(ContentHashTest, MatchesReferenceValues) {
+    EXPECT_EQ(contentHash(""), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(contentHash("abc"), 0x44BC2CF5AD770999ULL);
+    // Inputs of 32 bytes and more take the four-lane path
+    const std::string long_input(100, 'x');
+    EXPECT_NE(contentHash(long_input), contentHash(long_input, 1));
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
+#include "archive_util.h"
 #include "file_browser.h"
+#include "torrent_archive.h"
 #include <filesystem>
 #include <fstream>
 
@@ -245,3 +247,72 @@ TEST_F(FileBrowserTest, EmptyDirectoryShowsNoEntries) {
   FileBrowser fb(empty_dir.string());
   EXPECT_EQ(fb.Entries().size(), 0u);
 }
+
+// --- Compressed and archived torrents ---
+
+TEST_F(FileBrowserTest, ListsCompressedTorrentsAndArchives) {
+  if (!gzip_supported)
+    GTEST_SKIP() << "gzip is not supported by this build";
+  const fs::path dir = test_dir_ / "bundles";
+  fs::create_directories(dir);
+  CreateFile(dir / "packed.torrent.gz", GzipCompress("d4:infodee"));
+  CreateFile(dir / "bundle.tar", MakeTar({{"x.torrent", "d4:infodee"}}));
+  CreateFile(dir / "notes.txt.gz", GzipCompress("hello"));
+
+  FileBrowser fb(dir.string());
+  const auto &entries = fb.Entries();
+  ASSERT_EQ(entries.size(), 2u);
+  // The archive sorts with the directories
+  EXPECT_EQ(entries[0].name, "bundle.tar");
+  EXPECT_TRUE(entries[0].is_directory);
+  EXPECT_TRUE(entries[0].is_archive);
+  EXPECT_EQ(entries[1].name, "packed.torrent.gz");
+  EXPECT_FALSE(entries[1].is_archive);
+}
+
+TEST_F(FileBrowserTest, EnterArchiveListsMembers) {
+  if (!gzip_supported)
+    GTEST_SKIP() << "gzip is not supported by this build";
+  const fs::path dir = test_dir_ / "bundles";
+  fs::create_directories(dir);
+  const fs::path archive = dir / "bundle.tar.gz";
+  CreateFile(archive, GzipCompress(MakeTar({
+                          {"2024/", ""},
+                          {"2024/b.torrent", "d4:infodee"},
+                          {"a.torrent", "d4:infodee"},
+                          {"readme.txt", "hello"},
+                      })));
+
+  FileBrowser fb(dir.string());
+  ASSERT_EQ(fb.Entries().size(), 1u);
+  EXPECT_TRUE(fb.Enter(0));
+  EXPECT_EQ(fb.CurrentDir(),
+            archiveMemberPath(fs::absolute(archive).string(), ""));
+
+  const auto &members = fb.Entries();
+  ASSERT_EQ(members.size(), 2u);
+  EXPECT_EQ(members[0].name, "2024/b.torrent");
+  EXPECT_EQ(members[1].name, "a.torrent");
+  EXPECT_EQ(members[1].full_path,
+            archiveMemberPath(fs::absolute(archive).string(), "a.torrent"));
+
+  // Members are selectable files like any other
+  EXPECT_TRUE(fb.ToggleSelect(1));
+  ASSERT_EQ(fb.SelectedPaths().size(), 1u);
+  EXPECT_EQ(fb.SelectedPaths()[0], members[1].full_path);
+
+  // Going up leaves the archive
+  EXPECT_TRUE(fb.GoUp());
+  EXPECT_EQ(fs::path(fb.CurrentDir()), fs::absolute(dir));
+}
+
+TEST_F(FileBrowserTest, CorruptArchiveListsNothing) {
+  const fs::path dir = test_dir_ / "bundles";
+  fs::create_directories(dir);
+  CreateFile(dir / "broken.tar", std::string(1024, 'x'));
+
+  FileBrowser fb(dir.string());
+  ASSERT_EQ(fb.Entries().size(), 1u);
+  EXPECT_TRUE(fb.Enter(0));
+  EXPECT_TRUE(fb.Entries().empty());
+}
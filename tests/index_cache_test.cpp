@@ -0,0 +1,300 @@
+#include <gtest/gtest.h>
+#include "index_cache.h"
+#include "torrent_reader.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string kTorrent =
+    "d8:announce10:http://t/a4:infod5:filesl"
+    "d6:lengthi10e4:pathl1:aee"
+    "d6:lengthi20e4:pathl1:bee"
+    "e4:name4:demo12:piece lengthi16384ee8:url-listl5:http:ee";
+
+std::string Print(const TorrentReader& reader) {
+    std::ostringstream out;
+    out << reader.getRoot();
+    return out.str();
+}
+
+} // namespace
+
+class IndexCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = fs::temp_directory_path() / "index_cache_test";
+        fs::remove_all(dir_);
+        fs::create_directories(dir_);
+        cache_dir_ = (dir_ / "cache").string();
+        source_path_ = (dir_ / "demo.torrent").string();
+        Write(kTorrent);
+    }
+
+    void TearDown() override { fs::remove_all(dir_); }
+
+    void Write(const std::string& content) {
+        std::ofstream(source_path_, std::ios::binary) << content;
+    }
+
+    // Index the current file contents and store them in the cache
+    void Store() {
+        const std::string content = Read();
+        StructuralIndex index(content);
+        IndexCache(cache_dir_).store(source_path_, content, index);
+    }
+
+    std::string Read() {
+        std::ifstream in(source_path_, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), {}};
+    }
+
+    bool Hit() {
+        const std::string content = Read();
+        MappedFile storage;
+        return IndexCache(cache_dir_).load(source_path_, content, storage) != nullptr;
+    }
+
+    fs::path dir_;
+    std::string cache_dir_;
+    std::string source_path_;
+};
+
+// Test a stored snapshot loads back as the same index
+TEST_F(IndexCacheTest, LoadsStoredIndex) {
+    EXPECT_FALSE(Hit());
+    Store();
+    EXPECT_TRUE(fs::exists(IndexCache(cache_dir_).entryPath(source_path_)));
+
+    MappedFile storage;
+    const std::string content = Read();
+    const StructuralIndex built(content);
+    const auto loaded = IndexCache(cache_dir_).load(source_path_, content, storage);
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_EQ(loaded->size(), built.size());
+    for (size_t node = 0; node < built.size(); ++node) {
+        EXPECT_EQ((*loaded)[node].begin, built[node].begin);
+        EXPECT_EQ((*loaded)[node].end, built[node].end);
+        EXPECT_EQ(loaded->next(node), built.next(node));
+    }
+    EXPECT_EQ(loaded->stats().max_depth, built.stats().max_depth);
+    EXPECT_EQ(loaded->stats().nodes, built.stats().nodes);
+    EXPECT_EQ(loaded->stats().string_bytes, built.stats().string_bytes);
+    EXPECT_EQ(loaded->bitmap().nextColon(0), built.bitmap().nextColon(0));
+}
+
+// Test any change to the source invalidates its entry
+TEST_F(IndexCacheTest, InvalidatesChangedSource) {
+    const auto mtime = fs::last_write_time(source_path_);
+
+    // Same size and timestamp, different bytes
+    Store();
+    std::string changed = kTorrent;
+    changed[changed.find("demo")] = 'm';
+    Write(changed);
+    fs::last_write_time(source_path_, mtime);
+    EXPECT_FALSE(Hit());
+
+    // Different size
+    Write(kTorrent);
+    Store();
+    Write("d4:infod4:name5:othereee");
+    EXPECT_FALSE(Hit());
+
+    // Only the timestamp moved
+    Write(kTorrent);
+    Store();
+    EXPECT_TRUE(Hit());
+    fs::last_write_time(source_path_, mtime - std::chrono::hours(1));
+    EXPECT_FALSE(Hit());
+}
+
+// Test damaged entries are ignored rather than trusted
+TEST_F(IndexCacheTest, IgnoresCorruptEntries) {
+    Store();
+    const std::string entry = IndexCache(cache_dir_).entryPath(source_path_);
+    std::string bytes;
+    {
+        std::ifstream in(entry, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+
+    std::string flipped = bytes;
+    flipped[flipped.size() - 1] ^= 0x40;
+    std::ofstream(entry, std::ios::binary | std::ios::trunc) << flipped;
+    EXPECT_FALSE(Hit());
+
+    std::ofstream(entry, std::ios::binary | std::ios::trunc) << bytes.substr(0, bytes.size() / 2);
+    EXPECT_FALSE(Hit());
+
+    std::ofstream(entry, std::ios::binary | std::ios::trunc) << bytes;
+    EXPECT_TRUE(Hit());
+}
+
+// Test well-hashed snapshots whose containers do not fit the source are
+// ignored
+TEST_F(IndexCacheTest, IgnoresImplausibleContainers) {
+    const std::string content = Read();
+    const StructuralIndex built(content);
+    const auto forge = [&](auto change) {
+        std::vector<StructuralIndex::Container> nodes(built.containers().begin(),
+                                                      built.containers().end());
+        change(nodes);
+        const StructuralIndex forged(
+            content, nodes,
+            StructuralBitmap::borrow(content.size(), built.bitmap().words()),
+            built.stats());
+        IndexCache(cache_dir_).store(source_path_, content, forged);
+        return Hit();
+    };
+    using Nodes = std::vector<StructuralIndex::Container>;
+    EXPECT_TRUE(forge([](Nodes&) {}));
+    EXPECT_FALSE(forge([&](Nodes& n) { n[1].end = content.size() + 1; }));
+    EXPECT_FALSE(forge([](Nodes& n) { n[1].begin = n[1].end; }));
+    EXPECT_FALSE(forge([](Nodes& n) { ++n[1].begin; }));        // not at a 'd' or 'l'
+    EXPECT_FALSE(forge([](Nodes& n) { std::swap(n[1], n[2]); })); // out of preorder
+    EXPECT_FALSE(forge([](Nodes& n) { n[0].descendants = n.size(); }));
+    EXPECT_FALSE(forge([](Nodes& n) { n[1].end = n[2].end - 1; }));
+    EXPECT_FALSE(forge([](Nodes& n) { n.clear(); }));            // root missing
+}
+
+// Test the delimiter bitmap is rebuilt from the source, not taken from the
+// snapshot
+TEST_F(IndexCacheTest, RebuildsBitmap) {
+    const std::string content = Read();
+    const StructuralIndex built(content);
+    const std::vector<uint64_t> blank(built.bitmap().words().size(), 0);
+    const StructuralIndex forged(content, built.containers(),
+                                 StructuralBitmap::borrow(content.size(), blank),
+                                 built.stats());
+    IndexCache(cache_dir_).store(source_path_, content, forged);
+
+    MappedFile storage;
+    const auto loaded = IndexCache(cache_dir_).load(source_path_, content, storage);
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_TRUE(std::ranges::equal(loaded->bitmap().words(), built.bitmap().words()));
+}
+
+// Test contents a forged snapshot vouched for fail to materialize with an
+// error instead of being trusted
+TEST_F(IndexCacheTest, MalformedContentsBehindForgedSnapshot) {
+    Write("d1:ai01ee");
+    const std::string content = Read();
+    const std::vector<StructuralIndex::Container> nodes{{0, content.size(), 0}};
+    const StructuralIndex forged(content, nodes, StructuralBitmap(content),
+                                 {1, 3, 1});
+    IndexCache(cache_dir_).store(source_path_, content, forged);
+    ASSERT_TRUE(Hit());
+
+    TorrentReaderOptions options;
+    options.lazy = true;
+    options.cache_dir = cache_dir_;
+    const auto parsed = TorrentReader::parse(source_path_, options);
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_TRUE(parsed->getRoot().isLazy());
+    EXPECT_THROW(parsed->getRoot().asDict(), std::runtime_error);
+    EXPECT_TRUE(parsed->getRoot().isLazy());
+    EXPECT_FALSE(parsed->isValidTorrent());
+}
+
+// Test a forged snapshot that leaves nested containers out throws on
+// materialize instead of reading past the containers it lists
+TEST_F(IndexCacheTest, MissingContainersBehindForgedSnapshot) {
+    std::string doc = "d1:al";
+    for (int i = 0; i < 163; ++i)
+        doc += "le";
+    doc += "e1:bllleeee";
+    Write(doc);
+    const std::string content = Read();
+    const StructuralIndex built(content);
+    // root, a, 163 lists in a, b, b's list, the list inside that
+    ASSERT_EQ(built.size(), 168u);
+    TorrentReaderOptions options;
+    options.lazy = true;
+    options.cache_dir = cache_dir_;
+    for (const size_t left_out : {166u, 167u}) {
+        std::vector<StructuralIndex::Container> nodes(built.containers().begin(),
+                                                      built.containers().end());
+        nodes.erase(nodes.begin() + left_out);
+        --nodes[0].descendants;
+        --nodes[165].descendants;
+        if (left_out == 167)
+            --nodes[166].descendants;
+        const StructuralIndex forged(content, nodes, StructuralBitmap(content),
+                                     built.stats());
+        IndexCache(cache_dir_).store(source_path_, content, forged);
+        ASSERT_TRUE(Hit());
+
+        TorrentReader reader(source_path_, options);
+        const TorrentValue& b = reader.getRoot().asDict().at("b");
+        EXPECT_THROW(b.asList().front().asList(), std::runtime_error);
+    }
+}
+
+// Test the info-hash span does not trust a snapshot that left the info
+// dictionary out
+TEST_F(IndexCacheTest, InfoSpanIgnoresMissingContainer) {
+    const std::string content = Read();
+    const StructuralIndex built(content);
+    std::vector<StructuralIndex::Container> nodes(built.containers().begin(),
+                                                  built.containers().end());
+    ASSERT_EQ(content[nodes[1].begin], 'd'); // info
+    nodes.erase(nodes.begin() + 1);
+    --nodes[0].descendants;
+    const StructuralIndex forged(content, nodes, StructuralBitmap(content),
+                                 built.stats());
+    IndexCache(cache_dir_).store(source_path_, content, forged);
+    ASSERT_TRUE(Hit());
+
+    TorrentReaderOptions options;
+    options.lazy = true;
+    options.cache_dir = cache_dir_;
+    const TorrentReader reader(source_path_, options);
+    EXPECT_EQ(reader.infoBytes(), TorrentReader(source_path_).infoBytes());
+}
+
+// Test TorrentReader fills and then uses the cache, with identical results
+TEST_F(IndexCacheTest, ReaderReopensFromCache) {
+    TorrentReaderOptions options;
+    options.lazy = true;
+    const std::string expected = Print(TorrentReader(source_path_, options));
+
+    options.cache_dir = cache_dir_;
+    EXPECT_EQ(Print(TorrentReader(source_path_, options)), expected);
+    EXPECT_TRUE(Hit());
+    EXPECT_EQ(Print(TorrentReader(source_path_, options)), expected);
+
+    options.lazy = false;
+    options.threads = 2;
+    EXPECT_EQ(Print(TorrentReader(source_path_, options)), expected);
+
+    // A changed file is parsed afresh
+    Write("d4:infod4:name5:othereee");
+    options.lazy = true;
+    EXPECT_EQ(Print(TorrentReader(source_path_, options)),
+              "{\"info\": {\"name\": \"other\"}}");
+}
+
+// Test limits still apply when the index comes from the cache
+TEST_F(IndexCacheTest, ReaderEnforcesLimitsOnCachedIndex) {
+    TorrentReaderOptions options;
+    options.lazy = true;
+    options.cache_dir = cache_dir_;
+    TorrentReader first(source_path_, options);
+    ASSERT_TRUE(Hit());
+
+    options.limits.max_depth = 2;
+    EXPECT_THROW(TorrentReader(source_path_, options), ParseLimitError);
+    options.limits = {};
+    options.limits.max_string_bytes = 8;
+    EXPECT_THROW(TorrentReader(source_path_, options), ParseLimitError);
+    const auto parsed = TorrentReader::parse(source_path_, options);
+    ASSERT_FALSE(parsed.has_value());
+    EXPECT_EQ(parsed.error().kind, ParseErrorKind::LimitExceeded);
+    options.limits = {};
+    EXPECT_TRUE(TorrentReader::parse(source_path_, options).has_value());
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include "meta_key.h"
+#include <string>
+
+// Test well-known keys carry their MetaKey and point at the static names
+TEST(TorrentKeyTest, WellKnownKeys) {
+  const std::string bytes = "announce";
+  const TorrentKey key(bytes);
+  EXPECT_EQ(key.known(), MetaKey::Announce);
+  EXPECT_EQ(key.str(), "announce");
+  EXPECT_EQ(key.str().data(), metaKeyName(MetaKey::Announce).data());
+  EXPECT_EQ(TorrentKey("infos").known(), MetaKey::Unknown);
+  // A key looked up already is taken as is
+  const TorrentKey looked_up(bytes, MetaKey::Announce);
+  EXPECT_EQ(looked_up.str().data(), key.str().data());
+  EXPECT_EQ(looked_up, key);
+}
+
+// Test other keys borrow their bytes rather than copying them
+TEST(TorrentKeyTest, OtherKeysBorrowBytes) {
+  const std::string bytes = "x-custom";
+  const TorrentKey key(bytes);
+  EXPECT_EQ(key.known(), MetaKey::Unknown);
+  EXPECT_EQ(key.str().data(), bytes.data());
+  EXPECT_EQ(key.str().size(), bytes.size());
+}
+
+// Test keys compare equal exactly when their bytes do
+TEST(TorrentKeyTest, Equality) {
+  const std::string copy = "announce";
+  const TorrentKey a("announce");
+  const TorrentKey b(copy);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a, "announce");
+  EXPECT_EQ(std::string(a), "announce");
+  EXPECT_NE(a, TorrentKey("announce-list"));
+  EXPECT_EQ(TorrentKey("md5sum2"), TorrentKey(std::string("md5sum2")));
+  EXPECT_NE(TorrentKey("md5sum2"), TorrentKey("md5sum3"));
+  EXPECT_EQ(TorrentKey().str(), "");
+  EXPECT_EQ(TorrentKey(""), TorrentKey());
+  static_assert(sizeof(TorrentKey) == 16);
+}
+
+// Test the perfect hash resolves every known key and nothing else
+TEST(MetaKeyTest, ResolvesKnownKeys) {
+  for (size_t i = 1; i <= metakey_detail::names.size(); ++i) {
+    const auto key = static_cast<MetaKey>(i);
+    EXPECT_EQ(metaKey(metaKeyName(key)), key) << metaKeyName(key);
+  }
+  EXPECT_EQ(metaKey(""), MetaKey::Unknown);
+  EXPECT_EQ(metaKey("lengths"), MetaKey::Unknown);
+  EXPECT_EQ(metaKey("Info"), MetaKey::Unknown);
+  static_assert(metaKey("pieces") == MetaKey::Pieces);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "piece_hash_index.h"
+#include "torrent_creator.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> Digests(const std::vector<std::string>& digests) {
+    std::vector<unsigned char> bytes;
+    for (const auto& digest : digests)
+        bytes.insert(bytes.end(), digest.begin(), digest.end());
+    return bytes;
+}
+
+std::span<const unsigned char> Bytes(const std::string& digest) {
+    return {reinterpret_cast<const unsigned char*>(digest.data()), digest.size()};
+}
+
+} // namespace
+
+// Test lookups, duplicate groups and all-zero digests
+TEST(PieceHashIndexTest, FindsDuplicatesAndZeros) {
+    const std::string a(20, 'a'), b(20, 'b'), c(20, 'c'), zero(20, '\0');
+    const auto bytes = Digests({a, b, a, zero, c, b, a, zero});
+    const PieceHashIndex index(bytes, 20);
+    ASSERT_EQ(index.size(), 8u);
+
+    EXPECT_EQ(index.find(Bytes(a)), 0u);
+    EXPECT_EQ(index.find(Bytes(b)), 1u);
+    EXPECT_EQ(index.find(Bytes(c)), 4u);
+    EXPECT_EQ(index.find(Bytes(zero)), 3u);
+    EXPECT_EQ(index.find(Bytes(std::string(20, 'd'))), PieceHashIndex::npos);
+    EXPECT_EQ(index.find(Bytes(std::string(19, 'a'))), PieceHashIndex::npos);
+
+    const std::vector<std::vector<size_t>> groups{{0, 2, 6}, {1, 5}, {3, 7}};
+    EXPECT_EQ(index.duplicates(), groups);
+    EXPECT_EQ(index.zeroPieces(), (std::vector<size_t>{3, 7}));
+    EXPECT_EQ(index.filePiece(5).file, 0u);
+    EXPECT_EQ(index.filePiece(5).piece, 5u);
+
+    EXPECT_THROW(PieceHashIndex(std::span(bytes).first(30), 20), std::runtime_error);
+}
+
+// Test a large index finds every piece and nothing else
+TEST(PieceHashIndexTest, ScalesToManyPieces) {
+    std::mt19937_64 rng(11);
+    const size_t count = 200000;
+    std::vector<unsigned char> bytes(count * 20);
+    for (auto& byte : bytes)
+        byte = static_cast<unsigned char>(rng());
+    const PieceHashIndex index(bytes, 20);
+    EXPECT_TRUE(index.duplicates().empty());
+    EXPECT_TRUE(index.zeroPieces().empty());
+    for (size_t piece = 0; piece < count; piece += 7)
+        ASSERT_EQ(index.find(index.digest(piece)), piece);
+    std::vector<unsigned char> missing(20);
+    for (int i = 0; i < 1000; ++i) {
+        for (auto& byte : missing)
+            byte = static_cast<unsigned char>(rng());
+        EXPECT_EQ(index.find(missing), PieceHashIndex::npos);
+    }
+}
+
+// Test v1 and v2 indices of a hybrid torrent, and v2 pieces numbered per
+// file the way the verifier numbers them
+TEST(PieceHashIndexTest, IndexesHybridTorrent) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "piece_hash_index_test";
+    fs::create_directories(root / "data");
+    auto write = [&](const std::string& name, size_t size, int salt) {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+            content[i] = static_cast<char>((i * 2654435761u >> 13) + salt);
+        std::ofstream(root / "data" / name, std::ios::binary) << content;
+    };
+    write("a.bin", 40000, 1); // three pieces
+    write("b.bin", 0, 2);
+    write("c.bin", 100, 3); // one piece: its pieces root
+    TorrentCreateOptions options;
+    options.piece_length = 16384;
+    options.hybrid = true;
+    const std::string doc = createTorrent(root / "data", options);
+    fs::remove_all(root);
+
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+
+    const PieceHashIndex v1 = PieceHashIndex::v1(meta);
+    ASSERT_EQ(v1.size(), meta.pieceCount());
+    for (size_t piece = 0; piece < v1.size(); ++piece)
+        EXPECT_EQ(v1.find(meta.piece(piece)), piece);
+    // v1 reads the digests in place
+    EXPECT_EQ(v1.digest(0).data(), meta.pieces().data());
+
+    // v2 owns its digests, and moving keeps them valid
+    PieceHashIndex built = PieceHashIndex::v2(meta);
+    const PieceHashIndex v2 = std::move(built);
+    ASSERT_EQ(v2.size(), 4u);
+    EXPECT_EQ(v2.digestSize(), 32u);
+    const auto& tree = meta.fileTree();
+    ASSERT_EQ(tree.size(), 3u);
+    EXPECT_EQ(v2.find(tree[0].layer.subspan(32, 32)), 1u);
+    EXPECT_EQ(v2.find(tree[2].root), 3u);
+    EXPECT_EQ(v2.filePiece(2).file, 0u);
+    EXPECT_EQ(v2.filePiece(2).piece, 2u);
+    // The empty file has no pieces, so piece 3 is the first of c.bin
+    EXPECT_EQ(v2.filePiece(3).file, 2u);
+    EXPECT_EQ(v2.filePiece(3).piece, 0u);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "piece_map.h"
+#include "tree_util.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string MultiFile(const std::vector<uint64_t>& lengths, uint64_t piece_length) {
+    std::string doc = "d4:infod5:filesl";
+    uint64_t total = 0;
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        const std::string name = std::to_string(i);
+        doc += "d6:lengthi" + std::to_string(lengths[i]) + "e4:pathl" +
+               std::to_string(name.size()) + ":" + name + "ee";
+        total += lengths[i];
+    }
+    const uint64_t pieces = total == 0 ? 0 : (total - 1) / piece_length + 1;
+    doc += "e4:name4:demo12:piece lengthi" + std::to_string(piece_length) +
+           "e6:pieces" + std::to_string(pieces * 20) + ":" +
+           std::string(pieces * 20, 'x') + "ee";
+    return doc;
+}
+
+} // namespace
+
+// Test both directions on files that straddle pieces, with an empty file
+TEST(PieceMapTest, MapsPiecesAndFiles) {
+    const std::string doc = MultiFile({10, 0, 25}, 16);
+    const TorrentValue root = Parse(doc);
+    const PieceMap map{TorrentMetainfo(root)};
+    ASSERT_EQ(map.fileCount(), 3u);
+    ASSERT_EQ(map.pieceCount(), 3u);
+    EXPECT_EQ(map.totalSize(), 35u);
+    EXPECT_EQ(map.fileOffset(2), 10u);
+    EXPECT_EQ(map.fileLength(2), 25u);
+
+    EXPECT_EQ(map.piecesOf(0).first, 0u);
+    EXPECT_EQ(map.piecesOf(0).last, 1u);
+    EXPECT_TRUE(map.piecesOf(1).empty());
+    EXPECT_EQ(map.piecesOf(2).first, 0u);
+    EXPECT_EQ(map.piecesOf(2).last, 3u);
+
+    // Piece 0 ends inside file 2 and holds the empty file between
+    EXPECT_EQ(map.filesOf(0).first, 0u);
+    EXPECT_EQ(map.filesOf(0).last, 3u);
+    EXPECT_EQ(map.filesOf(1).first, 2u);
+    EXPECT_EQ(map.filesOf(1).size(), 1u);
+    EXPECT_EQ(map.filesOf(2).first, 2u);
+    EXPECT_EQ(map.filesOf(2).last, 3u);
+
+    EXPECT_EQ(map.fileAt(9), 0u);
+    EXPECT_EQ(map.fileAt(10), 2u);
+    EXPECT_EQ(map.fileAt(34), 2u);
+}
+
+// Test a single-file torrent is one file holding every piece
+TEST(PieceMapTest, SingleFile) {
+    const std::string doc =
+        "d4:infod6:lengthi100e4:name1:a12:piece lengthi32e6:pieces80:" +
+        std::string(80, 'x') + "ee";
+    const TorrentValue root = Parse(doc);
+    const PieceMap map{TorrentMetainfo(root)};
+    ASSERT_EQ(map.fileCount(), 1u);
+    EXPECT_EQ(map.pieceCount(), 4u);
+    EXPECT_EQ(map.piecesOf(0).size(), 4u);
+    EXPECT_EQ(map.filesOf(3).first, 0u);
+    EXPECT_EQ(map.filesOf(3).last, 1u);
+}
+
+// Test lookups against a linear walk on random layouts with runs of
+// empty files and files spanning many pieces
+TEST(PieceMapTest, MatchesLinearWalk) {
+    std::mt19937 rng(7);
+    for (int round = 0; round < 20; ++round) {
+        std::vector<uint64_t> lengths(1 + rng() % 40);
+        for (auto& length : lengths)
+            length = rng() % 3 == 0 ? 0 : rng() % 200;
+        lengths.back() += 1;
+        const uint64_t piece_length = 1 + rng() % 64;
+        const std::string doc = MultiFile(lengths, piece_length);
+        const TorrentValue root = Parse(doc);
+        const PieceMap map{TorrentMetainfo(root)};
+
+        for (size_t piece = 0; piece < map.pieceCount(); ++piece) {
+            const uint64_t begin = piece * piece_length;
+            const uint64_t end = std::min(begin + piece_length, map.totalSize());
+            const auto files = map.filesOf(piece);
+            uint64_t offset = 0;
+            for (size_t file = 0; file < lengths.size(); ++file) {
+                const uint64_t file_end = offset + lengths[file];
+                const bool overlaps = offset < end && file_end > begin;
+                if (overlaps) {
+                    EXPECT_GE(file, files.first) << round << " " << piece;
+                    EXPECT_LT(file, files.last) << round << " " << piece;
+                    // A file with bytes in the piece lists it in return
+                    if (lengths[file] > 0) {
+                        EXPECT_GE(piece, map.piecesOf(file).first);
+                        EXPECT_LT(piece, map.piecesOf(file).last);
+                    }
+                }
+                offset = file_end;
+            }
+            EXPECT_GT(lengths[files.first], 0u);
+            EXPECT_GT(lengths[files.last - 1], 0u);
+        }
+    }
+}
+
+// Test a zero piece length is refused even when every file is empty, rather
+// than left for piecesOf() to divide by
+TEST(PieceMapTest, RejectsZeroPieceLength) {
+    const std::string doc =
+        "d4:infod5:filesld6:lengthi0e4:pathl1:aeee4:name4:demo"
+        "12:piece lengthi0e6:pieces20:" + std::string(20, 'x') + "ee";
+    const TorrentValue root = Parse(doc);
+    const TorrentMetainfo meta(root);
+    EXPECT_EQ(meta.pieceCount(), 1u);
+    EXPECT_THROW(PieceMap{meta}, std::runtime_error);
+
+    const std::string single =
+        "d4:infod6:lengthi5e4:name1:a12:piece lengthi0e6:pieces20:" +
+        std::string(20, 'x') + "ee";
+    const TorrentValue single_root = Parse(single);
+    EXPECT_THROW(PieceMap{TorrentMetainfo(single_root)}, std::runtime_error);
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "piece_verifier.h"
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+class PieceVerifierTest : public ::testing::Test {
+protected:
+    fs::path root = fs::temp_directory_path() / "piece_verifier_test";
+
+    void SetUp() override { fs::create_directories(root / "demo" / "dir"); }
+    void TearDown() override { fs::remove_all(root); }
+
+    void Write(const fs::path& relative, const std::string& content) {
+        std::ofstream(root / relative, std::ios::binary) << content;
+    }
+
+    // Torrent over `content` cut into `files` (name, length) pieces of 16
+    // bytes, parsed into a tree the metainfo view can borrow
+    TorrentValue MakeTorrent(const std::string& content,
+                             const std::vector<std::pair<std::string, int>>& files) {
+        std::string pieces;
+        for (size_t at = 0; at < content.size(); at += 16) {
+            const auto digest = sha1(std::string_view(content).substr(at, 16));
+            pieces.append(reinterpret_cast<const char*>(digest.data()), digest.size());
+        }
+        std::string doc = "d4:infod5:filesl";
+        for (const auto& [name, length] : files) {
+            doc += "d6:lengthi" + std::to_string(length) + "e4:pathl3:dir" +
+                   std::to_string(name.size()) + ":" + name + "ee";
+        }
+        doc += "e4:name4:demo12:piece lengthi16e6:pieces" +
+               std::to_string(pieces.size()) + ":" + pieces + "ee";
+        document = doc;
+        TorrentTreeBuilder builder;
+        BencodeParser(document).parse(builder);
+        return std::move(builder.result());
+    }
+
+    // v2 torrent with 32 KiB pieces over dir/big, dir/empty and dir/small
+    // (one piece), with the piece layer for big
+    TorrentValue MakeV2Torrent(const std::string& big, const std::string& small) {
+        constexpr size_t piece = 32 << 10;
+        auto bytes = [](const Sha256Digest& digest) {
+            return "32:" + std::string(reinterpret_cast<const char*>(digest.data()), 32);
+        };
+        std::vector<Sha256Digest> layer;
+        std::string layer_bytes;
+        for (size_t at = 0; at < big.size(); at += piece) {
+            layer.push_back(merkleRoot(std::string_view(big).substr(at, piece), 2));
+            layer_bytes += bytes(layer.back()).substr(3);
+        }
+        const Sha256Digest big_root =
+            merkleRoot(layer, std::bit_ceil(layer.size()), merklePad(2));
+        const Sha256Digest small_root = merkleRoot(small, 2);
+        document =
+            "d4:infod9:file treed3:dird"
+            "3:bigd0:d6:lengthi" + std::to_string(big.size()) + "e11:pieces root" +
+            bytes(big_root) + "ee"
+            "5:emptyd0:d6:lengthi0eee"
+            "5:smalld0:d6:lengthi" + std::to_string(small.size()) + "e11:pieces root" +
+            bytes(small_root) + "ee"
+            "ee12:meta versioni2e4:name4:demo12:piece lengthi32768ee"
+            "12:piece layersd" + bytes(big_root) + std::to_string(layer_bytes.size()) +
+            ":" + layer_bytes + "ee";
+        TorrentTreeBuilder builder;
+        BencodeParser(document).parse(builder);
+        return std::move(builder.result());
+    }
+
+    std::string document;
+};
+
+// Test pieces straddling files, empty files and a short last piece
+TEST_F(PieceVerifierTest, VerifiesPiecesAcrossFiles) {
+    std::string content;
+    for (int i = 0; i < 70; ++i)
+        content += static_cast<char>('a' + i % 26);
+    Write("demo/dir/a", content.substr(0, 10));
+    Write("demo/dir/b", "");
+    Write("demo/dir/c", content.substr(10, 30));
+    Write("demo/dir/d", content.substr(40));
+    const TorrentValue root_value = MakeTorrent(content, {{"a", 10}, {"b", 0}, {"c", 30}, {"d", 30}});
+    const TorrentMetainfo meta(root_value);
+
+    PieceVerifier verifier(meta, root, 3);
+    ASSERT_EQ(verifier.pieceCount(), 5u);
+    EXPECT_EQ(verifier.paths()[2], root / "demo" / "dir" / "c");
+    std::atomic<int> updates{0};
+    verifier.start([&] { ++updates; });
+    verifier.wait();
+
+    const auto progress = verifier.progress();
+    EXPECT_TRUE(progress.finished);
+    EXPECT_EQ(progress.good, 5u);
+    EXPECT_EQ(progress.bytes, 70u);
+    EXPECT_GE(updates.load(), 1);
+    EXPECT_TRUE(verifier.failedPieces().empty());
+}
+
+// Test corrupt bytes fail only their piece, and absent data reads as missing
+TEST_F(PieceVerifierTest, ReportsBadAndMissingPieces) {
+    const std::string content(64, 'x');
+    const TorrentValue root_value = MakeTorrent(content, {{"a", 20}, {"c", 20}, {"d", 24}});
+    const TorrentMetainfo meta(root_value);
+    Write("demo/dir/a", std::string(17, 'x') + "y" + std::string(2, 'x'));
+    Write("demo/dir/c", std::string(20, 'x'));
+    Write("demo/dir/d", std::string(5, 'x')); // truncated
+
+    PieceVerifier verifier(meta, root);
+    verifier.start();
+    verifier.wait();
+    EXPECT_EQ(verifier.state(0), PieceState::Good);
+    EXPECT_EQ(verifier.state(1), PieceState::Bad); // straddles a and c
+    EXPECT_EQ(verifier.state(2), PieceState::Missing);
+    EXPECT_EQ(verifier.state(3), PieceState::Missing);
+    EXPECT_EQ(verifier.failedPieces(), (std::vector<size_t>{1, 2, 3}));
+    const auto progress = verifier.progress();
+    EXPECT_EQ(progress.bad, 1u);
+    EXPECT_EQ(progress.missing, 2u);
+}
+
+// Test a torrent of many one-byte files, one of them a directory on disk
+TEST_F(PieceVerifierTest, ReadsManySmallFiles) {
+    std::string content;
+    std::vector<std::pair<std::string, int>> files;
+    for (int i = 0; i < 3000; ++i) {
+        content += static_cast<char>('a' + i % 26);
+        files.emplace_back("f" + std::to_string(i), 1);
+        if (i == 20)
+            fs::create_directory(root / "demo" / "dir" / files.back().first);
+        else
+            Write(fs::path("demo") / "dir" / files.back().first, content.substr(i, 1));
+    }
+    const TorrentValue root_value = MakeTorrent(content, files);
+    const TorrentMetainfo meta(root_value);
+
+    PieceVerifier verifier(meta, root, 2);
+    verifier.start();
+    verifier.wait();
+    const auto progress = verifier.progress();
+    EXPECT_EQ(progress.good, verifier.pieceCount() - 1);
+    EXPECT_EQ(progress.unreadable, 1u);
+    EXPECT_EQ(verifier.state(1), PieceState::Unreadable); // holds f20
+}
+
+// Test only the lowest-numbered failures are kept, with complete totals
+TEST_F(PieceVerifierTest, KeepsFirstFailures) {
+    const TorrentValue root_value = MakeTorrent(std::string(640, 'x'), {{"a", 640}});
+    const TorrentMetainfo meta(root_value);
+    PieceVerifier verifier(meta, root, 3);
+    verifier.start();
+    verifier.wait();
+    EXPECT_EQ(verifier.progress().missing, 40u);
+    std::vector<size_t> first(PieceVerifier::failed_limit);
+    std::iota(first.begin(), first.end(), size_t{0});
+    EXPECT_EQ(verifier.failedPieces(), first);
+}
+
+// Test paths that would escape the data directory are refused
+TEST_F(PieceVerifierTest, RejectsUnsafePaths) {
+    const TorrentValue root_value = MakeTorrent(std::string(16, 'x'), {{"..", 16}});
+    const TorrentMetainfo meta(root_value);
+    EXPECT_THROW(PieceVerifier(meta, root), std::runtime_error);
+}
+
+// Test v2 pieces are checked per file against their piece layers
+TEST_F(PieceVerifierTest, VerifiesV2PieceLayers) {
+    std::string big(100 << 10, '\0'), small(20 << 10, '\0');
+    for (size_t i = 0; i < big.size(); ++i)
+        big[i] = static_cast<char>(i * 7 + i / 4096);
+    for (size_t i = 0; i < small.size(); ++i)
+        small[i] = static_cast<char>(i * 13);
+    const TorrentValue root_value = MakeV2Torrent(big, small);
+    const TorrentMetainfo meta(root_value);
+    ASSERT_EQ(meta.fileTree().size(), 3u);
+    EXPECT_EQ(meta.fileTree()[1].path[1], "empty");
+    EXPECT_EQ(PieceVerifier::preferredScheme(meta), PieceScheme::V2);
+    EXPECT_THROW(PieceVerifier(meta, root), std::runtime_error); // no v1 pieces
+
+    big[70000] ^= 1; // piece 2 of big
+    Write("demo/dir/big", big);
+    Write("demo/dir/empty", "");
+    Write("demo/dir/small", small.substr(0, 1000)); // truncated
+
+    PieceVerifier verifier(meta, root, 2, PieceScheme::V2);
+    ASSERT_EQ(verifier.pieceCount(), 5u); // 4 for big, 1 for small
+    verifier.start();
+    verifier.wait();
+    EXPECT_EQ(verifier.failedPieces(), (std::vector<size_t>{2, 4}));
+    EXPECT_EQ(verifier.state(3), PieceState::Good); // short last piece
+    EXPECT_EQ(verifier.state(4), PieceState::Missing);
+    EXPECT_EQ(verifier.progress().good, 3u);
+}
+
+// Test a piece layer that does not reduce to its root is rejected
+TEST_F(PieceVerifierTest, RejectsForgedPieceLayers) {
+    const std::string big(70 << 10, 'b');
+    MakeV2Torrent(big, "s");
+    // Flip the last byte of the layer, just before the two closing "e"s
+    document[document.size() - 3] ^= 1;
+    TorrentTreeBuilder builder;
+    BencodeParser(document).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+    EXPECT_THROW(PieceVerifier(meta, root, 1, PieceScheme::V2), std::runtime_error);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include "sha.h"
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Test the FIPS 180 example vectors
+TEST(ShaTest, KnownVectors) {
+    const std::string two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const std::string million(1000000, 'a');
+
+    EXPECT_EQ(toHex(sha1("")), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    EXPECT_EQ(toHex(sha1("abc")), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(toHex(sha1(two_blocks)), "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    EXPECT_EQ(toHex(sha1(million)), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+    EXPECT_EQ(toHex(sha256("")),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(toHex(sha256("abc")),
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(toHex(sha256(two_blocks)),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(toHex(sha256(million)),
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+// Test feeding bytes in arbitrary pieces gives the one-shot digest
+TEST(ShaTest, IncrementalUpdates) {
+    std::string data;
+    for (int i = 0; i < 1000; ++i)
+        data += static_cast<char>(i * 7);
+    for (const size_t step : {1u, 3u, 55u, 56u, 63u, 64u, 65u, 200u}) {
+        Sha1 a;
+        Sha256 b;
+        for (size_t at = 0; at < data.size(); at += step) {
+            a.update(std::string_view(data).substr(at, step));
+            b.update(std::string_view(data).substr(at, step));
+        }
+        EXPECT_EQ(a.finish(), sha1(data)) << step;
+        EXPECT_EQ(b.finish(), sha256(data)) << step;
+    }
+}
+
+// Test BEP 52 merkle roots: zero-padded leaves and the pad subtree
+TEST(ShaTest, MerkleRoots) {
+    std::string data;
+    for (int i = 0; i < 40 * 1024; ++i)
+        data += static_cast<char>(i % 251);
+    EXPECT_EQ(toHex(merkleRoot(data, 4)),
+              "1412f7495875b7ca2642b1a3924ea78285cb80ea1ca88d22f441634d8f97fd08");
+    EXPECT_EQ(toHex(merklePad(4)),
+              "db56114e00fdd4c1f85c892bf35ac9a89289aaecb1ebd0a96cde606a748b5d71");
+
+    // A tree over hashes padded with a subtree root equals the flat tree
+    const std::vector<Sha256Digest> halves{merkleRoot(data.substr(0, 32768), 2),
+                                           merkleRoot(data.substr(32768), 2)};
+    EXPECT_EQ(merkleRoot(halves, 4, merklePad(2)), merkleRoot(data, 8));
+    EXPECT_EQ(merkleRoot(std::string_view(data).substr(0, 100), 1),
+              sha256(std::string_view(data).substr(0, 100)));
+}
+
+// Test every kernel this CPU supports against the known vectors and the
+// portable one, with lengths that leave lanes idle or finish at different
+// blocks
+TEST(ShaTest, KernelsMatchScalar) {
+    std::vector<std::string> owned{"abc", ""};
+    for (const size_t length : {1u, 55u, 56u, 63u, 64u, 65u, 127u, 128u, 1000u,
+                                16384u, 16385u, 70000u, 3u, 640u, 17u, 4096u, 999u})
+        owned.push_back(std::string(length, static_cast<char>('a' + length % 26)));
+    const std::vector<std::string_view> messages(owned.begin(), owned.end());
+
+    std::vector<Sha1Digest> sha1_scalar(messages.size());
+    std::vector<Sha256Digest> sha256_scalar(messages.size());
+    sha1Many(messages, sha1_scalar, ShaKernel::Scalar);
+    sha256Many(messages, sha256_scalar, ShaKernel::Scalar);
+    EXPECT_EQ(toHex(sha1_scalar[0]), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(toHex(sha256_scalar[1]),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    for (size_t i = 0; i < messages.size(); ++i) {
+        EXPECT_EQ(sha1_scalar[i], sha1(messages[i])) << i;
+        EXPECT_EQ(sha256_scalar[i], sha256(messages[i])) << i;
+    }
+
+    for (const ShaKernel kernel :
+         {ShaKernel::SHANI, ShaKernel::AVX2, ShaKernel::AVX512}) {
+        if (!shaKernelSupported(kernel))
+            continue;
+        // Every count from one message to past a full group of 16
+        for (size_t count = 1; count <= messages.size(); ++count) {
+            const auto some = std::span(messages).first(count);
+            std::vector<Sha1Digest> sha1_digests(count);
+            std::vector<Sha256Digest> sha256_digests(count);
+            sha1Many(some, sha1_digests, kernel);
+            sha256Many(some, sha256_digests, kernel);
+            for (size_t i = 0; i < count; ++i) {
+                EXPECT_EQ(sha1_digests[i], sha1_scalar[i])
+                    << static_cast<int>(kernel) << " " << count << " " << i;
+                EXPECT_EQ(sha256_digests[i], sha256_scalar[i])
+                    << static_cast<int>(kernel) << " " << count << " " << i;
+            }
+        }
+    }
+
+    std::vector<Sha1Digest> too_few(1);
+    EXPECT_THROW(sha1Many(messages, too_few), std::invalid_argument);
+}
+
+// Test hex parsing round-trips and rejects malformed input
+TEST(ShaTest, ParsesHex) {
+    const auto digest = sha1("abc");
+    const auto parsed = fromHex("A9993E364706816ABA3E25717850C26C9CD0D89D");
+    ASSERT_TRUE(parsed);
+    EXPECT_TRUE(std::equal(parsed->begin(), parsed->end(), digest.begin(), digest.end()));
+    EXPECT_EQ(fromHex("")->size(), 0u);
+    EXPECT_FALSE(fromHex("abc"));
+    EXPECT_FALSE(fromHex("zz"));
+}
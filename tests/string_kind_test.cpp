@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "string_kind.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<StructuralBitmap::Kernel> AvailableKernels() {
+  std::vector<StructuralBitmap::Kernel> kernels{
+      StructuralBitmap::Kernel::Scalar};
+  const auto best = StructuralBitmap::bestKernel();
+  if (best != StructuralBitmap::Kernel::Scalar)
+    kernels.push_back(StructuralBitmap::Kernel::SSE2);
+  if (best == StructuralBitmap::Kernel::AVX2)
+    kernels.push_back(StructuralBitmap::Kernel::AVX2);
+  return kernels;
+}
+
+} // namespace
+
+// Test the three classes on short strings
+TEST(StringKindTest, ClassifiesShortStrings) {
+  EXPECT_EQ(classifyString(""), StringKind::Ascii);
+  EXPECT_EQ(classifyString("ubuntu-24.04.iso"), StringKind::Ascii);
+  EXPECT_EQ(classifyString("line one\nline\ttwo\r\n"), StringKind::Ascii);
+  EXPECT_EQ(classifyString("Bj\xC3\xB6rk - J\xC3\xB3ga.flac"), StringKind::Utf8);
+  EXPECT_EQ(classifyString("\xE6\x97\xA5\xE6\x9C\xAC"), StringKind::Utf8);
+  EXPECT_EQ(classifyString("\xF0\x9F\x8E\xB5"), StringKind::Utf8);
+  EXPECT_EQ(classifyString(std::string("a\0b", 3)), StringKind::Binary);
+  EXPECT_EQ(classifyString("bell\x07"), StringKind::Binary);
+  EXPECT_EQ(classifyString("del\x7F"), StringKind::Binary);
+}
+
+// Test malformed UTF-8 is binary
+TEST(StringKindTest, RejectsMalformedUtf8) {
+  EXPECT_EQ(classifyString("\xC3"), StringKind::Binary);         // truncated
+  EXPECT_EQ(classifyString("\x80"), StringKind::Binary);         // stray
+  EXPECT_EQ(classifyString("\xC0\xAF"), StringKind::Binary);     // overlong
+  EXPECT_EQ(classifyString("\xE0\x80\xAF"), StringKind::Binary); // overlong
+  EXPECT_EQ(classifyString("\xED\xA0\x80"), StringKind::Binary); // surrogate
+  EXPECT_EQ(classifyString("\xF4\x90\x80\x80"), StringKind::Binary);
+  EXPECT_EQ(classifyString("\xE6\x97x"), StringKind::Binary);
+}
+
+// Test every kernel agrees wherever the interesting byte falls
+TEST(StringKindTest, KernelsAgreeAcrossVectorBoundaries) {
+  const std::vector<std::string> needles = {"\x01", "\x7F", "\xC3\xA9",
+                                            "\xC3", "\t", "\xE2\x82\xAC"};
+  for (size_t length : {1u, 15u, 16u, 17u, 31u, 32u, 33u, 100u}) {
+    for (size_t at = 0; at < length; ++at) {
+      for (const auto &needle : needles) {
+        std::string text(length, 'x');
+        text.replace(at, needle.size(), needle);
+        const StringKind expected =
+            classifyString(text, StructuralBitmap::Kernel::Scalar);
+        for (const auto kernel : AvailableKernels()) {
+          EXPECT_EQ(classifyString(text, kernel), expected)
+              << "length " << length << " at " << at;
+        }
+      }
+    }
+  }
+}
+
+// Test random binary is rejected without scanning the whole value
+TEST(StringKindTest, LargeValues) {
+  std::string text(1 << 20, 'a');
+  for (const auto kernel : AvailableKernels())
+    EXPECT_EQ(classifyString(text, kernel), StringKind::Ascii);
+  text[text.size() - 1] = '\x02';
+  for (const auto kernel : AvailableKernels())
+    EXPECT_EQ(classifyString(text, kernel), StringKind::Binary);
+}
+
+// Test prefixes never end inside a UTF-8 sequence
+TEST(StringKindTest, Utf8Prefix) {
+  const std::string text = "ab\xE2\x82\xAC" "cd";
+  EXPECT_EQ(utf8Prefix(text, 2), "ab");
+  EXPECT_EQ(utf8Prefix(text, 3), "ab");
+  EXPECT_EQ(utf8Prefix(text, 4), "ab");
+  EXPECT_EQ(utf8Prefix(text, 5), "ab\xE2\x82\xAC");
+  EXPECT_EQ(utf8Prefix(text, 100), text);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "structural_bitmap.h"
+#include <random>
+#include <string>
+
+namespace {
+
+// Reference answers computed straight from the bytes
+size_t NaiveNext(const std::string &s, char c, size_t pos) {
+  const size_t found = s.find(c, pos);
+  return found == std::string::npos ? StructuralBitmap::npos : found;
+}
+
+size_t NaiveDigitRun(const std::string &s, size_t pos) {
+  size_t run = 0;
+  while (pos + run < s.size() && s[pos + run] >= '0' && s[pos + run] <= '9')
+    ++run;
+  return run;
+}
+
+void ExpectMatchesNaive(const std::string &s, StructuralBitmap::Kernel kernel) {
+  StructuralBitmap bits(s, kernel);
+  for (size_t pos = 0; pos <= s.size(); ++pos) {
+    ASSERT_EQ(bits.nextColon(pos), NaiveNext(s, ':', pos)) << "pos " << pos;
+    ASSERT_EQ(bits.nextEnd(pos), NaiveNext(s, 'e', pos)) << "pos " << pos;
+    if (pos < s.size()) {
+      ASSERT_EQ(bits.digitRun(pos), NaiveDigitRun(s, pos)) << "pos " << pos;
+    }
+  }
+}
+
+} // namespace
+
+// Test lookups on a small bencoded document
+TEST(StructuralBitmapTest, FindsDelimiters) {
+  std::string doc = "d6:lengthi1234e4:name5:a:b:ce";
+  StructuralBitmap bits(doc);
+
+  EXPECT_EQ(bits.nextColon(0), 2u);
+  EXPECT_EQ(bits.nextColon(3), 16u);
+  EXPECT_EQ(bits.nextEnd(9), 14u);
+  EXPECT_EQ(bits.digitRun(10), 4u);
+  EXPECT_EQ(bits.digitRun(0), 0u);
+  EXPECT_EQ(bits.nextEnd(doc.size()), StructuralBitmap::npos);
+}
+
+// Test digit runs and searches that cross 64-byte block boundaries
+TEST(StructuralBitmapTest, CrossesBlockBoundaries) {
+  std::string doc(60, 'x');
+  doc += std::string(70, '7');
+  doc += ":";
+  doc += std::string(200, 'y');
+  doc += "e";
+  ExpectMatchesNaive(doc, StructuralBitmap::Kernel::Scalar);
+  EXPECT_EQ(StructuralBitmap(doc).digitRun(60), 70u);
+  EXPECT_EQ(StructuralBitmap(doc).nextEnd(0), doc.size() - 1);
+}
+
+// Test every kernel agrees with a byte-by-byte search on random input
+TEST(StructuralBitmapTest, KernelsAgree) {
+  std::mt19937 rng(1234);
+  const std::string alphabet = "0123456789:eildx\xff\x80";
+  for (size_t length : {0u, 1u, 63u, 64u, 65u, 200u, 1000u}) {
+    std::string s;
+    for (size_t i = 0; i < length; ++i)
+      s += alphabet[rng() % alphabet.size()];
+    ExpectMatchesNaive(s, StructuralBitmap::Kernel::Scalar);
+    ExpectMatchesNaive(s, StructuralBitmap::bestKernel());
+    if (StructuralBitmap::bestKernel() == StructuralBitmap::Kernel::AVX2)
+      ExpectMatchesNaive(s, StructuralBitmap::Kernel::SSE2);
+  }
+}
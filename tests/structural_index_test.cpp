@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "bencode_parser.h"
+#include "structural_index.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Test every container is recorded in preorder with its span
+TEST(StructuralIndexTest, RecordsContainerSpans) {
+  //                0         1         2
+  //                0123456789012345678901234
+  std::string doc = "d1:ali1eli2eee1:bd1:ci3eee";
+  StructuralIndex index(doc);
+
+  ASSERT_EQ(index.size(), 4u);
+  EXPECT_TRUE(index.isDict(0));
+  EXPECT_EQ(index[0].begin, 0u);
+  EXPECT_EQ(index[0].end, doc.size());
+  EXPECT_EQ(index[0].descendants, 3u);
+
+  EXPECT_TRUE(index.isList(1));
+  EXPECT_EQ(index[1].begin, 4u);
+  EXPECT_EQ(index[1].end, 14u);
+  EXPECT_EQ(index[1].descendants, 1u);
+
+  EXPECT_EQ(index[2].begin, 8u);
+  EXPECT_EQ(index[2].end, 13u);
+
+  EXPECT_TRUE(index.isDict(3));
+  EXPECT_EQ(index[3].begin, 17u);
+  EXPECT_EQ(index[3].descendants, 0u);
+}
+
+// Test next() steps over a whole subtree
+TEST(StructuralIndexTest, NextSkipsSubtree) {
+  StructuralIndex index("ld1:ald1:aleeeeli1eee");
+  // 0: outer list, 1: dict, 2: list, 3: dict, 4: list, 5: last list
+  ASSERT_EQ(index.size(), 6u);
+  EXPECT_EQ(index.next(0), 6u);
+  EXPECT_EQ(index.next(1), 5u);
+  EXPECT_EQ(index.next(2), 5u);
+  EXPECT_EQ(index.next(5), 6u);
+}
+
+// Test an indexed parser skips containers by jumping to their end
+TEST(StructuralIndexTest, IndexedParserSkips) {
+  class KeysOnly : public BencodeHandler {
+  public:
+    BencodeAction onKey(std::string_view key) override {
+      keys.emplace_back(key);
+      return BencodeAction::Continue;
+    }
+    BencodeAction onListBegin() override { return BencodeAction::Skip; }
+    std::vector<std::string> keys;
+  } handler;
+
+  StructuralIndex index("d1:ald1:xi1eee1:bd1:yi2eee");
+  BencodeParser parser(index, 0);
+  EXPECT_TRUE(parser.parse(handler));
+  EXPECT_EQ(handler.keys, (std::vector<std::string>{"a", "b", "y"}));
+  EXPECT_EQ(parser.position(), index[0].end);
+}
+
+// Test parsing from a nested node only covers that subtree
+TEST(StructuralIndexTest, ParseFromNode) {
+  class Counter : public BencodeHandler {
+  public:
+    BencodeAction onInt(long long) override {
+      ++ints;
+      return BencodeAction::Continue;
+    }
+    int ints = 0;
+  } handler;
+
+  StructuralIndex index("d1:ali1ei2ee1:bli3eee");
+  BencodeParser parser(index, 2);
+  EXPECT_TRUE(parser.parse(handler));
+  EXPECT_EQ(handler.ints, 1);
+}
+
+// Test malformed documents are rejected while indexing
+TEST(StructuralIndexTest, RejectsMalformed) {
+  EXPECT_THROW(StructuralIndex("d1:ali1e"), std::out_of_range);
+  EXPECT_THROW(StructuralIndex("d1:ai01ee"), std::runtime_error);
+}
+
+// Test build() reports the same error kinds and offsets as validateBencode
+TEST(StructuralIndexTest, BuildMatchesValidator) {
+  const auto same = [](std::string_view doc, const ParseLimits &limits = {}) {
+    const auto built = StructuralIndex::build(doc, limits);
+    const auto valid = validateBencode(doc, limits);
+    ASSERT_EQ(built.has_value(), valid.has_value()) << doc;
+    if (!built) {
+      EXPECT_EQ(built.error().kind, valid.error().kind) << doc;
+      EXPECT_EQ(built.error().offset, valid.error().offset) << doc;
+    }
+  };
+  for (std::string_view doc :
+       {"", "d4:name5:hel", "d4:namei12", "d4:name", "li1ei01ee", "li-0ee",
+        "l4x:abce", "l-1:ae", "di1ei2ee", "d1:ae", "lxe", "d1:ali1e",
+        "d1:ai01ee", "d1:a99999999999999999999999:ae", "d1:ali1eee"})
+    same(doc);
+
+  ParseLimits limits;
+  limits.max_depth = 2;
+  same("llleee", limits);
+  limits = {};
+  limits.max_string_bytes = 4;
+  same("l2:ab3:abce", limits);
+  limits = {};
+  limits.max_nodes = 2;
+  same("li1ei2ei3ee", limits);
+  EXPECT_EQ(StructuralIndex::build("li1ei2ei3ee", limits).error().detail,
+            "Parse limit exceeded: node count > 2");
+
+  const auto index = StructuralIndex::build("d1:ali1eee");
+  ASSERT_TRUE(index.has_value());
+  EXPECT_EQ(index->size(), 2u);
+  EXPECT_EQ(index->stats().nodes, 3u);
+}
+
+// Test the index enforces the same budgets as the parser
+TEST(StructuralIndexTest, EnforcesLimits) {
+  ParseLimits depth;
+  depth.max_depth = 2;
+  EXPECT_NO_THROW(StructuralIndex("llee", depth));
+  EXPECT_THROW(StructuralIndex(std::string(100000, 'l'), depth),
+               ParseLimitError);
+
+  ParseLimits nodes;
+  nodes.max_nodes = 3;
+  EXPECT_NO_THROW(StructuralIndex("d1:ai1e1:bi2ee", nodes));
+  EXPECT_THROW(StructuralIndex("li1ei2ei3ee", nodes), ParseLimitError);
+
+  ParseLimits bytes;
+  bytes.max_string_bytes = 4;
+  EXPECT_NO_THROW(StructuralIndex("d1:a3:xyze", bytes));
+  EXPECT_THROW(StructuralIndex("d1:a4:wxyze", bytes), ParseLimitError);
+}
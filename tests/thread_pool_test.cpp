@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include "thread_pool.h"
+#include <atomic>
+#include <stdexcept>
+
+// Test every submitted task runs and returns its result
+TEST(ThreadPoolTest, RunsTasks) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i)
+        results.push_back(pool.submit([i] { return i * i; }));
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(results[i].get(), i * i);
+}
+
+// Test exceptions thrown by a task reach the caller
+TEST(ThreadPoolTest, PropagatesExceptions) {
+    ThreadPool pool(2);
+    auto failing = pool.submit([] { throw std::runtime_error("boom"); });
+    auto fine = pool.submit([] { return 1; });
+    EXPECT_THROW(failing.get(), std::runtime_error);
+    EXPECT_EQ(fine.get(), 1);
+}
+
+// Test the destructor finishes queued work before joining
+TEST(ThreadPoolTest, DrainsOnDestruction) {
+    std::atomic<int> done{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 50; ++i)
+            pool.submit([&done] { ++done; });
+    }
+    EXPECT_EQ(done.load(), 50);
+}
+
+// Test zero threads means one per core
+TEST(ThreadPoolTest, DefaultsToHardwareConcurrency) {
+    ThreadPool pool;
+    EXPECT_GE(pool.size(), 1u);
+}
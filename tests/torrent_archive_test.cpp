@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include "archive_util.h"
+#include "torrent_archive.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Everything a DecodingStreambuf yields for `input`
+std::string Decode(const std::string& input) {
+    std::istringstream source(input);
+    DecodingStreambuf buffer(source);
+    std::istream decoded(&buffer);
+    // Unlike operator<<, the iterators let decoding errors through
+    return {std::istreambuf_iterator<char>(decoded), {}};
+}
+
+} // namespace
+
+// Test formats are told apart by their magic bytes
+TEST(TorrentArchiveTest, DetectsCompression) {
+    EXPECT_EQ(detectCompression(std::string("\x1f\x8b\x08\x00", 4)),
+              Compression::Gzip);
+    EXPECT_EQ(detectCompression("\x28\xb5\x2f\xfd\x00"), Compression::Zstd);
+    EXPECT_EQ(detectCompression("d4:infodee"), Compression::None);
+    EXPECT_EQ(detectCompression(""), Compression::None);
+}
+
+// Test gzip input is decoded, including output larger than one chunk and
+// concatenated members, while plain input passes through
+TEST(TorrentArchiveTest, DecodesGzip) {
+    if (!gzip_supported)
+        GTEST_SKIP() << "gzip is not supported by this build";
+    std::string big;
+    for (int i = 0; i < 50000; ++i)
+        big += std::to_string(i) + ",";
+    EXPECT_EQ(Decode(GzipCompress(big)), big);
+    EXPECT_EQ(Decode(GzipCompress("abc") + GzipCompress("def")), "abcdef");
+    EXPECT_EQ(Decode("d4:infodee"), "d4:infodee");
+    EXPECT_EQ(Decode(""), "");
+}
+
+// Test builds without zlib refuse gzip input rather than passing it through
+TEST(TorrentArchiveTest, GzipNeedsZlib) {
+    if (gzip_supported)
+        GTEST_SKIP() << "gzip is supported by this build";
+    EXPECT_THROW(Decode(std::string("\x1f\x8b\x08\x00", 4)), std::runtime_error);
+}
+
+// Test damaged gzip streams throw instead of ending quietly
+TEST(TorrentArchiveTest, CorruptGzipThrows) {
+    if (!gzip_supported)
+        GTEST_SKIP() << "gzip is not supported by this build";
+    const std::string packed = GzipCompress(std::string(10000, 'x') + "tail");
+    EXPECT_THROW(Decode(packed.substr(0, packed.size() / 2)), std::runtime_error);
+
+    std::string damaged = packed;
+    damaged[12] ^= 0x55;
+    EXPECT_THROW(Decode(damaged), std::runtime_error);
+}
+
+// Test members are listed with their names and sizes, skipping directories
+// and honouring GNU long names
+TEST(TorrentArchiveTest, ReadsTarMembers) {
+    const std::string long_name = std::string(120, 'n') + ".torrent";
+    std::istringstream tar(MakeTar({{"dir/", ""},
+                                    {"dir/a.torrent", "d4:infodee"},
+                                    {long_name, std::string(700, 'x')},
+                                    {"b.txt", "hello"}}));
+    TarReader reader(tar);
+    ArchiveMember member;
+    ASSERT_TRUE(reader.next(member));
+    EXPECT_EQ(member.name, "dir/a.torrent");
+    EXPECT_EQ(member.size, 10u);
+    // Read part of the data; next() skips the rest
+    char data[4];
+    EXPECT_EQ(reader.read(data, sizeof(data)), 4u);
+    EXPECT_EQ(std::string(data, 4), "d4:i");
+    ASSERT_TRUE(reader.next(member));
+    EXPECT_EQ(member.name, long_name);
+    EXPECT_EQ(member.size, 700u);
+    std::string whole(800, '\0');
+    EXPECT_EQ(reader.read(whole.data(), whole.size()), 700u);
+    EXPECT_EQ(reader.read(whole.data(), whole.size()), 0u);
+    ASSERT_TRUE(reader.next(member));
+    EXPECT_EQ(member.name, "b.txt");
+    EXPECT_FALSE(reader.next(member));
+}
+
+// Test a header with a bad checksum is rejected
+TEST(TorrentArchiveTest, CorruptTarHeaderThrows) {
+    std::string archive = MakeTar({{"a.torrent", "d4:infodee"}});
+    archive[0] = 'b';
+    std::istringstream tar(archive);
+    TarReader reader(tar);
+    ArchiveMember member;
+    EXPECT_THROW(reader.next(member), std::runtime_error);
+}
+
+// Test member path syntax and the name filters
+TEST(TorrentArchiveTest, ArchivePaths) {
+    EXPECT_EQ(archiveMemberPath("/x/b.tar.gz", "d/a.torrent"),
+              "/x/b.tar.gz!/d/a.torrent");
+    std::string archive, member;
+    ASSERT_TRUE(splitArchivePath("/x!/b.tar.gz!/d/a.torrent", archive, member));
+    EXPECT_EQ(archive, "/x!/b.tar.gz");
+    EXPECT_EQ(member, "d/a.torrent");
+    EXPECT_FALSE(splitArchivePath("/x!/a.torrent", archive, member));
+
+    EXPECT_TRUE(isArchiveName("a.TAR"));
+    EXPECT_TRUE(isArchiveName("a.tgz"));
+    EXPECT_TRUE(isArchiveName("a.tar.zst"));
+    EXPECT_FALSE(isArchiveName("a.torrent"));
+    EXPECT_TRUE(isTorrentName("a.torrent.gz"));
+    EXPECT_TRUE(isTorrentName("a.Torrent"));
+    EXPECT_FALSE(isTorrentName("a.torrent.bz2"));
+}
+
+// Test archives are listed and members opened from plain and gzipped tars
+TEST(TorrentArchiveTest, ListsAndOpensArchives) {
+    const std::string tar = MakeTar({{"a.torrent", "d4:name1:aee"},
+                                     {"sub/b.torrent", std::string(2000, 'b')}});
+    const auto dir = fs::temp_directory_path();
+    const auto plain = dir / "torrent_archive_test.tar";
+    const auto packed = dir / "torrent_archive_test.tar.gz";
+    std::ofstream(plain, std::ios::binary) << tar;
+    std::vector<fs::path> paths{plain};
+    if (gzip_supported) {
+        std::ofstream(packed, std::ios::binary) << GzipCompress(tar);
+        paths.push_back(packed);
+    }
+
+    for (const auto& path : paths) {
+        const auto members = listArchive(path.string());
+        ASSERT_EQ(members.size(), 2u);
+        EXPECT_EQ(members[1].name, "sub/b.torrent");
+        EXPECT_EQ(members[1].size, 2000u);
+
+        auto input = openArchiveMember(path.string(), "sub/b.torrent");
+        std::ostringstream out;
+        out << input->rdbuf();
+        EXPECT_EQ(out.str(), std::string(2000, 'b'));
+        EXPECT_THROW(openArchiveMember(path.string(), "missing.torrent"),
+                     std::runtime_error);
+    }
+    EXPECT_THROW(listArchive((dir / "no_such.tar").string()), std::runtime_error);
+    fs::remove(plain);
+    fs::remove(packed);
+}
+
+// Test listings are reused until the archive changes, and opening a listed
+// member goes straight to its offset
+TEST(TorrentArchiveTest, ReusesListingsUntilChanged) {
+    const auto path = fs::temp_directory_path() / "torrent_archive_cache_test.tar";
+    std::ofstream(path, std::ios::binary)
+        << MakeTar({{"a.torrent", "d1:ai1ee"}, {"b.torrent", "d1:bi2ee"}});
+    const auto members = listArchive(path.string());
+    ASSERT_EQ(members.size(), 2u);
+    EXPECT_EQ(members[0].offset, 512u);
+    EXPECT_EQ(members[1].offset, 3 * 512u);
+
+    std::ostringstream out;
+    out << openArchiveMember(path.string(), "b.torrent")->rdbuf();
+    EXPECT_EQ(out.str(), "d1:bi2ee");
+
+    // A different size (and time) invalidates the cached listing
+    std::ofstream(path, std::ios::binary) << MakeTar({{"c.torrent", "d1:ci3ee"}});
+    fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(5));
+    const auto changed = listArchive(path.string());
+    ASSERT_EQ(changed.size(), 1u);
+    EXPECT_EQ(changed[0].name, "c.torrent");
+    EXPECT_THROW(openArchiveMember(path.string(), "b.torrent"), std::runtime_error);
+    fs::remove(path);
+}
+
+// Test compressed archives beyond the listing budget are refused
+TEST(TorrentArchiveTest, ListingBudget) {
+    if (!gzip_supported)
+        GTEST_SKIP() << "gzip is not supported by this build";
+    const auto path = fs::temp_directory_path() / "torrent_archive_budget_test.tar.gz";
+    std::ofstream(path, std::ios::binary)
+        << GzipCompress(MakeTar({{"big.bin", std::string(1 << 20, 'x')},
+                                 {"a.torrent", "d1:ai1ee"}}));
+    EXPECT_THROW(listArchive(path.string(), 64 << 10), std::runtime_error);
+    EXPECT_EQ(listArchive(path.string()).size(), 2u);
+    fs::remove(path);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "torrent_creator.h"
+#include "piece_verifier.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class TorrentCreatorTest : public ::testing::Test {
+protected:
+    fs::path root = fs::temp_directory_path() / "torrent_creator_test";
+    fs::path source = root / "album";
+
+    void SetUp() override {
+        fs::create_directories(source / "disc1");
+        // Sizes that end mid-piece, fill a piece exactly and span several
+        Write("disc1/01.flac", 40000);
+        Write("disc1/02.flac", 16384);
+        Write("cover.jpg", 100);
+        Write("empty.txt", 0);
+        Write("notes/long.txt", 70000);
+    }
+    void TearDown() override { fs::remove_all(root); }
+
+    void Write(const std::string& relative, size_t size) {
+        fs::create_directories((source / relative).parent_path());
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+            content[i] = static_cast<char>(i * 131 + relative.size());
+        std::ofstream(source / relative, std::ios::binary) << content;
+    }
+
+    // Parse `doc` and check every piece against the source with `scheme`
+    void ExpectVerifies(const std::string& doc, PieceScheme scheme) {
+        TorrentTreeBuilder builder;
+        BencodeParser(doc).parse(builder);
+        const TorrentMetainfo meta(builder.result());
+        PieceVerifier verifier(meta, root, 2, scheme);
+        verifier.start();
+        verifier.wait();
+        EXPECT_GT(verifier.pieceCount(), 0u);
+        EXPECT_EQ(verifier.progress().good, verifier.pieceCount());
+    }
+};
+
+// Test a v1 torrent lists files in path order and verifies against them
+TEST_F(TorrentCreatorTest, CreatesV1Torrent) {
+    TorrentCreateOptions options;
+    options.piece_length = 16384;
+    options.announce = "http://tracker/announce";
+    options.threads = 3;
+    options.read_ahead = 1; // smallest window: one piece per worker
+    const std::string doc = createTorrent(source, options);
+    ASSERT_TRUE(validateBencode(doc).has_value());
+
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+    EXPECT_EQ(meta.name(), "album");
+    EXPECT_EQ(meta.announce(), "http://tracker/announce");
+    EXPECT_TRUE(meta.fileTree().empty());
+    ASSERT_EQ(meta.files().size(), 5u);
+    EXPECT_EQ(meta.files()[0].path[0], "cover.jpg");
+    EXPECT_EQ(meta.files()[1].path[1], "01.flac");
+    EXPECT_EQ(meta.files()[4].path[1], "long.txt");
+    EXPECT_EQ(meta.totalSize(), 126484u);
+    EXPECT_EQ(meta.pieceCount(), 8u);
+    ExpectVerifies(doc, PieceScheme::V1);
+
+    // Same input, same bytes
+    EXPECT_EQ(createTorrent(source, options), doc);
+}
+
+// Test a hybrid torrent aligns files with pad files and verifies both ways
+TEST_F(TorrentCreatorTest, CreatesHybridTorrent) {
+    TorrentCreateOptions options;
+    options.piece_length = 32768;
+    options.hybrid = true;
+    const std::string doc = createTorrent(source, options);
+
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+    EXPECT_EQ(meta.metaVersion(), 2);
+    ASSERT_EQ(meta.fileTree().size(), 5u);
+    EXPECT_FALSE(meta.fileTree()[1].layer.empty()); // 01.flac: two pieces
+    size_t pads = 0;
+    for (const auto& file : meta.files()) {
+        pads += file.pad;
+        if (!file.pad) {
+            EXPECT_EQ(file.offset % 32768, 0u);
+        }
+    }
+    EXPECT_EQ(pads, 3u);
+    ExpectVerifies(doc, PieceScheme::V1);
+    ExpectVerifies(doc, PieceScheme::V2);
+}
+
+// Test a single file becomes a single-file torrent
+TEST_F(TorrentCreatorTest, CreatesSingleFileTorrent) {
+    TorrentCreateOptions options;
+    options.hybrid = true;
+    const std::string doc = createTorrent(source / "notes" / "long.txt", options);
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+    EXPECT_FALSE(meta.isMultiFile());
+    EXPECT_EQ(meta.name(), "long.txt");
+    EXPECT_EQ(meta.pieceLength(), 16384u); // picked from the size
+    EXPECT_EQ(meta.fileTree()[0].path[0], "long.txt");
+
+    TorrentTreeBuilder again;
+    BencodeParser(doc).parse(again);
+    const TorrentMetainfo view(again.result());
+    PieceVerifier verifier(view, source / "notes", 1, PieceScheme::V2);
+    verifier.start();
+    verifier.wait();
+    EXPECT_EQ(verifier.progress().good, verifier.pieceCount());
+}
+
+// Test created data is found next to the source however it was spelled
+TEST_F(TorrentCreatorTest, DataRootHoldsSource) {
+    EXPECT_EQ(creationBase("album/"), fs::path("album"));
+    EXPECT_EQ(creationDataRoot("album"), fs::path("."));
+    EXPECT_EQ(creationDataRoot("album/"), fs::path("."));
+    EXPECT_EQ(creationDataRoot("music/album/"), fs::path("music"));
+    EXPECT_EQ(creationDataRoot("./music/../album"), fs::path("."));
+    EXPECT_EQ(creationDataRoot("/srv/album"), fs::path("/srv"));
+
+    // What 'v' does after --create: the data root resolves the torrent's files
+    const std::string doc = createTorrent(source.string() + "/");
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    const TorrentMetainfo meta(builder.result());
+    PieceVerifier verifier(meta, creationDataRoot(source.string() + "/"), 1);
+    verifier.start();
+    verifier.wait();
+    EXPECT_EQ(verifier.progress().good, verifier.pieceCount());
+}
+
+// Test bad sources and piece lengths are refused
+TEST_F(TorrentCreatorTest, RejectsBadInput) {
+    EXPECT_THROW(createTorrent(root / "missing"), std::runtime_error);
+    fs::create_directories(root / "nothing");
+    EXPECT_THROW(createTorrent(root / "nothing"), std::runtime_error);
+    TorrentCreateOptions options;
+    options.piece_length = 20000;
+    EXPECT_THROW(createTorrent(source, options), std::runtime_error);
+}
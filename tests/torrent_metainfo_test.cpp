@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "torrent_metainfo.h"
+#include "tree_util.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+const std::string kMultiFile =
+    "d8:announce10:http://t/a4:infod5:filesl"
+    "d6:lengthi10e4:pathl3:dir1:aee"
+    "d6:lengthi0e4:pathl1:bee"
+    "d6:lengthi25e4:pathl1:cee"
+    "e4:name4:demo12:piece lengthi16e"
+    "6:pieces60:aaaaaaaaaaaaaaaaaaaabbbbbbbbbbbbbbbbbbbbcccccccccccccccccccc"
+    "7:privatei1eee";
+
+} // namespace
+
+// Test a multi-file torrent's fields and prefix offsets
+TEST(TorrentMetainfoTest, ReadsMultiFileTorrent) {
+    const TorrentValue root = Parse(kMultiFile);
+    const TorrentMetainfo meta(root);
+    EXPECT_EQ(meta.name(), "demo");
+    EXPECT_EQ(meta.announce(), "http://t/a");
+    EXPECT_EQ(meta.pieceLength(), 16u);
+    EXPECT_TRUE(meta.isPrivate());
+    EXPECT_EQ(meta.metaVersion(), 1);
+    EXPECT_TRUE(meta.isMultiFile());
+    EXPECT_EQ(meta.totalSize(), 35u);
+
+    ASSERT_EQ(meta.pieceCount(), 3u);
+    EXPECT_EQ(meta.pieces().size(), 60u);
+    EXPECT_EQ(meta.piece(1)[0], 'b');
+    EXPECT_EQ(meta.piece(2)[19], 'c');
+
+    const auto& files = meta.files();
+    ASSERT_EQ(files.size(), 3u);
+    ASSERT_EQ(files[0].path.size(), 2u);
+    EXPECT_EQ(files[0].path[0], "dir");
+    EXPECT_EQ(files[0].path[1], "a");
+    EXPECT_EQ(files[1].path[0], "b");
+    EXPECT_EQ(files[1].offset, 10u);
+    EXPECT_EQ(files[2].length, 25u);
+    EXPECT_EQ(files[2].offset, 10u);
+}
+
+// Test a single-file torrent reads as one file named after the torrent
+TEST(TorrentMetainfoTest, ReadsSingleFileTorrent) {
+    const std::string doc =
+        "d4:infod6:lengthi100e4:name5:a.iso12:piece lengthi64e6:pieces40:"
+        "0123456789012345678901234567890123456789ee";
+    const TorrentValue root = Parse(doc);
+    const TorrentMetainfo meta(root);
+    EXPECT_FALSE(meta.isMultiFile());
+    ASSERT_EQ(meta.files().size(), 1u);
+    EXPECT_EQ(meta.files()[0].path[0], "a.iso");
+    EXPECT_EQ(meta.totalSize(), 100u);
+    EXPECT_EQ(meta.pieceCount(), 2u);
+    EXPECT_TRUE(meta.announce().empty());
+}
+
+// Test the view works on a lazily parsed reader without materializing it,
+// and survives a move
+TEST(TorrentMetainfoTest, WorksOnLazyReaders) {
+    const auto path = std::filesystem::temp_directory_path() / "metainfo_test.torrent";
+    std::ofstream(path, std::ios::binary) << kMultiFile;
+    TorrentReaderOptions options;
+    options.lazy = true;
+    options.limits.max_depth = 8; // the tape is bounded like the reader
+    {
+        TorrentReader reader(path.string(), options);
+        EXPECT_EQ(reader.limits().max_depth, 8u);
+        TorrentMetainfo meta(reader);
+        EXPECT_TRUE(reader.getRoot().isLazy()); // read from a tape instead
+        TorrentMetainfo moved(std::move(meta));
+        EXPECT_EQ(moved.files()[0].path[1], "a");
+        EXPECT_EQ(moved.totalSize(), 35u);
+    }
+    std::filesystem::remove(path);
+}
+
+// Test the v2 file tree is flattened in order, with its piece layers
+TEST(TorrentMetainfoTest, ReadsFileTree) {
+    const std::string root_a(32, 'A'), root_b(32, 'B');
+    const std::string doc =
+        "d4:infod9:file treed1:ad0:d6:lengthi40e11:pieces root32:" + root_a +
+        "ee1:dd1:bd0:d6:lengthi10e11:pieces root32:" + root_b + "eee"
+        "1:zd0:d6:lengthi0eeee"
+        "12:meta versioni2e4:name1:n12:piece lengthi16ee"
+        "12:piece layersd32:" + root_a + "96:" + std::string(96, 'L') + "ee";
+    const TorrentValue root = Parse(doc);
+    const TorrentMetainfo meta(root);
+    EXPECT_EQ(meta.metaVersion(), 2);
+    EXPECT_EQ(meta.pieceCount(), 0u);
+    const auto& tree = meta.fileTree();
+    ASSERT_EQ(tree.size(), 3u);
+    EXPECT_EQ(tree[0].path[0], "a");
+    EXPECT_EQ(tree[0].layer.size(), 96u);
+    ASSERT_EQ(tree[1].path.size(), 2u);
+    EXPECT_EQ(tree[1].path[0], "d");
+    EXPECT_EQ(tree[1].path[1], "b");
+    EXPECT_EQ(tree[1].root[0], 'B');
+    EXPECT_TRUE(tree[1].layer.empty()); // one piece: no layer
+    EXPECT_EQ(tree[2].path[0], "z");
+    EXPECT_TRUE(tree[2].root.empty());
+
+    const std::string rootless = "d4:infod9:file treed1:ad0:d6:lengthi5eeeeee";
+    EXPECT_THROW(TorrentMetainfo{Parse(rootless)}, std::runtime_error);
+}
+
+// Test malformed metainfo is rejected
+TEST(TorrentMetainfoTest, RejectsMalformedFields) {
+    for (const std::string doc : {
+             "d4:name1:xe",                                 // no info
+             "d4:infoli1eee",                               // info not a dict
+             "d4:infod6:pieces3:abcee",                     // partial digest
+             "d4:infod5:filesld4:pathl1:aeeeee",            // no length
+             "d4:infod5:filesld6:lengthi-1e4:pathl1:aeeeee", // negative
+             "d4:infod5:filesld6:lengthi1e4:pathli1eeeeee", // path not strings
+         }) {
+        const TorrentValue root = Parse(doc);
+        EXPECT_THROW(TorrentMetainfo{root}, std::runtime_error) << doc;
+        EXPECT_THROW(TorrentMetainfo{TorrentTape(doc)}, std::runtime_error) << doc;
+    }
+}
+
+// Test a view read from a tape matches one read from the tree, and keeps
+// borrowing from the source once the tape is gone
+TEST(TorrentMetainfoTest, TapeMatchesTree) {
+    const std::string layer_root(32, 'A');
+    const std::string v2 =
+        "d4:infod9:file treed1:ad0:d6:lengthi40e11:pieces root32:" +
+        layer_root + "eeee12:meta versioni2e4:name1:n12:piece lengthi16ee"
+        "12:piece layersd32:" + layer_root + "96:" + std::string(96, 'L') + "ee";
+    for (const std::string& doc : {kMultiFile, v2}) {
+        const TorrentValue root = Parse(doc);
+        const TorrentMetainfo tree(root);
+        const TorrentMetainfo tape{TorrentTape(doc)};
+        EXPECT_EQ(tape.name(), tree.name());
+        EXPECT_EQ(tape.name().data(), tree.name().data());
+        EXPECT_EQ(tape.announce(), tree.announce());
+        EXPECT_EQ(tape.pieceLength(), tree.pieceLength());
+        EXPECT_EQ(tape.metaVersion(), tree.metaVersion());
+        EXPECT_EQ(tape.isPrivate(), tree.isPrivate());
+        EXPECT_EQ(tape.totalSize(), tree.totalSize());
+        EXPECT_TRUE(std::ranges::equal(tape.pieces(), tree.pieces()));
+        ASSERT_EQ(tape.files().size(), tree.files().size());
+        for (size_t i = 0; i < tree.files().size(); ++i) {
+            EXPECT_TRUE(std::ranges::equal(tape.files()[i].path,
+                                           tree.files()[i].path));
+            EXPECT_EQ(tape.files()[i].offset, tree.files()[i].offset);
+        }
+        ASSERT_EQ(tape.fileTree().size(), tree.fileTree().size());
+        for (size_t i = 0; i < tree.fileTree().size(); ++i) {
+            EXPECT_TRUE(std::ranges::equal(tape.fileTree()[i].path,
+                                           tree.fileTree()[i].path));
+            EXPECT_EQ(tape.fileTree()[i].layer.size(),
+                      tree.fileTree()[i].layer.size());
+        }
+    }
+}
@@ -1,8 +1,18 @@
 #include <gtest/gtest.h>
+#include "archive_util.h"
 #include "torrent_reader.h"
+#include "torrent_archive.h"
 #include <fstream>
+#include <iterator>
 #include <filesystem>
 #include <limits>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -343,3 +353,672 @@ TEST_F(TorrentReaderTest, ParseMixedTypeList) {
     EXPECT_TRUE(list[1].isString());
     EXPECT_EQ(list[1].asString(), "hello");
 }
+
+// Test mapped and buffered loading produce the same tree
+TEST_F(TorrentReaderTest, MappedAndReadModesAgree) {
+    auto filepath = test_data_dir / "nested_struct.torrent";
+
+    TorrentReaderOptions map_options;
+    map_options.load_mode = TorrentLoadMode::Map;
+    TorrentReaderOptions read_options;
+    read_options.load_mode = TorrentLoadMode::Read;
+    TorrentReader mapped(filepath.string(), map_options);
+    TorrentReader copied(filepath.string(), read_options);
+
+    EXPECT_TRUE(mapped.isMapped());
+    EXPECT_FALSE(copied.isMapped());
+    EXPECT_EQ(mapped.source(), copied.source());
+
+    std::ostringstream a, b;
+    a << mapped.getRoot();
+    b << copied.getRoot();
+    EXPECT_EQ(a.str(), b.str());
+}
+
+// Test strings are borrowed slices of the source, not copies
+TEST_F(TorrentReaderTest, StringsBorrowFromSource) {
+    auto temp_file = CreateTempFile("temp_borrowed.torrent", "d4:name5:hello5:piece3:abce");
+
+    TorrentReader reader(temp_file.string());
+    const auto source = reader.source();
+    const auto& dict = reader.getRoot().asDict();
+
+    const auto name = dict.at("name").asString();
+    EXPECT_EQ(name, "hello");
+    EXPECT_GE(name.data(), source.data());
+    EXPECT_LE(name.data() + name.size(), source.data() + source.size());
+
+    // Other keys borrow from the source too; well-known ones are static
+    const auto piece = (dict.begin() + 1)->first.str();
+    EXPECT_EQ(piece, "piece");
+    EXPECT_GE(piece.data(), source.data());
+    EXPECT_LE(piece.data() + piece.size(), source.data() + source.size());
+    EXPECT_EQ(dict.begin()->first, TorrentKey("name"));
+    EXPECT_EQ(dict.begin()->first.str().data(), metaKeyName(MetaKey::Name).data());
+}
+
+// Test keys are private to their document: nothing outlives the reader
+TEST_F(TorrentReaderTest, KeysBelongToTheirDocument) {
+    auto first = CreateTempFile("temp_keys_a.torrent", "d6:lengthi1e4:pathle6:zz_keyi0ee");
+    auto second = CreateTempFile("temp_keys_b.torrent", "d6:lengthi2e4:pathle6:zz_keyi1ee");
+
+    TorrentReader a(first.string());
+    TorrentReader b(second.string());
+    const auto& a_dict = a.getRoot().asDict();
+    const auto& b_dict = b.getRoot().asDict();
+
+    EXPECT_EQ(a_dict.begin()->first, b_dict.begin()->first);
+    EXPECT_EQ(a_dict.begin()->first.known(), MetaKey::Length);
+    const auto a_key = (a_dict.begin() + 2)->first;
+    const auto b_key = (b_dict.begin() + 2)->first;
+    EXPECT_EQ(a_key, b_key);
+    EXPECT_NE(a_key.str().data(), b_key.str().data());
+    EXPECT_EQ(b_dict.at("zz_key").asInt(), 1);
+    EXPECT_FALSE(a_dict.contains("never_seen_key"));
+}
+
+// Test the parsed tree stays valid when the reader is moved
+TEST_F(TorrentReaderTest, MovedReaderKeepsValues) {
+    auto temp_file = CreateTempFile("temp_moved.torrent", "d4:name5:helloe");
+
+    auto original = std::make_unique<TorrentReader>(temp_file.string());
+    TorrentReader moved(std::move(*original));
+    original.reset();
+
+    EXPECT_EQ(moved.getRoot().asDict().at("name").asString(), "hello");
+}
+
+// Test lazy mode parses containers only when they are accessed
+TEST_F(TorrentReaderTest, LazyModeDefersContainers) {
+    auto temp_file = CreateTempFile("temp_lazy.torrent",
+        "d4:infod5:filesld6:lengthi1eed6:lengthi2eee4:name1:xe4:listli7eee");
+
+    TorrentReaderOptions options;
+    options.lazy = true;
+    TorrentReader reader(temp_file.string(), options);
+
+    const auto& root = reader.getRoot();
+    EXPECT_TRUE(root.isLazy());
+    EXPECT_TRUE(root.isDict());
+    EXPECT_FALSE(root.isList());
+
+    const auto& dict = root.asDict();
+    EXPECT_FALSE(root.isLazy());
+    ASSERT_EQ(dict.size(), 2u);
+
+    // Children are indexed but not parsed yet
+    const auto& info = dict.at("info");
+    EXPECT_TRUE(info.isLazy());
+    EXPECT_TRUE(info.isDict());
+    EXPECT_TRUE(dict.at("list").isList());
+
+    const auto& files = info.asDict().at("files");
+    EXPECT_TRUE(files.isLazy());
+    ASSERT_EQ(files.asList().size(), 2u);
+    EXPECT_EQ(files.asList()[1].asDict().at("length").asInt(), 2);
+    EXPECT_EQ(info.asDict().at("name").asString(), "x");
+    EXPECT_TRUE(dict.at("list").isLazy());
+}
+
+// Test lazy and eager readers describe the same tree
+TEST_F(TorrentReaderTest, LazyModeMatchesEager) {
+    auto filepath = test_data_dir / "nested_struct.torrent";
+
+    TorrentReaderOptions options;
+    options.lazy = true;
+    TorrentReader lazy(filepath.string(), options);
+    TorrentReader eager(filepath.string());
+
+    std::ostringstream a, b;
+    a << lazy.getRoot();
+    b << eager.getRoot();
+    EXPECT_EQ(a.str(), b.str());
+    EXPECT_EQ(lazy.isValidTorrent(), eager.isValidTorrent());
+}
+
+// Test lazy mode still rejects malformed input up front
+TEST_F(TorrentReaderTest, LazyModeValidatesOnOpen) {
+    auto temp_file = CreateTempFile("temp_lazy_bad.torrent", "d4:listli1ee");
+
+    TorrentReaderOptions options;
+    options.lazy = true;
+    EXPECT_THROW({
+        TorrentReader reader(temp_file.string(), options);
+    }, std::runtime_error);
+}
+
+// Test limit violations surface as ParseLimitError in both modes
+TEST_F(TorrentReaderTest, ParseLimitsAreEnforced) {
+    auto temp_file = CreateTempFile("temp_limits.torrent",
+        "d4:infod4:name4:deep4:listllllleeeeeee");
+
+    TorrentReaderOptions options;
+    options.limits.max_depth = 4;
+    EXPECT_THROW({
+        TorrentReader reader(temp_file.string(), options);
+    }, ParseLimitError);
+
+    options.lazy = true;
+    EXPECT_THROW({
+        TorrentReader reader(temp_file.string(), options);
+    }, ParseLimitError);
+
+    options.limits.max_depth = 8;
+    EXPECT_NO_THROW({
+        TorrentReader reader(temp_file.string(), options);
+    });
+}
+
+// Test a deeply nested document is built, printed and destroyed without
+// recursing once per level
+TEST_F(TorrentReaderTest, DeepNestingIsNotRecursive) {
+    constexpr size_t depth = 2000000;
+    auto temp_file = CreateTempFile("temp_deep.torrent",
+        "d1:a" + std::string(depth, 'l') + std::string(depth, 'e') + "e");
+
+    TorrentReader reader(temp_file.string());
+    std::ostringstream out;
+    out << reader.getRoot();
+    EXPECT_EQ(out.str(), "{\"a\": " + std::string(depth, '[') +
+                             std::string(depth, ']') + "}");
+}
+
+// Test arena mode builds the same tree from a per-document resource
+TEST_F(TorrentReaderTest, ArenaModeAllocatesFromArena) {
+    auto filepath = test_data_dir / "nested_struct.torrent";
+
+    TorrentReaderOptions options;
+    options.arena = true;
+    TorrentReader arena(filepath.string(), options);
+    TorrentReader heap(filepath.string());
+
+    std::ostringstream a, b;
+    a << arena.getRoot();
+    b << heap.getRoot();
+    EXPECT_EQ(a.str(), b.str());
+
+    const auto* default_resource = std::pmr::get_default_resource();
+    const auto& dict = arena.getRoot().asDict();
+    EXPECT_NE(dict.get_allocator().resource(), default_resource);
+    const auto& inner = dict.at("inner").asList();
+    EXPECT_EQ(inner.get_allocator().resource(), dict.get_allocator().resource());
+    EXPECT_EQ(heap.getRoot().asDict().get_allocator().resource(), default_resource);
+}
+
+// Test lazily materialized containers come from the arena too
+TEST_F(TorrentReaderTest, ArenaModeWithLazyContainers) {
+    auto temp_file = CreateTempFile("temp_lazy_arena.torrent",
+        "d4:infod5:filesld6:lengthi1eeeee");
+
+    TorrentReaderOptions options;
+    options.arena = true;
+    options.lazy = true;
+    TorrentReader reader(temp_file.string(), options);
+
+    const auto& root = reader.getRoot().asDict();
+    const auto& info = root.at("info").asDict();
+    const auto& files = info.at("files").asList();
+    EXPECT_EQ(files[0].asDict().at("length").asInt(), 1);
+    EXPECT_NE(files.get_allocator().resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(files.get_allocator().resource(), root.get_allocator().resource());
+}
+
+// Test a stream is parsed into the same tree as the file
+TEST_F(TorrentReaderTest, ReadsFromStream) {
+    auto filepath = test_data_dir / "nested_struct.torrent";
+    std::ifstream file(filepath, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    TorrentReader streamed(contents);
+    TorrentReader mapped(filepath.string());
+
+    EXPECT_FALSE(streamed.isMapped());
+    EXPECT_TRUE(streamed.source().empty()); // kept in blocks instead
+    std::ostringstream a, b;
+    a << streamed.getRoot();
+    b << mapped.getRoot();
+    EXPECT_EQ(a.str(), b.str());
+}
+
+// Test streamed strings stay valid after the input is gone
+TEST_F(TorrentReaderTest, StreamedStringsOutliveInput) {
+    auto input = std::make_unique<std::istringstream>("d4:name5:hello4:spec0:e");
+    TorrentReader reader(*input);
+    input.reset();
+
+    const auto& dict = reader.getRoot().asDict();
+    EXPECT_EQ(dict.at("name").asString(), "hello");
+    EXPECT_EQ(dict.at("spec").asString(), "");
+    EXPECT_EQ(dict.begin()->first, "name");
+}
+
+// Test strings longer than a read block are borrowed from the stream's
+// blocks whole, and info bytes spread over blocks are joined on demand
+TEST_F(TorrentReaderTest, StreamBorrowsAcrossBlocks) {
+    std::string pieces(200000, '\0');
+    for (size_t i = 0; i < pieces.size(); ++i)
+        pieces[i] = static_cast<char>(i * 7);
+    const std::string info = "d4:name4:demo12:piece lengthi16384e6:pieces" +
+                             std::to_string(pieces.size()) + ":" + pieces + "e";
+    std::string filler;
+    for (int i = 0; i < 9000; ++i)
+        filler += "i" + std::to_string(i) + "e";
+    const std::string doc = "d1:al" + filler + "e4:info" + info + "e";
+    for (const size_t cut : {size_t{0}, size_t{65536 - 3}}) {
+        // Shift the document so block ends land in different tokens
+        const std::string padded = "d1:_" + std::to_string(cut + 1) + ":" +
+                                   std::string(cut + 1, 'x') + doc.substr(1);
+        std::istringstream stream(padded);
+        TorrentReader reader(stream);
+        EXPECT_TRUE(reader.source().empty());
+        const auto& root = reader.getRoot().asDict();
+        EXPECT_EQ(root.at("a").asList().size(), 9000u);
+        EXPECT_EQ(std::string_view(root.at("info").asDict().at("pieces").asString()),
+                  pieces);
+        EXPECT_EQ(reader.infoBytes(), info);
+        EXPECT_EQ(reader.infoBytes().data(), reader.infoBytes().data()); // kept
+    }
+}
+
+// Test stream errors match the file errors
+TEST_F(TorrentReaderTest, StreamErrors) {
+    std::istringstream empty("");
+    EXPECT_THROW({ TorrentReader reader(empty); }, std::runtime_error);
+    std::istringstream truncated("d4:name5:hel");
+    EXPECT_THROW({ TorrentReader reader(truncated); }, std::runtime_error);
+    std::istringstream list("li1ee");
+    EXPECT_THROW({ TorrentReader reader(list); }, std::runtime_error);
+
+    TorrentReaderOptions options;
+    options.limits.max_depth = 1;
+    std::istringstream deep("d1:ali1eee");
+    EXPECT_THROW({ TorrentReader reader(deep, options); }, ParseLimitError);
+}
+
+#ifndef _WIN32
+// Test a named pipe is read as a stream rather than sized with seekg
+TEST_F(TorrentReaderTest, ReadsFromNamedPipe) {
+    auto fifo = test_data_dir / "temp_pipe.torrent";
+    fs::remove(fifo);
+    ASSERT_EQ(mkfifo(fifo.c_str(), 0600), 0);
+    temp_files.push_back(fifo);
+
+    std::thread writer([&] {
+        std::ofstream out(fifo, std::ios::binary);
+        out << "d4:infod4:name";
+        out.flush();
+        out << "4:pipeee";
+    });
+    TorrentReader reader(fifo.string());
+    writer.join();
+
+    EXPECT_TRUE(reader.isValidTorrent());
+    EXPECT_EQ(reader.getRoot().asDict().at("info").asDict().at("name").asString(), "pipe");
+}
+#endif
+
+// Test dictionaries are contiguous, sorted and searchable by string_view
+TEST_F(TorrentReaderTest, FlatDictLookups) {
+    auto temp_file = CreateTempFile("temp_flat_dict.torrent",
+        "d1:ai1e1:bi2e1:ci3e4:infod4:name1:xee");
+
+    TorrentReader reader(temp_file.string());
+    const auto& dict = reader.getRoot().asDict();
+    ASSERT_EQ(dict.size(), 4u);
+    EXPECT_EQ(&*(dict.begin() + 1), &*dict.begin() + 1);
+
+    const std::string key = "b";
+    EXPECT_EQ(dict.at(std::string_view(key)).asInt(), 2);
+    EXPECT_EQ(dict.at(key).asInt(), 2);
+    EXPECT_TRUE(dict.contains("info"));
+    EXPECT_FALSE(dict.contains("inf"));
+    EXPECT_TRUE(dict.find("zzz") == dict.end());
+    EXPECT_THROW(dict.at("zzz"), std::out_of_range);
+}
+
+// Test unsorted and duplicate keys still yield a sorted dictionary
+TEST_F(TorrentReaderTest, FlatDictUnsortedInput) {
+    auto temp_file = CreateTempFile("temp_unsorted_dict.torrent",
+        "d1:ci3e1:ai1e1:bi2e1:ai9ee");
+
+    TorrentReader reader(temp_file.string());
+    const auto& dict = reader.getRoot().asDict();
+    std::vector<std::string> keys;
+    for (const auto& [key, value] : dict)
+        keys.emplace_back(key);
+    EXPECT_EQ(keys, (std::vector<std::string>{"a", "b", "c"}));
+    // Like std::map assignment, the last duplicate wins
+    EXPECT_EQ(dict.at("a").asInt(), 9);
+}
+
+// Test a large dictionary in descending key order is sorted, duplicates
+// included
+TEST_F(TorrentReaderTest, FlatDictDescendingInput) {
+    constexpr int count = 50000;
+    std::string doc = "d";
+    for (int i = count - 1; i >= 0; --i) {
+        const std::string key = "k" + std::to_string(1000000 + i);
+        doc += std::to_string(key.size()) + ":" + key + "i" + std::to_string(i) + "e";
+    }
+    doc += "8:k1000000i-1ee";
+    auto temp_file = CreateTempFile("temp_descending_dict.torrent", doc);
+
+    TorrentReader reader(temp_file.string());
+    const auto& dict = reader.getRoot().asDict();
+    ASSERT_EQ(dict.size(), static_cast<size_t>(count));
+    EXPECT_TRUE(std::ranges::is_sorted(dict, {}, [](const auto& entry) {
+        return std::string_view(entry.first);
+    }));
+    EXPECT_EQ(dict.at("k1000000").asInt(), -1);
+    EXPECT_EQ(dict.at("k1049999").asInt(), count - 1);
+}
+
+// Test strings carry the kind computed while parsing
+TEST_F(TorrentReaderTest, StringsAreClassifiedOnce) {
+    std::string content = "d4:data4:";
+    content += std::string("\x00\x01\x02\x03", 4);
+    content += "4:name10:J\xC3\xB3ga.flac4:note5:helloe";
+    auto temp_file = CreateTempBinaryFile("temp_kinds.torrent", content);
+
+    TorrentReader reader(temp_file.string());
+    const auto& dict = reader.getRoot().asDict();
+    EXPECT_EQ(dict.at("data").asString().kind(), StringKind::Binary);
+    EXPECT_EQ(dict.at("name").asString().kind(), StringKind::Utf8);
+    EXPECT_EQ(dict.at("note").asString().kind(), StringKind::Ascii);
+    EXPECT_TRUE(dict.at("name").asString().isText());
+
+    std::ostringstream out;
+    out << reader.getRoot();
+    EXPECT_EQ(out.str(), "{\"data\": <binary data: 4 bytes>, \"name\": \"J\xC3\xB3ga.flac\", \"note\": \"hello\"}");
+}
+
+// Test the parse mode picks the parser instantiation
+TEST_F(TorrentReaderTest, ParseModes) {
+    auto temp_file = CreateTempFile("temp_parse_mode.torrent", "d4:infod6:lengthi0042eee");
+
+    EXPECT_THROW({ TorrentReader reader(temp_file.string()); }, std::runtime_error);
+
+    TorrentReaderOptions options;
+    options.parse_mode = TorrentParseMode::Lenient;
+    TorrentReader lenient(temp_file.string(), options);
+    EXPECT_EQ(lenient.getRoot().asDict().at("info").asDict().at("length").asInt(), 42);
+
+    auto valid = test_data_dir / "nested_struct.torrent";
+    options.parse_mode = TorrentParseMode::Trusted;
+    TorrentReader trusted(valid.string(), options);
+    TorrentReader strict(valid.string());
+    std::ostringstream a, b;
+    a << trusted.getRoot();
+    b << strict.getRoot();
+    EXPECT_EQ(a.str(), b.str());
+}
+
+// Test the multi-threaded parse builds exactly the sequential tree
+TEST_F(TorrentReaderTest, ParallelParseMatchesSequential) {
+    // Enough files, with nested lists and a big list of lists inside, to be
+    // split across the pool
+    std::string files;
+    for (int i = 0; i < 5000; ++i) {
+        const std::string name = "file" + std::to_string(i) + ".bin";
+        files += "d6:lengthi" + std::to_string(i * 7) + "e4:pathl3:dir" +
+                 std::to_string(name.size()) + ":" + name + "ee";
+    }
+    std::string numbers;
+    for (int i = 0; i < 3000; ++i)
+        numbers += "li" + std::to_string(i) + "e1:xe";
+    auto temp_file = CreateTempFile("temp_parallel.torrent",
+        "d4:infod5:filesl" + files + "e4:name3:big7:numbersl" + numbers +
+        "eee");
+
+    TorrentReader sequential(temp_file.string());
+    std::ostringstream expected;
+    expected << sequential.getRoot();
+
+    for (const bool arena : {false, true}) {
+        for (const size_t threads : {size_t{0}, size_t{2}, size_t{4}}) {
+            TorrentReaderOptions options;
+            options.threads = threads;
+            options.arena = arena;
+            TorrentReader parallel(temp_file.string(), options);
+            EXPECT_FALSE(parallel.getRoot().isLazy());
+            const auto& info = parallel.getRoot().asDict().at("info").asDict();
+            EXPECT_FALSE(info.at("files").asList()[4999].isLazy());
+            std::ostringstream actual;
+            actual << parallel.getRoot();
+            EXPECT_EQ(actual.str(), expected.str()) << threads << " threads";
+        }
+    }
+}
+
+// Test the multi-threaded parse still validates and enforces limits
+TEST_F(TorrentReaderTest, ParallelParseErrors) {
+    TorrentReaderOptions options;
+    options.threads = 2;
+
+    auto bad = CreateTempFile("temp_parallel_bad.torrent", "d4:listli1ee");
+    EXPECT_THROW({ TorrentReader reader(bad.string(), options); }, std::runtime_error);
+
+    auto deep = CreateTempFile("temp_parallel_deep.torrent", "d4:listllllleeeeee");
+    options.limits.max_depth = 4;
+    EXPECT_THROW({ TorrentReader reader(deep.string(), options); }, ParseLimitError);
+}
+
+// Test gzipped torrents are decompressed transparently, by path and by stream
+TEST_F(TorrentReaderTest, ReadsCompressedTorrents) {
+    if (!gzip_supported)
+        GTEST_SKIP() << "gzip is not supported by this build";
+    auto filepath = test_data_dir / "nested_struct.torrent";
+    std::ifstream in(filepath, std::ios::binary);
+    const std::string plain((std::istreambuf_iterator<char>(in)), {});
+    auto packed = CreateTempBinaryFile("temp_packed.torrent.gz", GzipCompress(plain));
+
+    TorrentReader expected(filepath.string());
+    std::ostringstream want;
+    want << expected.getRoot();
+
+    for (const auto load_mode : {TorrentLoadMode::Map, TorrentLoadMode::Read}) {
+        TorrentReaderOptions options;
+        options.load_mode = load_mode;
+        TorrentReader reader(packed.string(), options);
+        EXPECT_FALSE(reader.isMapped());
+        EXPECT_TRUE(reader.source().empty());
+        std::ostringstream got;
+        got << reader.getRoot();
+        EXPECT_EQ(got.str(), want.str());
+    }
+
+    std::istringstream stream(GzipCompress(plain));
+    TorrentReader streamed(stream);
+    std::ostringstream decoded;
+    decoded << streamed.getRoot();
+    EXPECT_EQ(decoded.str(), want.str());
+
+    auto truncated = CreateTempBinaryFile("temp_truncated.torrent.gz",
+        GzipCompress(plain).substr(0, 20));
+    EXPECT_THROW({ TorrentReader reader(truncated.string()); }, std::runtime_error);
+}
+
+// Test members of plain and compressed tar bundles open by member path,
+// including compressed members
+TEST_F(TorrentReaderTest, ReadsArchiveMembers) {
+    if (!gzip_supported)
+        GTEST_SKIP() << "gzip is not supported by this build";
+    const std::string tar = MakeTar({
+        {"a.torrent", "d4:infod4:name1:aee"},
+        {"nested/b.torrent.gz", GzipCompress("d4:infod4:name1:bee")},
+    });
+    auto plain = CreateTempBinaryFile("temp_bundle.tar", tar);
+    auto packed = CreateTempBinaryFile("temp_bundle.tar.gz", GzipCompress(tar));
+
+    for (const auto& archive : {plain, packed}) {
+        TorrentReader a(archiveMemberPath(archive.string(), "a.torrent"));
+        EXPECT_EQ(a.getRoot().asDict().at("info").asDict().at("name").asString(), "a");
+        TorrentReader b(archiveMemberPath(archive.string(), "nested/b.torrent.gz"));
+        EXPECT_EQ(b.getRoot().asDict().at("info").asDict().at("name").asString(), "b");
+        EXPECT_THROW({
+            TorrentReader missing(archiveMemberPath(archive.string(), "c.torrent"));
+        }, std::runtime_error);
+    }
+}
+
+// Test compressed input that expands past max_decoded fails cleanly, both
+// as a torrent and as the archive around one
+TEST_F(TorrentReaderTest, RefusesDecompressionBombs) {
+    if (!gzip_supported)
+        GTEST_SKIP() << "gzip is not supported by this build";
+    const std::string zeros(4 << 20, '0');
+    const std::string doc = "d4:data" + std::to_string(zeros.size()) + ":" + zeros + "e";
+    const std::string bomb = GzipCompress(doc);
+    ASSERT_LT(bomb.size(), 64u * 1024);
+    auto packed = CreateTempBinaryFile("temp_bomb.torrent.gz", bomb);
+    auto bundle = CreateTempBinaryFile("temp_bomb.tar.gz",
+        GzipCompress(MakeTar({{"a.torrent", "d4:infod4:name1:aee"}, {"big.bin", zeros},
+                              {"z.torrent", "d4:infod4:name1:zee"}})));
+
+    TorrentReaderOptions options;
+    options.max_decoded = 1 << 20;
+    EXPECT_THROW({ TorrentReader reader(packed.string(), options); }, std::runtime_error);
+    std::istringstream stream(bomb);
+    EXPECT_THROW({ TorrentReader reader(stream, options); }, std::runtime_error);
+    const auto result = TorrentReader::parse(packed.string(), options);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().kind, ParseErrorKind::Stream);
+
+    // The member before the bulk is in budget, the one after it is not
+    TorrentReader first(archiveMemberPath(bundle.string(), "a.torrent"), options);
+    EXPECT_EQ(first.getRoot().asDict().at("info").asDict().at("name").asString(), "a");
+    EXPECT_THROW({
+        TorrentReader last(archiveMemberPath(bundle.string(), "z.torrent"), options);
+    }, std::runtime_error);
+
+    // The default budget is large enough for the real document
+    TorrentReader whole(packed.string());
+    EXPECT_EQ(whole.getRoot().asDict().at("data").asString().size(), zeros.size());
+}
+
+// Test parse() reports failures as values with their kind and offset
+TEST_F(TorrentReaderTest, ParseReturnsErrors) {
+    const auto kind = [](const fs::path& path, TorrentReaderOptions options = {}) {
+        const auto result = TorrentReader::parse(path.string(), options);
+        EXPECT_FALSE(result.has_value()) << path;
+        return result ? ParseErrorKind::Io : result.error().kind;
+    };
+    EXPECT_EQ(kind(test_data_dir / "no_such_file.torrent"), ParseErrorKind::Io);
+    EXPECT_EQ(kind(CreateTempFile("temp_parse_empty.torrent", "")),
+              ParseErrorKind::EmptyInput);
+    EXPECT_EQ(kind(CreateTempFile("temp_parse_list.torrent", "li1ee")),
+              ParseErrorKind::NotADictionary);
+
+    auto truncated = CreateTempFile("temp_parse_cut.torrent", "d4:infod4:name10:abc");
+    const auto result = TorrentReader::parse(truncated.string());
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().kind, ParseErrorKind::StringOutOfBounds);
+    EXPECT_EQ(result.error().offset, 14u);
+
+    TorrentReaderOptions options;
+    options.limits.max_depth = 1;
+    EXPECT_EQ(kind(CreateTempFile("temp_parse_deep.torrent", "d4:infod4:name1:aee"), options),
+              ParseErrorKind::LimitExceeded);
+    // Lenient files are only accepted in lenient mode
+    auto lenient = CreateTempFile("temp_parse_lenient.torrent", "d1:ai007ee");
+    EXPECT_EQ(kind(lenient), ParseErrorKind::InvalidInteger);
+    options = {};
+    options.parse_mode = TorrentParseMode::Lenient;
+    EXPECT_TRUE(TorrentReader::parse(lenient.string(), options).has_value());
+
+    // Indexed reads validate while indexing, with the same results
+    options = {};
+    options.lazy = true;
+    const auto indexed = TorrentReader::parse(truncated.string(), options);
+    ASSERT_FALSE(indexed.has_value());
+    EXPECT_EQ(indexed.error().kind, ParseErrorKind::StringOutOfBounds);
+    EXPECT_EQ(indexed.error().offset, 14u);
+    EXPECT_EQ(kind(lenient, options), ParseErrorKind::InvalidInteger);
+    options.limits.max_depth = 1;
+    EXPECT_EQ(kind(CreateTempFile("temp_parse_deep.torrent", "d4:infod4:name1:aee"), options),
+              ParseErrorKind::LimitExceeded);
+
+    if (gzip_supported) {
+        auto packed = CreateTempBinaryFile("temp_parse_cut.torrent.gz",
+            GzipCompress("d4:infod4:name1:aee").substr(0, 20));
+        EXPECT_EQ(kind(packed), ParseErrorKind::Stream);
+    }
+}
+
+// Test parse() builds the same tree as the constructor in every mode
+TEST_F(TorrentReaderTest, ParseMatchesConstructor) {
+    const auto path = (test_data_dir / "nested_struct.torrent").string();
+    std::ostringstream want;
+    want << TorrentReader(path).getRoot();
+
+    TorrentReaderOptions options;
+    for (int mode = 0; mode < 4; ++mode) {
+        options.lazy = mode == 1;
+        options.threads = mode == 2 ? 2 : 1;
+        options.arena = mode == 3;
+        auto reader = TorrentReader::parse(path, options);
+        ASSERT_TRUE(reader.has_value()) << reader.error().message();
+        std::ostringstream got;
+        got << reader->getRoot();
+        EXPECT_EQ(got.str(), want.str()) << mode;
+    }
+
+    if (!gzip_supported)
+        return;
+    auto packed = CreateTempBinaryFile("temp_parse_ok.torrent.gz",
+        GzipCompress("d4:infod4:name1:aee"));
+    const auto reader = TorrentReader::parse(packed.string());
+    ASSERT_TRUE(reader.has_value());
+    EXPECT_TRUE(reader->isValidTorrent());
+}
+
+// Test the info span and hashes are the same however the document is read
+TEST_F(TorrentReaderTest, InfoHashOverRawBytes) {
+    const std::string doc =
+        "d8:announce3:xyz4:infod6:lengthi5e4:name1:a12:piece lengthi16384e"
+        "6:pieces20:aaaaaaaaaaaaaaaaaaaae7:comment2:hie";
+    auto path = CreateTempBinaryFile("temp_info_hash.torrent", doc);
+    const std::string_view info = std::string_view(doc).substr(22, 75);
+
+    std::vector<TorrentReaderOptions> modes(5);
+    modes[1].lazy = true;
+    modes[2].threads = 2;
+    modes[3].projection = {{"info", "name"}};
+    modes[4].load_mode = TorrentLoadMode::Read;
+    for (const auto& options : modes) {
+        TorrentReader reader(path.string(), options);
+        EXPECT_EQ(reader.infoBytes(), info);
+        const auto& hashes = reader.infoHashes();
+        ASSERT_TRUE(hashes.v1.has_value());
+        EXPECT_EQ(toHex(*hashes.v1), "d0d24694da2b8aa2fb5978c5a9f0ded040b4fb36");
+        EXPECT_FALSE(hashes.v2.has_value());
+        EXPECT_EQ(&reader.infoHashes(), &hashes); // kept, not recomputed
+    }
+    std::istringstream stream(doc);
+    TorrentReader streamed(stream);
+    EXPECT_EQ(streamed.infoBytes(), info);
+
+    if (gzip_supported) {
+        auto packed = CreateTempBinaryFile("temp_info_hash.torrent.gz", GzipCompress(doc));
+        EXPECT_EQ(TorrentReader(packed.string()).infoBytes(), info);
+    }
+}
+
+// Test v2 torrents get a SHA-256 info-hash, and hybrids both
+TEST_F(TorrentReaderTest, InfoHashV2) {
+    const std::string doc =
+        "d4:infod9:file treed1:ad0:d6:lengthi5e11:pieces root32:" +
+        std::string(32, 'r') + "eee12:meta versioni2e4:name1:a12:piece lengthi16384eee";
+    auto path = CreateTempBinaryFile("temp_info_hash_v2.torrent", doc);
+    TorrentReader reader(path.string());
+    const auto& hashes = reader.infoHashes();
+    EXPECT_FALSE(hashes.v1.has_value());
+    ASSERT_TRUE(hashes.v2.has_value());
+    EXPECT_EQ(toHex(*hashes.v2),
+              "95c49231cd7ffd83b3872185603eb9c37197692ca1f054d48bafbee9ddf2d06b");
+
+    auto none = CreateTempFile("temp_info_hash_none.torrent", "d4:name1:ae");
+    EXPECT_TRUE(TorrentReader(none.string()).infoBytes().empty());
+    EXPECT_FALSE(TorrentReader(none.string()).infoHashes().v1.has_value());
+}
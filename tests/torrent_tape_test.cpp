@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "bencode_parser.h"
+#include "torrent_tape.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Test records are laid out in preorder with subtree sizes
+TEST(TorrentTapeTest, RecordsPreorderWithSkips) {
+  std::string doc = "d1:ali1ei2ee1:bi3ee";
+  TorrentTape tape(doc);
+
+  // dict, "a", list, 1, 2, "b", 3
+  ASSERT_EQ(tape.size(), 7u);
+  EXPECT_EQ(tape[0].type(), TapeNode::Dict);
+  EXPECT_EQ(tape[0].skip(), 7u);
+  EXPECT_EQ(tape[0].count, 2u);
+  EXPECT_EQ(tape[0].payload, 0u);
+  EXPECT_EQ(tape[1].type(), TapeNode::String);
+  EXPECT_EQ(tape[2].type(), TapeNode::List);
+  EXPECT_EQ(tape[2].skip(), 3u);
+  EXPECT_EQ(tape[2].count, 2u);
+  EXPECT_EQ(tape[2].payload, 4u);
+  EXPECT_EQ(tape[3].type(), TapeNode::Int);
+  EXPECT_EQ(tape[3].skip(), 1u);
+}
+
+// Test strings are slices of the source, not copies
+TEST(TorrentTapeTest, StringsBorrowFromSource) {
+  std::string doc = "d4:name5:helloe";
+  TorrentTape tape(doc);
+
+  TapeCursor name = tape.root();
+  ASSERT_TRUE(tape.root().find("name", name));
+  EXPECT_EQ(name.asString(), "hello");
+  EXPECT_EQ(name.asString().data(), doc.data() + 9);
+}
+
+// Test cursor accessors and list iteration
+TEST(TorrentTapeTest, CursorWalksLists) {
+  TorrentTape tape("li-7e3:abcli1eedee");
+  TapeCursor root = tape.root();
+
+  ASSERT_TRUE(root.isList());
+  EXPECT_EQ(root.size(), 4u);
+  std::vector<TapeCursor> items;
+  for (const auto item : root)
+    items.push_back(item);
+  ASSERT_EQ(items.size(), 4u);
+  EXPECT_EQ(items[0].asInt(), -7);
+  EXPECT_EQ(items[1].asString(), "abc");
+  EXPECT_TRUE(items[2].isList());
+  EXPECT_EQ(items[2].size(), 1u);
+  EXPECT_TRUE(items[3].isDict());
+  EXPECT_EQ(items[3].size(), 0u);
+}
+
+// Test dictionary iteration skips over nested values
+TEST(TorrentTapeTest, EntriesSkipNestedValues) {
+  TorrentTape tape("d1:ad1:xli1ei2eee1:bi2e1:cle4:zzzz0:e");
+
+  std::vector<std::string> keys;
+  for (const auto &entry : tape.root().entries())
+    keys.emplace_back(entry.key());
+  EXPECT_EQ(keys, (std::vector<std::string>{"a", "b", "c", "zzzz"}));
+
+  TapeCursor value = tape.root();
+  ASSERT_TRUE(tape.root().find("b", value));
+  EXPECT_EQ(value.asInt(), 2);
+  ASSERT_TRUE(tape.root().find("zzzz", value));
+  EXPECT_EQ(value.asString(), "");
+  EXPECT_FALSE(tape.root().find("bb", value));
+  EXPECT_FALSE(tape.root().find("zzzzz", value));
+}
+
+// Test the last of repeated keys wins, as in the tree
+TEST(TorrentTapeTest, FindKeepsLastDuplicate) {
+  TorrentTape tape("d1:ai1e1:bi2e1:ai3ee");
+
+  TapeCursor value = tape.root();
+  ASSERT_TRUE(tape.root().find("a", value));
+  EXPECT_EQ(value.asInt(), 3);
+  ASSERT_TRUE(tape.root().find("b", value));
+  EXPECT_EQ(value.asInt(), 2);
+}
+
+// Test type mismatches throw
+TEST(TorrentTapeTest, TypeMismatchThrows) {
+  TorrentTape tape("d1:ai1ee");
+  EXPECT_THROW(tape.root().asInt(), std::runtime_error);
+  EXPECT_THROW(tape.root().begin(), std::runtime_error);
+
+  TapeCursor a = tape.root();
+  ASSERT_TRUE(tape.root().find("a", a));
+  EXPECT_THROW(a.asString(), std::runtime_error);
+  EXPECT_THROW(a.entries(), std::runtime_error);
+  EXPECT_FALSE(a.find("x", a));
+}
+
+// Test malformed input and parse limits are rejected like the tree parser
+TEST(TorrentTapeTest, RejectsMalformedInput) {
+  EXPECT_THROW(TorrentTape("d1:a"), std::runtime_error);
+  EXPECT_THROW(TorrentTape("i12"), std::runtime_error);
+
+  ParseLimits limits;
+  limits.max_depth = 2;
+  EXPECT_THROW(TorrentTape("lllee", limits), ParseLimitError);
+}
+
+
+// Test string records keep their classification
+TEST(TorrentTapeTest, StringKinds) {
+  TorrentTape tape("l5:plain5:\xC3\xA9t\xC3\xA9" "2:\x01\x02" "e");
+  std::vector<StringKind> kinds;
+  for (const auto item : tape.root()) {
+    EXPECT_EQ(tape[item.position()].skip(), 1u);
+    kinds.push_back(item.stringKind());
+  }
+  EXPECT_EQ(kinds, (std::vector<StringKind>{StringKind::Ascii, StringKind::Utf8,
+                                            StringKind::Binary}));
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "torrent_reader.h"
+
+#include <string>
+#include <utility>
+
+// Build the TorrentValue tree of `doc` with BencodeParser. The tree borrows
+// its strings from `doc`, which must outlive it.
+inline TorrentValue Parse(const std::string& doc) {
+    TorrentTreeBuilder builder;
+    BencodeParser(doc).parse(builder);
+    return std::move(builder.result());
+}
@@ -0,0 +1,36 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  workers.reserve(threads);
+  for (size_t i = 0; i < threads; ++i)
+    workers.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  ready.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex);
+      ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty())
+        return; // stopping, and nothing left to run
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
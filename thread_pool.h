@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// @brief Fixed set of worker threads draining a FIFO task queue.
+/// submit() returns a future for the task's result; exceptions thrown by a
+/// task are rethrown from future::get(). The destructor finishes the queued
+/// tasks and joins the workers. Tasks must not block on futures of other
+/// tasks in the same pool.
+class ThreadPool {
+public:
+  // 0 means one worker per hardware thread
+  explicit ThreadPool(size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const { return workers.size(); }
+
+  template <typename Fn> auto submit(Fn fn) {
+    using Result = std::invoke_result_t<Fn>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard lock(mutex);
+      tasks.emplace_back([task] { (*task)(); });
+    }
+    ready.notify_one();
+    return result;
+  }
+
+private:
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+
+  void work();
+};
@@ -0,0 +1,617 @@
+#include "torrent_archive.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#ifdef TORRENT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TORRENT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Compression detectCompression(std::string_view head) {
+  if (head.substr(0, 2) == "\x1f\x8b")
+    return Compression::Gzip;
+  if (head.substr(0, 4) == "\x28\xb5\x2f\xfd")
+    return Compression::Zstd;
+  return Compression::None;
+}
+
+// --- Codecs ---
+
+class DecodingStreambuf::Codec {
+public:
+  virtual ~Codec() = default;
+
+  // Decode from `in` into `out`, reporting how much of each was used.
+  // Returns true when a gzip member or zstd frame ended at `consumed`.
+  virtual bool decode(const char *in, size_t in_size, size_t &consumed,
+                      char *out, size_t out_size, size_t &produced) = 0;
+  // Prepare for another member or frame following the one that ended
+  virtual void reset() = 0;
+};
+
+namespace {
+
+#ifdef TORRENT_HAVE_ZLIB
+class GzipCodec : public DecodingStreambuf::Codec {
+public:
+  GzipCodec() {
+    // 15 window bits, +32: accept a gzip or zlib header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+      throw std::runtime_error("Cannot initialise zlib");
+  }
+  ~GzipCodec() override { inflateEnd(&stream); }
+
+  bool decode(const char *in, size_t in_size, size_t &consumed, char *out,
+              size_t out_size, size_t &produced) override {
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+    stream.avail_in = static_cast<uInt>(in_size);
+    stream.next_out = reinterpret_cast<Bytef *>(out);
+    stream.avail_out = static_cast<uInt>(out_size);
+    const int status = inflate(&stream, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+      throw std::runtime_error(std::string("Corrupt gzip data: ") +
+                               (stream.msg ? stream.msg : "inflate failed"));
+    }
+    consumed = in_size - stream.avail_in;
+    produced = out_size - stream.avail_out;
+    return status == Z_STREAM_END;
+  }
+
+  void reset() override { inflateReset(&stream); }
+
+private:
+  z_stream stream{};
+};
+#endif
+
+#ifdef TORRENT_HAVE_ZSTD
+class ZstdCodec : public DecodingStreambuf::Codec {
+public:
+  ZstdCodec() : stream(ZSTD_createDStream()) {
+    if (!stream)
+      throw std::runtime_error("Cannot initialise zstd");
+    ZSTD_initDStream(stream);
+  }
+  ~ZstdCodec() override { ZSTD_freeDStream(stream); }
+
+  bool decode(const char *in, size_t in_size, size_t &consumed, char *out,
+              size_t out_size, size_t &produced) override {
+    ZSTD_inBuffer source{in, in_size, 0};
+    ZSTD_outBuffer target{out, out_size, 0};
+    const size_t status = ZSTD_decompressStream(stream, &target, &source);
+    if (ZSTD_isError(status)) {
+      throw std::runtime_error(std::string("Corrupt zstd data: ") +
+                               ZSTD_getErrorName(status));
+    }
+    consumed = source.pos;
+    produced = target.pos;
+    return status == 0; // frame complete and fully flushed
+  }
+
+  void reset() override { ZSTD_initDStream(stream); }
+
+private:
+  ZSTD_DStream *stream;
+};
+#endif
+
+std::unique_ptr<DecodingStreambuf::Codec> makeCodec(Compression format) {
+  switch (format) {
+  case Compression::None:
+    break;
+  case Compression::Gzip:
+#ifdef TORRENT_HAVE_ZLIB
+    return std::make_unique<GzipCodec>();
+#else
+    throw std::runtime_error("gzip input is not supported by this build");
+#endif
+  case Compression::Zstd:
+#ifdef TORRENT_HAVE_ZSTD
+    return std::make_unique<ZstdCodec>();
+#else
+    throw std::runtime_error("zstd input is not supported by this build");
+#endif
+  }
+  return nullptr;
+}
+
+constexpr size_t chunk_size = 64 * 1024;
+
+} // namespace
+
+// --- DecodingStreambuf ---
+
+DecodingStreambuf::DecodingStreambuf(std::istream &source,
+                                     const uint64_t max_output)
+    : source(source), input(chunk_size), output_limit(max_output) {}
+
+DecodingStreambuf::~DecodingStreambuf() = default;
+
+bool DecodingStreambuf::fill() {
+  if (source_done)
+    return false;
+  source.read(input.data(), static_cast<std::streamsize>(input.size()));
+  input_pos = 0;
+  input_end = static_cast<size_t>(source.gcount());
+  source_offset += input_end;
+  source_done = input_end == 0;
+  return !source_done;
+}
+
+DecodingStreambuf::int_type DecodingStreambuf::underflow() {
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  if (!started) {
+    started = true;
+    if (!fill())
+      return traits_type::eof();
+    format = detectCompression({input.data(), input_end});
+    codec = makeCodec(format);
+    if (codec)
+      output.resize(chunk_size);
+  }
+
+  if (!codec) {
+    // Uncompressed: hand out the raw chunks as they are
+    if (input_pos == input_end && !fill())
+      return traits_type::eof();
+    setg(input.data() + input_pos, input.data() + input_pos,
+         input.data() + input_end);
+    input_pos = input_end;
+    return traits_type::to_int_type(*gptr());
+  }
+
+  while (true) {
+    // A full output buffer may leave decoded bytes inside the codec, so
+    // drain it before asking the source for more
+    if (input_pos == input_end && !pending && !fill()) {
+      if (frame_done)
+        return traits_type::eof();
+      throw std::runtime_error("Truncated compressed input");
+    }
+    if (frame_done) {
+      codec->reset();
+      frame_done = false;
+    }
+    size_t consumed = 0;
+    size_t produced = 0;
+    frame_done = codec->decode(input.data() + input_pos, input_end - input_pos,
+                               consumed, output.data(), output.size(),
+                               produced);
+    input_pos += consumed;
+    pending = !frame_done && produced == output.size();
+    decoded += produced;
+    if (decoded > output_limit)
+      throw std::runtime_error("Input decompresses to more than " +
+                               std::to_string(output_limit) + " bytes");
+    if (produced > 0) {
+      setg(output.data(), output.data(), output.data() + produced);
+      return traits_type::to_int_type(*gptr());
+    }
+    if (consumed == 0 && input_pos < input_end && !frame_done)
+      throw std::runtime_error("Corrupt compressed input");
+  }
+}
+
+DecodingStreambuf::pos_type
+DecodingStreambuf::seekoff(off_type offset, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which) {
+  const pos_type failed(off_type(-1));
+  if (codec || !started || dir != std::ios_base::cur ||
+      !(which & std::ios_base::in) || offset < 0)
+    return failed;
+  const off_type buffered = egptr() - gptr();
+  if (offset <= buffered) {
+    gbump(static_cast<int>(offset));
+  } else {
+    if (source.rdbuf()->pubseekoff(offset - buffered, std::ios_base::cur,
+                                   std::ios_base::in) == failed)
+      return failed;
+    source_offset += offset - buffered;
+    setg(input.data(), input.data(), input.data());
+    input_pos = input_end = 0;
+  }
+  return pos_type(off_type(source_offset) - (egptr() - gptr()));
+}
+
+// --- TarReader ---
+
+namespace {
+
+constexpr size_t block_size = 512;
+
+// NUL-terminated unless it fills the field
+std::string headerText(const char *field, size_t size) {
+  return {field, std::find(field, field + size, '\0')};
+}
+
+// Octal, or base-256 (high bit set) for GNU sizes of 8 GiB and over
+uint64_t headerNumber(const char *field, size_t size) {
+  uint64_t value = 0;
+  if (static_cast<unsigned char>(field[0]) & 0x80) {
+    value = static_cast<unsigned char>(field[0]) & 0x7f;
+    for (size_t i = 1; i < size; ++i)
+      value = (value << 8) | static_cast<unsigned char>(field[i]);
+    return value;
+  }
+  size_t i = 0;
+  while (i < size && (field[i] == ' ' || field[i] == '\0'))
+    ++i;
+  for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i)
+    value = value * 8 + (field[i] - '0');
+  return value;
+}
+
+bool checksumMatches(const char *block) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < block_size; ++i) {
+    // The checksum field itself counts as spaces
+    sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(block[i]);
+  }
+  return sum == headerNumber(block + 148, 8);
+}
+
+uint64_t padded(uint64_t size) {
+  return (size + block_size - 1) / block_size * block_size;
+}
+
+// pax records: "<length> <key>=<value>\n"
+void applyPaxRecords(std::string_view records, std::string &path,
+                     uint64_t &size, bool &has_size) {
+  while (!records.empty()) {
+    const size_t space = records.find(' ');
+    if (space == std::string_view::npos)
+      break;
+    size_t length = 0;
+    const auto parsed =
+        std::from_chars(records.data(), records.data() + space, length);
+    if (parsed.ptr != records.data() + space || length <= space + 1 ||
+        length > records.size())
+      throw std::runtime_error("Corrupt pax header");
+    const auto record = records.substr(space + 1, length - space - 2);
+    const size_t equals = record.find('=');
+    if (equals != std::string_view::npos) {
+      const auto key = record.substr(0, equals);
+      const auto value = record.substr(equals + 1);
+      if (key == "path") {
+        path = value;
+      } else if (key == "size") {
+        const auto end = value.data() + value.size();
+        if (std::from_chars(value.data(), end, size).ptr != end)
+          throw std::runtime_error("Corrupt pax header");
+        has_size = true;
+      }
+    }
+    records.remove_prefix(length);
+  }
+}
+
+} // namespace
+
+TarReader::TarReader(std::istream &archive) : archive(archive) {}
+
+bool TarReader::readBlock(char *block) {
+  archive.read(block, block_size);
+  const auto count = static_cast<size_t>(archive.gcount());
+  offset += count;
+  if (count == 0)
+    return false;
+  if (count != block_size)
+    throw std::runtime_error("Truncated tar archive");
+  return true;
+}
+
+void TarReader::skip(uint64_t count) {
+  if (count == 0)
+    return;
+  // Plain files seek; decompressed archives have to be read through
+  offset += count;
+  const auto distance = static_cast<std::streamoff>(count);
+  if (archive.rdbuf()->pubseekoff(distance, std::ios_base::cur,
+                                  std::ios_base::in) !=
+      std::streampos(std::streamoff(-1)))
+    return;
+  archive.ignore(distance);
+  if (static_cast<uint64_t>(archive.gcount()) != count)
+    throw std::runtime_error("Truncated tar archive");
+}
+
+std::string TarReader::readText(uint64_t size) {
+  // Long names and pax headers are small; refuse anything absurd
+  if (size > (1 << 20))
+    throw std::runtime_error("Oversized tar extended header");
+  std::string text(size, '\0');
+  archive.read(text.data(), static_cast<std::streamsize>(size));
+  offset += static_cast<uint64_t>(archive.gcount());
+  if (static_cast<uint64_t>(archive.gcount()) != size)
+    throw std::runtime_error("Truncated tar archive");
+  skip(padded(size) - size);
+  return text;
+}
+
+size_t TarReader::read(char *out, size_t size) {
+  const auto want = static_cast<size_t>(std::min<uint64_t>(size, data_left));
+  if (want == 0)
+    return 0;
+  archive.read(out, static_cast<std::streamsize>(want));
+  const auto got = static_cast<size_t>(archive.gcount());
+  offset += got;
+  if (got != want)
+    throw std::runtime_error("Truncated tar archive");
+  data_left -= got;
+  return got;
+}
+
+void TarReader::seek(const ArchiveMember &member) {
+  skip(data_left + padding);
+  if (member.offset < offset)
+    throw std::runtime_error("Tar member lies behind the reader");
+  skip(member.offset - offset);
+  data_left = member.size;
+  padding = padded(member.size) - member.size;
+}
+
+bool TarReader::next(ArchiveMember &member) {
+  skip(data_left + padding);
+  data_left = padding = 0;
+
+  // Overrides from GNU long-name and pax entries for the next header
+  std::string long_name;
+  uint64_t pax_size = 0;
+  bool has_pax_size = false;
+  char block[block_size];
+  while (readBlock(block)) {
+    if (std::all_of(block, block + block_size, [](char c) { return !c; }))
+      return false; // end-of-archive marker
+    if (!checksumMatches(block))
+      throw std::runtime_error("Corrupt tar header");
+
+    uint64_t size = headerNumber(block + 124, 12);
+    const char type = block[156];
+    if (type == 'L') {
+      long_name = headerText(readText(size).c_str(), size);
+      continue;
+    }
+    if (type == 'x') {
+      applyPaxRecords(readText(size), long_name, pax_size, has_pax_size);
+      continue;
+    }
+    if (has_pax_size)
+      size = pax_size;
+    if (type != '0' && type != '\0' && type != '7') {
+      // Directories, links, global pax headers...
+      skip(padded(size));
+      long_name.clear();
+      has_pax_size = false;
+      continue;
+    }
+
+    if (!long_name.empty()) {
+      member.name = std::move(long_name);
+    } else {
+      member.name = headerText(block, 100);
+      const std::string prefix = headerText(block + 345, 155);
+      if (std::string_view(block + 257, 5) == "ustar" && !prefix.empty())
+        member.name = prefix + "/" + member.name;
+    }
+    member.size = size;
+    member.offset = offset;
+    data_left = size;
+    padding = padded(size) - size;
+    return true;
+  }
+  return false;
+}
+
+// --- Member paths ---
+
+namespace {
+
+bool endsWith(std::string_view name, std::string_view suffix) {
+  return name.size() >= suffix.size() &&
+         std::equal(suffix.begin(), suffix.end(),
+                    name.end() - suffix.size(), [](char a, char b) {
+                      return std::tolower(static_cast<unsigned char>(a)) ==
+                             std::tolower(static_cast<unsigned char>(b));
+                    });
+}
+
+} // namespace
+
+std::string archiveMemberPath(std::string_view archive,
+                              std::string_view member) {
+  std::string path(archive);
+  path += archive_separator;
+  path += member;
+  return path;
+}
+
+bool splitArchivePath(std::string_view path, std::string &archive,
+                      std::string &member) {
+  for (size_t pos = path.find(archive_separator);
+       pos != std::string_view::npos;
+       pos = path.find(archive_separator, pos + 1)) {
+    if (isArchiveName(path.substr(0, pos))) {
+      archive = path.substr(0, pos);
+      member = path.substr(pos + archive_separator.size());
+      return true;
+    }
+  }
+  return false;
+}
+
+bool isArchiveName(std::string_view name) {
+  for (const auto suffix : {".tar", ".tar.gz", ".tgz", ".tar.zst", ".tzst"}) {
+    if (endsWith(name, suffix))
+      return true;
+  }
+  return false;
+}
+
+bool isTorrentName(std::string_view name) {
+  for (const auto suffix : {".torrent", ".torrent.gz", ".torrent.zst"}) {
+    if (endsWith(name, suffix))
+      return true;
+  }
+  return false;
+}
+
+// --- Archive access ---
+
+namespace {
+
+// The data of the member a TarReader is positioned at
+class MemberStreambuf : public std::streambuf {
+public:
+  explicit MemberStreambuf(TarReader &tar) : tar(tar), chunk(chunk_size) {}
+
+protected:
+  int_type underflow() override {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    const size_t got = tar.read(chunk.data(), chunk.size());
+    if (got == 0)
+      return traits_type::eof();
+    setg(chunk.data(), chunk.data(), chunk.data() + got);
+    return traits_type::to_int_type(*gptr());
+  }
+
+private:
+  TarReader &tar;
+  std::vector<char> chunk;
+};
+
+// Listings of the archives listed last, most recent at the back. An entry
+// is only used while the file keeps the size and time it had.
+class ListingCache {
+public:
+  static constexpr size_t capacity = 16;
+
+  static ListingCache &shared() {
+    static ListingCache cache;
+    return cache;
+  }
+
+  std::optional<std::vector<ArchiveMember>> find(const std::string &path) {
+    const auto stamp = stampOf(path);
+    const std::lock_guard lock(mutex);
+    const auto it = std::ranges::find(entries, path, &Entry::path);
+    if (!stamp || it == entries.end() || it->stamp != *stamp)
+      return std::nullopt;
+    return it->members;
+  }
+
+  void store(const std::string &path, std::vector<ArchiveMember> members) {
+    const auto stamp = stampOf(path);
+    if (!stamp)
+      return;
+    const std::lock_guard lock(mutex);
+    std::erase_if(entries, [&](const Entry &entry) {
+      return entry.path == path;
+    });
+    if (entries.size() == capacity)
+      entries.erase(entries.begin());
+    entries.push_back({path, *stamp, std::move(members)});
+  }
+
+private:
+  using Stamp = std::pair<std::filesystem::file_time_type, uintmax_t>;
+  struct Entry {
+    std::string path;
+    Stamp stamp;
+    std::vector<ArchiveMember> members;
+  };
+
+  std::mutex mutex;
+  std::vector<Entry> entries;
+
+  static std::optional<Stamp> stampOf(const std::string &path) {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+    if (error)
+      return std::nullopt;
+    const auto size = std::filesystem::file_size(path, error);
+    if (error)
+      return std::nullopt;
+    return Stamp{time, size};
+  }
+};
+
+// Owns the whole chain: file, decompressor, tar position, member bounds
+class MemberStream : public std::istream {
+public:
+  MemberStream(const std::string &path, std::string_view member,
+               const uint64_t max_decoded)
+      : std::istream(nullptr), file(path, std::ios::binary),
+        archive_buffer(file, max_decoded), archive(&archive_buffer), tar(archive),
+        member_buffer(tar) {
+    if (!file)
+      throw std::runtime_error("Cannot open archive: " + path);
+    archive.exceptions(std::ios::badbit);
+    if (const auto members = ListingCache::shared().find(path)) {
+      const auto it = std::ranges::find(*members, member, &ArchiveMember::name);
+      if (it == members->end())
+        throw std::runtime_error("No member " + std::string(member) + " in " +
+                                 path);
+      tar.seek(*it);
+      rdbuf(&member_buffer);
+      exceptions(std::ios::badbit);
+      return;
+    }
+    ArchiveMember entry;
+    while (tar.next(entry)) {
+      if (entry.name == member) {
+        rdbuf(&member_buffer);
+        exceptions(std::ios::badbit);
+        return;
+      }
+    }
+    throw std::runtime_error("No member " + std::string(member) + " in " +
+                             path);
+  }
+
+private:
+  std::ifstream file;
+  DecodingStreambuf archive_buffer;
+  std::istream archive;
+  TarReader tar;
+  MemberStreambuf member_buffer;
+};
+
+} // namespace
+
+std::vector<ArchiveMember> listArchive(const std::string &archive,
+                                       const uint64_t max_decoded) {
+  if (auto members = ListingCache::shared().find(archive))
+    return std::move(*members);
+  std::ifstream file(archive, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("Cannot open archive: " + archive);
+  DecodingStreambuf buffer(file, max_decoded);
+  std::istream decoded(&buffer);
+  decoded.exceptions(std::ios::badbit);
+
+  TarReader tar(decoded);
+  std::vector<ArchiveMember> members;
+  ArchiveMember member;
+  while (tar.next(member))
+    members.push_back(member);
+  ListingCache::shared().store(archive, members);
+  return members;
+}
+
+std::unique_ptr<std::istream>
+openArchiveMember(const std::string &archive, std::string_view member,
+                  const uint64_t max_decoded) {
+  return std::make_unique<MemberStream>(archive, member, max_decoded);
+}
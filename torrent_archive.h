@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compression formats recognised by their magic bytes
+enum class Compression {
+  None,
+  Gzip, // needs a build with TORRENT_HAVE_ZLIB
+  Zstd, // needs a build with TORRENT_HAVE_ZSTD
+};
+
+// Identify the format from the first bytes of a file
+Compression detectCompression(std::string_view head);
+
+/// @brief Stream buffer that decompresses `source` on the fly, detecting the
+/// format from its first bytes; uncompressed input passes through unchanged.
+/// Concatenated gzip members and zstd frames are decoded back to back.
+/// Corrupt or truncated input throws std::runtime_error from the reading
+/// call, so wrap it in a stream with exceptions(std::ios::badbit), as does
+/// decompressing more than `max_output` bytes.
+class DecodingStreambuf : public std::streambuf {
+public:
+  explicit DecodingStreambuf(
+      std::istream &source,
+      uint64_t max_output = std::numeric_limits<uint64_t>::max());
+  ~DecodingStreambuf() override;
+
+  // Known once the first byte has been read
+  Compression compression() const { return format; }
+
+  // Opaque decompressor state
+  class Codec;
+
+protected:
+  int_type underflow() override;
+  // Relative forward seeks are passed on to the source of uncompressed
+  // input, so skipping tar members need not read them
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+
+private:
+  std::istream &source;
+  Compression format = Compression::None;
+  bool started = false;
+  std::unique_ptr<Codec> codec;
+  std::vector<char> input;  // raw bytes read from the source
+  size_t input_pos = 0;     // first raw byte not yet decoded
+  size_t input_end = 0;
+  bool source_done = false;
+  uint64_t source_offset = 0; // raw bytes consumed from the source
+  std::vector<char> output;   // decoded bytes, the get area
+  uint64_t output_limit;
+  uint64_t decoded = 0; // bytes the codec has produced
+  // The last member or frame ended; more input starts another
+  bool frame_done = false;
+  // The codec filled the output buffer and may hold more decoded bytes
+  bool pending = false;
+
+  bool fill();
+};
+
+// One regular file stored in a tar archive
+struct ArchiveMember {
+  std::string name; // path inside the archive
+  uint64_t size;
+  uint64_t offset = 0; // of its data in the uncompressed tar stream
+};
+
+/// @brief Sequential reader for POSIX ustar archives, including GNU long
+/// names and pax "path" records. It never seeks backwards, so it works over
+/// decompressing streams. Malformed headers throw std::runtime_error.
+class TarReader {
+public:
+  explicit TarReader(std::istream &archive);
+
+  // Advance to the next regular file, skipping whatever of the current one
+  // was not read; false at the end of the archive
+  bool next(ArchiveMember &member);
+
+  // Read up to `size` bytes of the current member's data; 0 at its end
+  size_t read(char *out, size_t size);
+
+  // Jump forward to the data of a member listed from this archive before,
+  // without parsing the headers in between
+  void seek(const ArchiveMember &member);
+
+private:
+  std::istream &archive;
+  uint64_t offset = 0; // bytes of the archive stream consumed
+  // Data of the current member not read yet, and the padding after it
+  uint64_t data_left = 0;
+  uint64_t padding = 0;
+
+  bool readBlock(char *block);
+  void skip(uint64_t count);
+  std::string readText(uint64_t size);
+};
+
+// A path such as "bundle.tar.gz!/2024/a.torrent" names a member of a tar
+// archive; the browser lists these and TorrentReader opens them directly.
+inline constexpr std::string_view archive_separator = "!/";
+
+std::string archiveMemberPath(std::string_view archive,
+                              std::string_view member);
+// Split a member path; false for ordinary paths
+bool splitArchivePath(std::string_view path, std::string &archive,
+                      std::string &member);
+
+// .tar, optionally compressed: .tar.gz, .tgz, .tar.zst, .tzst
+bool isArchiveName(std::string_view name);
+// .torrent, optionally compressed: .torrent.gz, .torrent.zst
+bool isTorrentName(std::string_view name);
+
+// Compressed torrents and archives are not decoded past this many bytes,
+// so a small bomb fails cleanly instead of filling memory
+inline constexpr uint64_t decode_budget = uint64_t{256} << 20;
+
+// Compressed archives that decompress to more than this are not listed:
+// the browser lists archives on the UI thread
+inline constexpr uint64_t archive_list_budget = decode_budget;
+
+// Regular-file members of a (possibly compressed) tar archive, in order.
+// Nothing is extracted; throws std::runtime_error if unreadable or if a
+// compressed archive decodes to more than `max_decoded` bytes. Listings are
+// kept for the last few archives, keyed by path, size and modification
+// time, so listing an unchanged archive again reads nothing.
+std::vector<ArchiveMember>
+listArchive(const std::string &archive,
+            uint64_t max_decoded = archive_list_budget);
+
+// Stream the raw bytes of one member, decompressing the archive (but not
+// the member) as needed. A member of an archive listed before is reached
+// through its recorded offset: plain tars seek straight to it, compressed
+// ones are decoded up to it without parsing headers. Throws
+// std::runtime_error if it is not there, or once a compressed archive has
+// decoded to more than `max_decoded` bytes on the way to or through it.
+std::unique_ptr<std::istream>
+openArchiveMember(const std::string &archive, std::string_view member,
+                  uint64_t max_decoded = decode_budget);
@@ -0,0 +1,349 @@
+#include "torrent_creator.h"
+
+#include "sha.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t min_piece_length = merkle_block_size;
+constexpr uint64_t max_auto_piece_length = 16 << 20;
+constexpr uint64_t target_pieces = 1500;
+
+struct SourceFile {
+  fs::path path;
+  std::vector<std::string> components; // relative to the source directory
+  uint64_t length;
+};
+
+// Regular files below `source`, sorted component by component
+std::vector<SourceFile> collectFiles(const fs::path &source) {
+  std::vector<SourceFile> files;
+  if (fs::is_regular_file(source)) {
+    files.push_back({source, {}, fs::file_size(source)});
+    return files;
+  }
+  if (!fs::is_directory(source))
+    throw std::runtime_error("Cannot create a torrent from " +
+                             source.string() + ": not a file or directory");
+  for (const auto &entry : fs::recursive_directory_iterator(
+           source, fs::directory_options::skip_permission_denied)) {
+    if (!entry.is_regular_file())
+      continue;
+    SourceFile file{entry.path(), {}, entry.file_size()};
+    for (const auto &part : entry.path().lexically_relative(source))
+      file.components.push_back(part.string());
+    files.push_back(std::move(file));
+  }
+  if (files.empty())
+    throw std::runtime_error("Cannot create a torrent from " +
+                             source.string() + ": no files");
+  std::ranges::sort(files, {}, &SourceFile::components);
+  return files;
+}
+
+uint64_t pickPieceLength(uint64_t total) {
+  uint64_t length = min_piece_length;
+  while (length < max_auto_piece_length && total / length > target_pieces)
+    length *= 2;
+  return length;
+}
+
+void putInt(std::string &out, long long value) {
+  out += 'i';
+  out += std::to_string(value);
+  out += 'e';
+}
+
+void putString(std::string &out, std::string_view bytes) {
+  out += std::to_string(bytes.size());
+  out += ':';
+  out += bytes;
+}
+
+std::string_view bytesOf(const auto &digest) {
+  return {reinterpret_cast<const char *>(digest.data()), digest.size()};
+}
+
+// One piece on its way to the pool: its bytes, then `pad` zero bytes that
+// only the v1 hash sees, and the width of its v2 merkle subtree
+struct PieceJob {
+  std::string data;
+  uint64_t pad;
+  size_t leaves;
+};
+
+struct PieceHashes {
+  Sha1Digest v1;
+  Sha256Digest v2;
+};
+
+PieceHashes hashPiece(const PieceJob &job, bool hybrid) {
+  PieceHashes result{};
+  Sha1 sha;
+  sha.update(job.data);
+  static const std::string zeros(merkle_block_size, '\0');
+  for (uint64_t left = job.pad; left > 0;) {
+    const size_t chunk =
+        static_cast<size_t>(std::min<uint64_t>(left, zeros.size()));
+    sha.update(std::string_view(zeros).substr(0, chunk));
+    left -= chunk;
+  }
+  result.v1 = sha.finish();
+  if (hybrid)
+    result.v2 = merkleRoot(job.data, job.leaves);
+  return result;
+}
+
+// v2 "file tree": directories are dictionaries, a file is {"": {...}}
+struct TreeNode {
+  std::map<std::string, TreeNode> children;
+  const SourceFile *file = nullptr;
+  Sha256Digest root{};
+};
+
+void putTree(std::string &out, const TreeNode &node) {
+  out += 'd';
+  if (node.file) {
+    putString(out, "");
+    out += 'd';
+    putString(out, "length");
+    putInt(out, static_cast<long long>(node.file->length));
+    if (node.file->length > 0) {
+      putString(out, "pieces root");
+      putString(out, bytesOf(node.root));
+    }
+    out += 'e';
+  }
+  for (const auto &[name, child] : node.children) {
+    putString(out, name);
+    putTree(out, child);
+  }
+  out += 'e';
+}
+
+} // namespace
+
+fs::path creationBase(const fs::path &source) {
+  fs::path base = source.lexically_normal();
+  if (!base.has_filename())
+    base = base.parent_path();
+  return base;
+}
+
+fs::path creationDataRoot(const fs::path &source) {
+  const fs::path root = creationBase(source).parent_path();
+  return root.empty() ? fs::path(".") : root;
+}
+
+std::string createTorrent(const fs::path &source,
+                          const TorrentCreateOptions &options) {
+  const fs::path base = creationBase(source);
+  const std::string name = base.filename().string();
+  if (name.empty() || name == "." || name == "..")
+    throw std::runtime_error("Cannot name a torrent after " + source.string());
+  const std::vector<SourceFile> files = collectFiles(base);
+  const bool single = files.size() == 1 && files[0].components.empty();
+
+  uint64_t total = 0;
+  for (const auto &file : files)
+    total += file.length;
+  const uint64_t piece_length =
+      options.piece_length ? options.piece_length : pickPieceLength(total);
+  if (piece_length < min_piece_length || !std::has_single_bit(piece_length))
+    throw std::runtime_error(
+        "Piece length must be a power of two of at least 16 KiB");
+  const size_t piece_leaves = piece_length / merkle_block_size;
+  const bool hybrid = options.hybrid;
+
+  // Read on this thread, hash on the pool; the window bounds the pieces in
+  // flight and so the memory held by buffers
+  ThreadPool pool(options.threads);
+  const size_t window = std::max<size_t>(
+      pool.size() + 1, options.read_ahead / piece_length);
+  std::deque<std::future<PieceHashes>> in_flight;
+  std::vector<PieceHashes> hashes;
+  auto submit = [&](PieceJob job) {
+    if (in_flight.size() >= window) {
+      hashes.push_back(in_flight.front().get());
+      in_flight.pop_front();
+    }
+    in_flight.push_back(pool.submit(
+        [job = std::move(job), hybrid] { return hashPiece(job, hybrid); }));
+  };
+
+  // Per file, the first piece it starts (hybrid pieces never span files)
+  std::vector<size_t> first_piece(files.size());
+  size_t pieces = 0;
+  std::string piece;
+  piece.reserve(piece_length);
+  for (size_t i = 0; i < files.size(); ++i) {
+    const SourceFile &file = files[i];
+    first_piece[i] = pieces;
+    std::ifstream in(file.path, std::ios::binary);
+    if (!in)
+      throw std::runtime_error("Cannot read " + file.path.string());
+    for (uint64_t left = file.length; left > 0;) {
+      const size_t take =
+          static_cast<size_t>(std::min(left, piece_length - piece.size()));
+      const size_t old = piece.size();
+      piece.resize(old + take);
+      if (!in.read(piece.data() + old, static_cast<std::streamsize>(take)))
+        throw std::runtime_error(file.path.string() +
+                                 " is shorter than when it was listed");
+      left -= take;
+      if (piece.size() == piece_length) {
+        submit({std::move(piece), 0, piece_leaves});
+        ++pieces;
+        piece = {};
+        piece.reserve(piece_length);
+      }
+    }
+    if (hybrid && !piece.empty()) {
+      // End the file's last piece here; v1 sees it padded to full length
+      // unless it is the last piece of all. A file within one piece has a
+      // subtree just wide enough for its blocks.
+      const uint64_t blocks =
+          (piece.size() + merkle_block_size - 1) / merkle_block_size;
+      const size_t leaves = file.length <= piece_length
+                                ? std::bit_ceil(static_cast<size_t>(blocks))
+                                : piece_leaves;
+      const uint64_t pad =
+          i + 1 < files.size() ? piece_length - piece.size() : 0;
+      submit({std::move(piece), pad, leaves});
+      ++pieces;
+      piece = {};
+      piece.reserve(piece_length);
+    }
+  }
+  if (!piece.empty()) {
+    submit({std::move(piece), 0, piece_leaves});
+    ++pieces;
+  }
+  for (auto &pending : in_flight)
+    hashes.push_back(pending.get());
+
+  // v2 roots and piece layers, from the per-piece subtree roots
+  TreeNode tree;
+  std::map<std::string, std::string> layers;
+  if (hybrid) {
+    const Sha256Digest pad = merklePad(piece_leaves);
+    for (size_t i = 0; i < files.size(); ++i) {
+      const SourceFile &file = files[i];
+      TreeNode *node = &tree.children[name];
+      if (!single) {
+        node = &tree;
+        for (const auto &part : file.components)
+          node = &node->children[part];
+      }
+      node->file = &file;
+      if (file.length == 0)
+        continue;
+      const size_t count = (file.length + piece_length - 1) / piece_length;
+      if (count == 1) {
+        node->root = hashes[first_piece[i]].v2;
+        continue;
+      }
+      std::vector<Sha256Digest> layer(count);
+      std::string layer_bytes;
+      for (size_t p = 0; p < count; ++p) {
+        layer[p] = hashes[first_piece[i] + p].v2;
+        layer_bytes += bytesOf(layer[p]);
+      }
+      node->root = merkleRoot(layer, std::bit_ceil(count), pad);
+      layers[std::string(bytesOf(node->root))] = std::move(layer_bytes);
+    }
+  }
+
+  // Keys in byte order, as bencode requires
+  std::string out = "d";
+  if (!options.announce.empty()) {
+    putString(out, "announce");
+    putString(out, options.announce);
+  }
+  if (!options.comment.empty()) {
+    putString(out, "comment");
+    putString(out, options.comment);
+  }
+  putString(out, "created by");
+  putString(out, "TerminalCPP");
+
+  putString(out, "info");
+  out += 'd';
+  if (hybrid) {
+    putString(out, "file tree");
+    putTree(out, tree);
+  }
+  if (single) {
+    putString(out, "length");
+    putInt(out, static_cast<long long>(files[0].length));
+  } else {
+    putString(out, "files");
+    out += 'l';
+    for (size_t i = 0; i < files.size(); ++i) {
+      out += 'd';
+      putString(out, "length");
+      putInt(out, static_cast<long long>(files[i].length));
+      putString(out, "path");
+      out += 'l';
+      for (const auto &part : files[i].components)
+        putString(out, part);
+      out += "ee";
+      const uint64_t tail = files[i].length % piece_length;
+      if (hybrid && tail != 0 && i + 1 < files.size()) {
+        const std::string size = std::to_string(piece_length - tail);
+        out += 'd';
+        putString(out, "attr");
+        putString(out, "p");
+        putString(out, "length");
+        putInt(out, static_cast<long long>(piece_length - tail));
+        putString(out, "path");
+        out += 'l';
+        putString(out, ".pad");
+        putString(out, size);
+        out += "ee";
+      }
+    }
+    out += 'e';
+  }
+  if (hybrid) {
+    putString(out, "meta version");
+    putInt(out, 2);
+  }
+  putString(out, "name");
+  putString(out, name);
+  putString(out, "piece length");
+  putInt(out, static_cast<long long>(piece_length));
+  putString(out, "pieces");
+  out += std::to_string(hashes.size() * sizeof(Sha1Digest));
+  out += ':';
+  for (const auto &hash : hashes)
+    out += bytesOf(hash.v1);
+  if (options.private_torrent) {
+    putString(out, "private");
+    putInt(out, 1);
+  }
+  out += 'e';
+
+  if (hybrid && !layers.empty()) {
+    putString(out, "piece layers");
+    out += 'd';
+    for (const auto &[root, layer] : layers) {
+      putString(out, root);
+      putString(out, layer);
+    }
+    out += 'e';
+  }
+  out += 'e';
+  return out;
+}
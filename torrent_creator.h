@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+struct TorrentCreateOptions {
+  // A power of two of at least 16 KiB; 0 picks one from the total size
+  uint64_t piece_length = 0;
+  // Also write a v2 file tree and piece layers (BEP 52 hybrid). Files are
+  // then padded to piece boundaries in the v1 list with BEP 47 pad files.
+  bool hybrid = false;
+  std::string announce;
+  std::string comment;
+  bool private_torrent = false;
+  // Hashing workers; 0 means one per hardware thread
+  size_t threads = 0;
+  // Bytes read ahead of the hashers; always at least one piece per worker
+  size_t read_ahead = 256 << 20;
+};
+
+/// @brief Builds a bencoded .torrent for a file or a directory tree.
+/// One thread reads the files front to back into piece buffers while a
+/// ThreadPool hashes the pieces already read, so reading and hashing
+/// overlap; at most `read_ahead` bytes are in flight. Files are taken in
+/// path order, the order BEP 52 requires for hybrids. No creation date is
+/// written, so the same input gives the same bytes. Throws
+/// std::runtime_error if the source is missing or empty, a file cannot be
+/// read in full or the piece length is invalid.
+std::string createTorrent(const std::filesystem::path &source,
+                          const TorrentCreateOptions &options = {});
+
+// The file or directory createTorrent() names the torrent after: `source`
+// normalised, without a trailing separator
+std::filesystem::path creationBase(const std::filesystem::path &source);
+
+// The directory holding creationBase(source), where a torrent created from
+// `source` finds its data again; "." for a bare name
+std::filesystem::path creationDataRoot(const std::filesystem::path &source);
@@ -6,16 +6,28 @@
 #include "torrent_reader.h"
 #include <string>
 using namespace ftxui;
+// Piece/file index of the document a tree is built from (see curses.cpp);
+// with one, the info dictionary annotates its files and pieces
+struct PieceLayout;
 Component Empty();
 Component Unimplemented();
+// Shown in place of a container whose contents failed to parse
+Component Broken(const std::string &message);
 Component From(const TorrentValue &val, bool is_last, int depth,
-               TorrentExpander &expander);
-Component FromList(const Component &prefix, const TorrentList &list,
-                   bool is_last, int depth, TorrentExpander &expander);
+               TorrentExpander &expander, PieceLayout *layout = nullptr);
+// With `file_pieces`, the list is info.files and each entry is prefixed
+// with the pieces it covers
+Component FromList(const Component &prefix, const TorrentValue &list,
+                   bool is_last, int depth, TorrentExpander &expander,
+                   PieceLayout *file_pieces = nullptr);
 Component FromString(const TorrentValue &val, bool is_last);
 Component FromNumber(const TorrentValue &val, bool is_last);
 Component FromDict(const Component &prefix, const TorrentValue &val,
-                   bool is_last, int depth, TorrentExpander &expander);
+                   bool is_last, int depth, TorrentExpander &expander,
+                   PieceLayout *layout = nullptr);
+// info.pieces as one row per piece: its digest and the files it spans
+Component FromPieces(const TorrentValue &val, bool is_last,
+                     TorrentExpander &expander, PieceLayout &layout);
 Component FromKeyValue(Component prefix, const TorrentValue &val,
                        const std::string &key, bool is_last, int depth,
                        TorrentExpander &expander);
@@ -54,26 +66,25 @@ inline Component Indentation(const Component &child) {
   });
 }
 
+inline std::string formatStringPreview(std::string_view str,
+                                       StringKind kind) {
+  // The kind was computed at parse time; no need to rescan the bytes
+  if (kind == StringKind::Binary) {
+    return "<binary: " + std::to_string(str.size()) + " bytes>";
+  } else if (str.size() < 60) {
+    return "\"" + std::string(str) + "\"";
+  } else {
+    // Do not cut a UTF-8 file name in the middle of a character
+    return "\"" + std::string(utf8Prefix(str, 57)) + "...\"";
+  }
+}
+
 static std::string formatValuePreview(const TorrentValue &val) {
   if (val.isInt()) {
     return std::to_string(val.asInt());
   } else if (val.isString()) {
     const auto &str = val.asString();
-    // Check if printable
-    bool printable = true;
-    for (const char c : str) {
-      if (!isprint(static_cast<unsigned char>(c)) && c != '\n' && c != '\t') {
-        printable = false;
-        break;
-      }
-    }
-    if (printable && str.size() < 60) {
-      return "\"" + str + "\"";
-    } else if (printable) {
-      return "\"" + str.substr(0, 57) + "...\"";
-    } else {
-      return "<binary: " + std::to_string(str.size()) + " bytes>";
-    }
+    return formatStringPreview(str, str.kind());
   } else if (val.isList()) {
     return "[" + std::to_string(val.asList().size()) + " items]";
   } else if (val.isDict()) {
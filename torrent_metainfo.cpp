@@ -0,0 +1,312 @@
+#include "torrent_metainfo.h"
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+static_assert(metaKey("info") == MetaKey::Info);
+static_assert(metaKey("piece length") == MetaKey::PieceLength);
+static_assert(metaKey("source") == MetaKey::Source);
+static_assert(metaKey("infos") == MetaKey::Unknown);
+
+namespace {
+
+std::runtime_error invalid(const std::string &what) {
+  return std::runtime_error("Invalid torrent: " + what);
+}
+
+// The readers below walk either a TorrentValue tree or a TorrentTape
+// through these overloads. The tape is one contiguous array, so a pass over
+// a large files list stays in cache and allocates no containers.
+const TorrentList &elements(const TorrentValue &list) { return list.asList(); }
+const TapeCursor &elements(const TapeCursor &list) { return list; }
+const TorrentDict &entries(const TorrentValue &dict) { return dict.asDict(); }
+TapeDictView entries(const TapeCursor &dict) { return dict.entries(); }
+
+MetaKey known(const TorrentDict::value_type &entry) {
+  return entry.first.known();
+}
+MetaKey known(const TapeEntry &entry) { return metaKey(entry.key()); }
+std::string_view keyOf(const TorrentDict::value_type &entry) {
+  return entry.first.str();
+}
+std::string_view keyOf(const TapeEntry &entry) { return entry.key(); }
+const TorrentValue &valueOf(const TorrentDict::value_type &entry) {
+  return entry.second;
+}
+const TapeCursor &valueOf(const TapeEntry &entry) { return entry.value(); }
+
+// A value kept past the entry it was found in: tree values by address,
+// cursors (a tape position) by copy
+const TorrentValue *hold(const TorrentValue &value) { return &value; }
+std::optional<TapeCursor> hold(const TapeCursor &value) { return value; }
+template <typename Value>
+using Held = decltype(hold(std::declval<const Value &>()));
+
+// Byte counts must be non-negative integers
+template <typename Value> uint64_t size(const Value &value, MetaKey key) {
+  if (!value.isInt() || value.asInt() < 0)
+    throw invalid(std::string(metaKeyName(key)) +
+                  " must be a non-negative integer");
+  return static_cast<uint64_t>(value.asInt());
+}
+
+template <typename Value>
+std::string_view string(const Value &value, MetaKey key) {
+  if (!value.isString())
+    throw invalid(std::string(metaKeyName(key)) + " must be a string");
+  return value.asString();
+}
+
+} // namespace
+
+TorrentMetainfo::TorrentMetainfo(const TorrentReader &reader) {
+  // Streamed input has no contiguous source to lay a tape over
+  if (reader.source().empty()) {
+    readRoot(reader.getRoot());
+    return;
+  }
+  // The strings borrow from reader.source(), so the tape can go. The
+  // reader's limits bound it too, for callers that read untrusted files.
+  const TorrentTape tape(reader.source(), reader.limits());
+  readRoot(tape.root());
+}
+
+TorrentMetainfo::TorrentMetainfo(const TorrentValue &root) { readRoot(root); }
+
+TorrentMetainfo::TorrentMetainfo(const TorrentTape &tape) {
+  readRoot(tape.root());
+}
+
+template <typename Value> void TorrentMetainfo::readRoot(const Value &root) {
+  if (!root.isDict())
+    throw invalid("root is not a dictionary");
+  Held<Value> info{}, layers{};
+  for (const auto &entry : entries(root)) {
+    switch (known(entry)) {
+    case MetaKey::Announce:
+      announce_url = string(valueOf(entry), MetaKey::Announce);
+      break;
+    case MetaKey::Info:
+      if (!valueOf(entry).isDict())
+        throw invalid("info is not a dictionary");
+      info = hold(valueOf(entry));
+      break;
+    case MetaKey::PieceLayers:
+      layers = hold(valueOf(entry));
+      break;
+    default:
+      break;
+    }
+  }
+  if (!info)
+    throw invalid("missing info dictionary");
+  readInfo(*info);
+  if (layers)
+    readPieceLayers(*layers);
+}
+
+template <typename Value> void TorrentMetainfo::readInfo(const Value &info) {
+  Held<Value> files{}, length{}, file_tree{};
+  for (const auto &entry : entries(info)) {
+    const auto &value = valueOf(entry);
+    switch (const MetaKey meta = known(entry)) {
+    case MetaKey::Name:
+      torrent_name = string(value, meta);
+      break;
+    case MetaKey::PieceLength:
+      piece_length = size(value, meta);
+      break;
+    case MetaKey::Pieces: {
+      const std::string_view bytes = string(value, meta);
+      if (bytes.size() % digest_size != 0)
+        throw invalid("pieces is not a whole number of SHA-1 digests");
+      piece_digests = {reinterpret_cast<const unsigned char *>(bytes.data()),
+                       bytes.size()};
+      break;
+    }
+    case MetaKey::Private:
+      private_flag = value.isInt() && value.asInt() == 1;
+      break;
+    case MetaKey::MetaVersion:
+      if (value.isInt())
+        meta_version = value.asInt();
+      break;
+    case MetaKey::Files:
+      files = hold(value);
+      break;
+    case MetaKey::Length:
+      length = hold(value);
+      break;
+    case MetaKey::FileTree:
+      file_tree = hold(value);
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (file_tree) {
+    if (!file_tree->isDict())
+      throw invalid("file tree is not a dictionary");
+    readFileTree(*file_tree);
+  }
+
+  if (files) {
+    if (!files->isList())
+      throw invalid("files is not a list");
+    multi_file = true;
+    readFiles(*files);
+  } else if (length) {
+    path_parts.push_back(torrent_name);
+    total_size = size(*length, MetaKey::Length);
+    file_list.push_back({{path_parts.data(), 1}, total_size, 0});
+  }
+}
+
+template <typename Value> void TorrentMetainfo::readFiles(const Value &files) {
+  // Path spans are taken once every component is in place, so path_parts
+  // never reallocates under them
+  const auto &list = elements(files);
+  std::vector<size_t> path_starts;
+  file_list.reserve(list.size());
+  path_starts.reserve(list.size() + 1);
+  path_parts.reserve(list.size() * 2);
+  for (const auto &entry : list) {
+    if (!entry.isDict())
+      throw invalid("files entry is not a dictionary");
+    path_starts.push_back(path_parts.size());
+    uint64_t length = 0;
+    bool has_length = false;
+    bool pad = false;
+    for (const auto &field : entries(entry)) {
+      const auto &value = valueOf(field);
+      switch (const MetaKey meta = known(field)) {
+      case MetaKey::Length:
+        length = size(value, meta);
+        has_length = true;
+        break;
+      case MetaKey::Path:
+        if (!value.isList())
+          throw invalid("path is not a list");
+        for (const auto &component : elements(value))
+          path_parts.push_back(string(component, meta));
+        break;
+      case MetaKey::Attr:
+        pad = string(value, meta).find('p') != std::string_view::npos;
+        break;
+      default:
+        break;
+      }
+    }
+    if (!has_length)
+      throw invalid("files entry without a length");
+    if (length > UINT64_MAX - total_size)
+      throw invalid("total size overflows");
+    file_list.push_back({{}, length, total_size, pad});
+    total_size += length;
+  }
+  path_starts.push_back(path_parts.size());
+  for (size_t i = 0; i < file_list.size(); ++i) {
+    file_list[i].path = {path_parts.data() + path_starts[i],
+                         path_starts[i + 1] - path_starts[i]};
+  }
+}
+
+template <typename Value>
+void TorrentMetainfo::readFileTree(const Value &tree) {
+  // Directories are dictionaries keyed by name; a file is the directory
+  // entry holding an empty key, whose value has its length and root. Walked
+  // with an explicit stack, like the parser, so depth costs no recursion.
+  using Entries = decltype(entries(tree));
+  struct Frame {
+    decltype(std::declval<Entries>().begin()) next, end;
+  };
+  std::vector<Frame> stack{{entries(tree).begin(), entries(tree).end()}};
+  std::vector<std::string_view> directory; // one name per frame but the first
+  std::vector<size_t> path_starts;
+  while (!stack.empty()) {
+    Frame &top = stack.back();
+    if (top.next == top.end) {
+      stack.pop_back();
+      if (!directory.empty())
+        directory.pop_back();
+      continue;
+    }
+    const auto &entry = *top.next;
+    ++top.next;
+    const auto &value = valueOf(entry);
+    if (!value.isDict())
+      throw invalid("file tree entry is not a dictionary");
+    if (!keyOf(entry).empty()) {
+      directory.push_back(keyOf(entry));
+      stack.push_back({entries(value).begin(), entries(value).end()});
+      continue;
+    }
+
+    if (directory.empty())
+      throw invalid("file tree file without a name");
+    TreeFile file{{}, 0, {}, {}};
+    bool has_length = false;
+    for (const auto &field : entries(value)) {
+      const auto &property = valueOf(field);
+      switch (const MetaKey meta = known(field)) {
+      case MetaKey::Length:
+        file.length = size(property, meta);
+        has_length = true;
+        break;
+      case MetaKey::PiecesRoot: {
+        const std::string_view bytes = string(property, meta);
+        if (bytes.size() != v2_digest_size)
+          throw invalid("pieces root is not a SHA-256 digest");
+        file.root = {reinterpret_cast<const unsigned char *>(bytes.data()),
+                     bytes.size()};
+        break;
+      }
+      default:
+        break;
+      }
+    }
+    if (!has_length)
+      throw invalid("file tree file without a length");
+    if (file.length > 0 && file.root.empty())
+      throw invalid("file tree file without a pieces root");
+    path_starts.push_back(tree_parts.size());
+    tree_parts.insert(tree_parts.end(), directory.begin(), directory.end());
+    tree_files.push_back(file);
+  }
+  path_starts.push_back(tree_parts.size());
+  for (size_t i = 0; i < tree_files.size(); ++i) {
+    tree_files[i].path = {tree_parts.data() + path_starts[i],
+                          path_starts[i + 1] - path_starts[i]};
+  }
+}
+
+template <typename Value>
+void TorrentMetainfo::readPieceLayers(const Value &layers) {
+  if (!layers.isDict())
+    throw invalid("piece layers is not a dictionary");
+  // Keyed once by pieces root, so matching files costs O(1) each on the
+  // tape too, whose dictionaries have no lookup faster than a scan
+  std::unordered_map<std::string_view, Held<Value>> by_root;
+  for (const auto &entry : entries(layers))
+    by_root.insert_or_assign(keyOf(entry), hold(valueOf(entry)));
+  for (auto &file : tree_files) {
+    if (file.length <= piece_length || piece_length == 0)
+      continue;
+    const std::string_view root(reinterpret_cast<const char *>(file.root.data()),
+                                file.root.size());
+    const auto entry = by_root.find(root);
+    if (entry == by_root.end())
+      continue;
+    const std::string_view bytes = string(*entry->second, MetaKey::PieceLayers);
+    const uint64_t pieces = (file.length + piece_length - 1) / piece_length;
+    if (bytes.size() / v2_digest_size != pieces ||
+        bytes.size() % v2_digest_size != 0)
+      throw invalid("piece layer does not match its file's length");
+    file.layer = {reinterpret_cast<const unsigned char *>(bytes.data()),
+                  bytes.size()};
+  }
+}
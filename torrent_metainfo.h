@@ -0,0 +1,103 @@
+#pragma once
+
+#include "torrent_reader.h"
+#include "torrent_tape.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/// @brief Typed view of a torrent's metainfo. The fields every consumer
+/// needs are resolved in a single pass over the document when the view is
+/// built, so the accessors below are plain loads. Strings point into the
+/// source, so the view must not outlive the TorrentReader (or tree, or the
+/// tape's source) it was built from. Throws std::runtime_error if the
+/// document is not a torrent.
+class TorrentMetainfo {
+public:
+  static constexpr size_t digest_size = 20;    // SHA-1, one per v1 piece
+  static constexpr size_t v2_digest_size = 32; // SHA-256 merkle hashes
+
+  struct File {
+    // Path components; a single-file torrent's one file is just {name}
+    std::span<const std::string_view> path;
+    uint64_t length;
+    uint64_t offset; // of the first byte in the concatenated content
+    // BEP 47 padding file ("attr" contains 'p'): zeros that are never
+    // stored, aligning the next file to a piece boundary
+    bool pad = false;
+  };
+
+  // A file of the v2 "file tree" (BEP 52). v2 pieces never span files.
+  struct TreeFile {
+    std::span<const std::string_view> path;
+    uint64_t length;
+    // Merkle root over the file's 16 KiB blocks; empty for empty files
+    std::span<const unsigned char> root;
+    // The file's "piece layers" entry, one hash per piece; empty for files
+    // of at most one piece, and when the torrent carries no piece layers
+    std::span<const unsigned char> layer;
+  };
+
+  // Walks a TorrentTape of reader.source() rather than the reader's tree,
+  // so a lazy reader's files and pieces are never materialized for it.
+  // Streamed readers have no source() and are read through their tree.
+  explicit TorrentMetainfo(const TorrentReader &reader);
+  explicit TorrentMetainfo(const TorrentValue &root);
+  // Only the tape's source has to outlive the view, not the tape
+  explicit TorrentMetainfo(const TorrentTape &tape);
+
+  // Movable, but copies would point into the original's path storage
+  TorrentMetainfo(const TorrentMetainfo &) = delete;
+  TorrentMetainfo &operator=(const TorrentMetainfo &) = delete;
+  TorrentMetainfo(TorrentMetainfo &&) = default;
+  TorrentMetainfo &operator=(TorrentMetainfo &&) = default;
+
+  std::string_view name() const { return torrent_name; }
+  std::string_view announce() const { return announce_url; }
+  // 1 unless the torrent declares "meta version" (2 for v2 and hybrids)
+  long long metaVersion() const { return meta_version; }
+  bool isPrivate() const { return private_flag; }
+
+  uint64_t pieceLength() const { return piece_length; }
+  // v1 pieces; 0 for v2-only torrents
+  size_t pieceCount() const { return piece_digests.size() / digest_size; }
+  // All v1 piece digests back to back
+  std::span<const unsigned char> pieces() const { return piece_digests; }
+  std::span<const unsigned char, digest_size> piece(size_t index) const {
+    return piece_digests.subspan(index * digest_size)
+        .first<digest_size>();
+  }
+
+  // In content order; empty for v2-only torrents (see "file tree")
+  const std::vector<File> &files() const { return file_list; }
+  bool isMultiFile() const { return multi_file; }
+  // v2 files in file tree order; empty for v1-only torrents
+  const std::vector<TreeFile> &fileTree() const { return tree_files; }
+  uint64_t totalSize() const { return total_size; }
+
+private:
+  std::string_view torrent_name;
+  std::string_view announce_url;
+  long long meta_version = 1;
+  bool private_flag = false;
+  uint64_t piece_length = 0;
+  std::span<const unsigned char> piece_digests;
+  std::vector<File> file_list;
+  // Every file's path components, back to back; File::path spans into it
+  std::vector<std::string_view> path_parts;
+  bool multi_file = false;
+  uint64_t total_size = 0;
+  std::vector<TreeFile> tree_files;
+  // Path components of the file tree, like path_parts
+  std::vector<std::string_view> tree_parts;
+
+  // Over a TorrentValue tree or a TapeCursor; see torrent_metainfo.cpp
+  template <typename Value> void readRoot(const Value &root);
+  template <typename Value> void readInfo(const Value &info);
+  template <typename Value> void readFiles(const Value &files);
+  template <typename Value> void readFileTree(const Value &tree);
+  template <typename Value> void readPieceLayers(const Value &layers);
+};
@@ -1,57 +1,204 @@
 #include "torrent_reader.h"
 
+#include "index_cache.h"
+#include "thread_pool.h"
+#include "torrent_archive.h"
+
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <thread>
+
+namespace {
+
+// Reads a buffer in place, for decoding files that are already in memory
+class ViewStreambuf : public std::streambuf {
+public:
+  explicit ViewStreambuf(std::string_view bytes) {
+    char *begin = const_cast<char *>(bytes.data());
+    setg(begin, begin, begin + bytes.size());
+  }
+};
+
+// Span of the value of top-level dictionary key `key`, found by walking the
+// root and stepping over the other values. With an index, containers are
+// jumped over and the value's end is looked up rather than scanned for.
+std::optional<SourceSpan> findValueSpan(std::string_view source,
+                                        std::string_view key,
+                                        const StructuralIndex *index) {
+  class Finder : public BencodeHandler {
+  public:
+    Finder(std::string_view key, std::function<size_t()> position)
+        : key(key), position(std::move(position)) {}
+    BencodeAction onKey(std::string_view k) override {
+      if (k != key)
+        return BencodeAction::Skip;
+      begin = position();
+      return BencodeAction::Stop;
+    }
+    std::string_view key;
+    std::function<size_t()> position;
+    std::optional<size_t> begin;
+  };
+  const auto find = [&](auto &parser) {
+    Finder finder(key, [&parser] { return parser.position(); });
+    parser.parse(finder);
+    return finder.begin;
+  };
+
+  if (source.empty() || source.front() != 'd')
+    return std::nullopt;
+  try {
+    std::optional<size_t> begin;
+    if (index) {
+      BencodeParser parser(*index, 0);
+      begin = find(parser);
+    } else {
+      BencodeParser parser(source);
+      begin = find(parser);
+    }
+    if (!begin)
+      return std::nullopt;
+    if (index && (source[*begin] == 'd' || source[*begin] == 'l')) {
+      // Containers are numbered in source order
+      const auto nodes = index->containers();
+      const auto node = std::lower_bound(
+          nodes.begin(), nodes.end(), *begin,
+          [](const auto &container, size_t at) { return container.begin < at; });
+      // A snapshot that left this container out falls back to skipping
+      if (node != nodes.end() && node->begin == *begin)
+        return SourceSpan{*begin, node->end};
+    }
+    BencodeParser value(source.substr(*begin));
+    value.skip();
+    return SourceSpan{*begin, *begin + value.position()};
+  } catch (const std::exception &) {
+    return std::nullopt; // e.g. a projected stream that stopped early
+  }
+}
+
+// Threads an eager read uses, with 0 resolved to one per core. parse()
+// decides whether to index by this, so it must agree with parseSource().
+size_t workerCount(const TorrentReaderOptions &options) {
+  if (options.threads != 0)
+    return options.threads;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // namespace
+
 // --- TorrentValue Implementation ---
 
-// Helper to print variants recursively
-struct ValuePrinter {
-  std::ostream &os;
-
-  void operator()(const TorrentInt &val) const { os << val; }
-  void operator()(const TorrentString &val) const {
-    // Print strings generally; for torrents, some are binary, so be careful.
-    // For display purposes, we might want to quote them or print hex if
-    // non-printable.
-    bool printable = true;
-    for (const char c : val) {
-      if (!isprint(static_cast<unsigned char>(c))) {
-        printable = false;
-        break;
+namespace {
+
+void printScalar(std::ostream &os, const TorrentValue &val) {
+  if (val.isInt()) {
+    os << val.asInt();
+    return;
+  }
+  // For torrents, some strings are binary (hashes, pieces); the parser
+  // already classified them, so this never rescans the bytes
+  const TorrentString &str = val.asString();
+  if (str.isText())
+    os << "\"" << str << "\"";
+  else
+    os << "<binary data: " << str.size() << " bytes>";
+}
+
+// Moves the children of `value` that are non-empty containers to `pending`
+void detachContainers(TorrentValue &value, std::vector<TorrentValue> &pending) {
+  const auto take = [&pending](TorrentValue &child) {
+    const auto *list = std::get_if<TorrentList>(&child.data);
+    const auto *dict = std::get_if<TorrentDict>(&child.data);
+    if ((list && !list->empty()) || (dict && !dict->empty()))
+      pending.push_back(std::move(child));
+  };
+  if (auto *list = std::get_if<TorrentList>(&value.data))
+    std::ranges::for_each(*list, take);
+  else if (auto *dict = std::get_if<TorrentDict>(&value.data))
+    for (auto &entry : *dict)
+      take(entry.second);
+}
+
+} // namespace
+
+std::ostream &operator<<(std::ostream &os, const TorrentValue &val) {
+  // Containers still being printed, innermost last, with the index of the
+  // next child of each
+  std::vector<std::pair<const TorrentValue *, size_t>> open;
+  const TorrentValue *next = &val;
+  while (true) {
+    if (next) {
+      next->materialize();
+      if (next->isList() || next->isDict()) {
+        os << (next->isList() ? "[" : "{");
+        open.emplace_back(next, 0);
+      } else {
+        printScalar(os, *next);
       }
+      next = nullptr;
     }
-    if (printable)
-      os << "\"" << val << "\"";
-    else
-      os << "<binary data: " << val.size() << " bytes>";
-  }
-  void operator()(const TorrentList &val) const {
-    os << "[";
-    for (size_t i = 0; i < val.size(); ++i) {
-      os << val[i];
-      if (i < val.size() - 1)
-        os << ", ";
+    if (open.empty())
+      return os;
+    auto &[container, child] = open.back();
+    const bool is_list = container->isList();
+    const size_t size = is_list ? container->asList().size()
+                                : container->asDict().size();
+    if (child == size) {
+      os << (is_list ? "]" : "}");
+      open.pop_back();
+      continue;
     }
-    os << "]";
-  }
-  void operator()(const TorrentDict &val) const {
-    os << "{";
-    auto it = val.begin();
-    while (it != val.end()) {
-      os << "\"" << it->first << "\": " << it->second;
-      if (++it != val.end())
-        os << ", ";
+    if (child > 0)
+      os << ", ";
+    if (is_list) {
+      next = &container->asList()[child];
+    } else {
+      const auto &entry = *(container->asDict().begin() + child);
+      os << "\"" << entry.first << "\": ";
+      next = &entry.second;
     }
-    os << "}";
+    ++child;
   }
-};
+}
 
-std::ostream &operator<<(std::ostream &os, const TorrentValue &val) {
-  std::visit(ValuePrinter{os}, val.data);
-  return os;
+void TorrentValue::releaseChildren() {
+  std::vector<TorrentValue> pending;
+  detachContainers(*this, pending);
+  while (!pending.empty()) {
+    TorrentValue value = std::move(pending.back());
+    pending.pop_back();
+    detachContainers(value, pending);
+    // What is left are scalars and empty containers
+    value.data = TorrentInt{};
+  }
+}
+
+void TorrentValue::materialize() const {
+  const auto *lazy = std::get_if<TorrentLazy>(&data);
+  if (!lazy)
+    return;
+  // A freshly built index validated the whole document, but one loaded
+  // from a cache snapshot only had its containers checked for nesting, so
+  // the contents may still be malformed or containers left out. The value
+  // stays lazy if they are.
+  BencodeParser parser(*lazy->index, lazy->node);
+  TorrentTreeBuilder builder(*lazy->index, lazy->node, lazy->resource);
+  try {
+    parser.parse(builder);
+  } catch (const ParseLimitError &) {
+    throw;
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("Parsing error: ") + e.what());
+  }
+  data = std::move(builder.result().data);
 }
 
 // --- TorrentReader Implementation ---
 
-TorrentReader::TorrentReader(const std::string &filepath) {
+TorrentReader::TorrentReader(const std::string &filepath,
+                             const TorrentReaderOptions &options)
+    : parse_limits(options.limits) {
   // 1. Basic extension check
   if (filepath.size() < 9 ||
       filepath.substr(filepath.size() - 8) != ".torrent") {
@@ -60,159 +207,609 @@ TorrentReader::TorrentReader(const std::string &filepath) {
     // .torrent extension");
   }
 
-  // 2. Read File
+  // Members of tar bundles are streamed out of the archive
+  std::string archive, member;
+  if (splitArchivePath(filepath, archive, member)) {
+    readStream(*openArchiveMember(archive, member, options.max_decoded),
+               options);
+    return;
+  }
+
+  // 2. Map or read the file; pipes and devices cannot seek to find their
+  // size, so they are read as a stream
+  std::error_code error;
+  if (!std::filesystem::is_regular_file(filepath, error)) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Cannot open file: " + filepath);
+    }
+    readStream(file, options);
+    return;
+  }
+  if (!loadFile(filepath, options.load_mode)) {
+    throw std::runtime_error("Cannot open file: " + filepath);
+  }
+
+  // Compressed files are decoded as a stream; the tree then points into
+  // the decoded blocks, so the compressed bytes can go
+  if (detectCompression(source_data) != Compression::None) {
+    const std::vector<char> compressed = std::move(buffer);
+    ViewStreambuf view(source_data);
+    std::istream input(&view);
+    readStream(input, options);
+    mapping.close();
+    return;
+  }
+
+  // 3. Parse
+  parseSource(filepath, options);
+}
+
+std::expected<TorrentReader, ParseError>
+TorrentReader::parse(const std::string &filepath,
+                     const TorrentReaderOptions &options) {
+  // The decoding and archive layers report failures by throwing; they are
+  // the uncommon case, so take the throwing path and convert
+  const auto throwing = [&]() -> std::expected<TorrentReader, ParseError> {
+    try {
+      return TorrentReader(filepath, options);
+    } catch (const ParseLimitError &e) {
+      return std::unexpected(
+          ParseError{ParseErrorKind::LimitExceeded, 0, e.what()});
+    } catch (const std::bad_alloc &) {
+      throw;
+    } catch (const std::exception &e) {
+      return std::unexpected(ParseError{ParseErrorKind::Stream, 0, e.what()});
+    }
+  };
+
+  const auto unreadable = [&] {
+    return std::unexpected(
+        ParseError{ParseErrorKind::Io, 0, "Cannot open file: " + filepath});
+  };
+  std::string archive, member;
+  if (splitArchivePath(filepath, archive, member))
+    return throwing();
+  std::error_code error;
+  if (!std::filesystem::exists(filepath, error))
+    return unreadable();
+  if (!std::filesystem::is_regular_file(filepath, error))
+    return throwing();
+
+  TorrentReader reader;
+  reader.parse_limits = options.limits;
+  if (!reader.loadFile(filepath, options.load_mode))
+    return unreadable();
+  if (detectCompression(reader.source_data) != Compression::None)
+    return throwing();
+
+  const std::string_view source = reader.source_data;
+  if (!source.empty() && source.front() != 'd')
+    return std::unexpected(ParseError{ParseErrorKind::NotADictionary, 0, {}});
+  // Lazy and threaded reads index the document, which is always strict
+  const bool indexed = options.projection.empty() &&
+                       (options.lazy || workerCount(options) > 1);
+  // An indexed read validates while indexing, or not at all on a cache hit,
+  // so only the tree builders need a scan of their own
+  if (indexed) {
+    if (const auto built = reader.buildIndex(filepath, options); !built)
+      return std::unexpected(built.error());
+  } else if (const auto valid = validateBencode(
+                 source, options.limits,
+                 options.parse_mode == TorrentParseMode::Strict);
+             !valid) {
+    return std::unexpected(valid.error());
+  }
+
+  // Known good from here on, so checking again would be wasted work
+  TorrentReaderOptions trusted = options;
+  trusted.parse_mode = TorrentParseMode::Trusted;
+  reader.parseSource(filepath, trusted);
+  return reader;
+}
+
+bool TorrentReader::loadFile(const std::string &filepath,
+                             const TorrentLoadMode mode) {
+  if (mode == TorrentLoadMode::Map && mapping.open(filepath)) {
+    source_data = mapping.view();
+    return true;
+  }
   std::ifstream file(filepath, std::ios::binary);
   if (!file) {
-    throw std::runtime_error("Cannot open file: " + filepath);
+    return false;
   }
 
-  // Read entire file into string
+  // Read entire file into the owned buffer
   file.seekg(0, std::ios::end);
-  size_t size = file.tellg();
-  source_data.resize(size);
+  const auto size = file.tellg();
+  if (size < 0) {
+    return false;
+  }
+  buffer.resize(static_cast<size_t>(size));
   file.seekg(0, std::ios::beg);
-  file.read(&source_data[0], size);
+  file.read(buffer.data(), size);
+  if (!file) {
+    return false;
+  }
+  source_data = {buffer.data(), buffer.size()};
+  return true;
+}
 
-  // 3. Parse
+void TorrentReader::parseSource(const std::string &filepath,
+                                const TorrentReaderOptions &options) {
   if (source_data.empty()) {
     throw std::runtime_error("File is empty");
   }
 
   // Check if it starts with 'd' (Torrents are dictionaries)
-  if (peek() != 'd') {
+  if (source_data.front() != 'd') {
     throw std::runtime_error(
         "Invalid torrent file: Must start with a dictionary 'd'");
   }
 
+  std::pmr::memory_resource *resource =
+      createRoot(options, source_data.size());
+  // Indexing first only pays off with other cores to hand work to
+  const size_t threads = workerCount(options);
+
+  const bool projected = !options.projection.empty();
+  try {
+    // parse() may have indexed the document already
+    const auto indexed = [&] {
+      if (index)
+        return;
+      if (auto built = buildIndex(filepath, options); !built) {
+        if (built.error().kind == ParseErrorKind::LimitExceeded)
+          throw ParseLimitError(built.error().detail);
+        throw std::runtime_error(built.error().message());
+      }
+    };
+    if (options.lazy && !projected) {
+      indexed();
+      info_span = findValueSpan(source_data, "info", index.get());
+      *root = TorrentValue(TorrentLazy{index.get(), 0, resource});
+    } else if (threads > 1 && !projected) {
+      indexed();
+      info_span = findValueSpan(source_data, "info", index.get());
+      parseParallel(resource, options, threads);
+    } else {
+      TorrentTreeBuilder builder(resource);
+      std::optional<ProjectionHandler> projection;
+      if (projected)
+        projection.emplace(options.projection, builder);
+      BencodeHandler &handler =
+          projection ? static_cast<BencodeHandler &>(*projection) : builder;
+      const auto run = [&](auto &&parser) {
+        // A projection may close info early, so its span is found later
+        if (!projected)
+          builder.recordSpan("info", [&parser] { return parser.position(); });
+        parser.parse(handler);
+      };
+      switch (options.parse_mode) {
+      case TorrentParseMode::Strict:
+        run(BencodeParser(source_data, options.limits));
+        break;
+      case TorrentParseMode::Lenient:
+        run(LenientBencodeParser(source_data, options.limits));
+        break;
+      case TorrentParseMode::Trusted:
+        run(TrustedBencodeParser(source_data, options.limits));
+        break;
+      }
+      info_span = builder.span();
+      *root = std::move(builder.result());
+    }
+    info_searched = !projected;
+  } catch (const ParseLimitError &) {
+    throw; // keep the type so callers can tell a budget from a syntax error
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("Parsing error: ") + e.what());
+  }
+}
+
+std::expected<void, ParseError>
+TorrentReader::buildIndex(const std::string &filepath,
+                          const TorrentReaderOptions &options) {
+  std::optional<IndexCache> cache;
+  if (!options.cache_dir.empty()) {
+    cache.emplace(options.cache_dir);
+    index = cache->load(filepath, source_data, index_snapshot);
+  }
+  if (index) {
+    // The snapshot may have been written under looser limits
+    try {
+      index->checkLimits(options.limits);
+    } catch (const ParseLimitError &e) {
+      index.reset();
+      index_snapshot.close();
+      return std::unexpected(
+          ParseError{ParseErrorKind::LimitExceeded, 0, e.what()});
+    }
+    return {};
+  }
+  auto built = StructuralIndex::build(source_data, options.limits);
+  if (!built)
+    return std::unexpected(std::move(built.error()));
+  index = std::make_unique<StructuralIndex>(std::move(*built));
+  if (cache)
+    cache->store(filepath, source_data, *index);
+  return {};
+}
+
+namespace {
+
+// Lists with fewer elements are not worth handing to the pool
+constexpr size_t parallel_list_min = 1024;
+// Elements per task, at least; below this scheduling costs more than parsing
+constexpr size_t parallel_range_min = 256;
+
+// Fully parse the lazy elements list[first, last) in place, reusing one
+// builder for the whole range
+void parseRange(const TorrentList &list, size_t first, size_t last,
+                std::pmr::memory_resource *resource) {
+  TorrentTreeBuilder builder(resource);
+  for (size_t i = first; i < last; ++i) {
+    const auto *lazy = std::get_if<TorrentLazy>(&list[i].data);
+    if (!lazy)
+      continue;
+    BencodeParser(*lazy->index, lazy->node).parse(builder);
+    list[i].data = std::move(builder.result().data);
+  }
+}
+
+} // namespace
+
+// Expand the indexed document level by level on this thread. A large
+// list is expanded one level, leaving its elements lazy, and the elements are
+// split into ranges that workers parse in place: every result lands in its
+// final slot, so the order (and the tree) matches a sequential parse without
+// any stitching copies.
+void TorrentReader::parseParallel(std::pmr::memory_resource *resource,
+                                  const TorrentReaderOptions &options,
+                                  const size_t threads) {
+  *root = TorrentValue(TorrentLazy{index.get(), 0, resource});
+
+  ThreadPool pool(threads);
+  std::vector<std::future<void>> ranges;
+  std::vector<const TorrentValue *> pending{root.get()};
+  while (!pending.empty()) {
+    const TorrentValue *current = pending.back();
+    pending.pop_back();
+    if (!current->isLazy())
+      continue;
+    current->materialize();
+
+    if (const auto *dict = std::get_if<TorrentDict>(&current->data)) {
+      for (const auto &[key, item] : *dict)
+        pending.push_back(&item);
+      continue;
+    }
+    const auto &list = std::get<TorrentList>(current->data);
+    if (list.size() < parallel_list_min) {
+      for (const auto &item : list)
+        pending.push_back(&item);
+      continue;
+    }
+    const size_t step = std::max(parallel_range_min,
+                                 (list.size() + pool.size() * 4 - 1) /
+                                     (pool.size() * 4));
+    for (size_t first = 0; first < list.size(); first += step) {
+      std::pmr::memory_resource *target = resource;
+      if (options.arena) {
+        range_arenas.push_back(
+            std::make_unique<std::pmr::monotonic_buffer_resource>());
+        target = range_arenas.back().get();
+      }
+      const size_t last = std::min(first + step, list.size());
+      ranges.push_back(pool.submit([&list, first, last, target] {
+        parseRange(list, first, last, target);
+      }));
+    }
+  }
+  for (auto &range : ranges)
+    range.get();
+  // Nothing is lazy any more
+  index.reset();
+  index_snapshot.close();
+}
+
+TorrentReader::TorrentReader(std::istream &input,
+                             const TorrentReaderOptions &options)
+    : parse_limits(options.limits) {
+  readStream(input, options);
+}
+
+void TorrentReader::readStream(std::istream &raw_input,
+                               const TorrentReaderOptions &options) {
+  // Input blocks always go to the arena; containers only if asked to
+  arena = std::make_unique<std::pmr::monotonic_buffer_resource>();
+  std::pmr::memory_resource *resource = createRoot(options, 0);
+  TorrentTreeBuilder builder(resource);
+  std::optional<ProjectionHandler> projection;
+  if (!options.projection.empty())
+    projection.emplace(options.projection, builder);
+  BencodePushParser parser(
+      projection ? static_cast<BencodeHandler &>(*projection) : builder,
+      options.limits);
+  if (!projection)
+    builder.recordSpan("info", [&parser] { return parser.position(); });
+  // gzip and zstd input is decompressed on the way in
+  DecodingStreambuf decoder(raw_input, options.max_decoded);
+  std::istream input(&decoder);
+  input.exceptions(std::ios::badbit);
+
+  // Every block is fed whole and the parser's carry released, so a token
+  // cut off at the end of one block is copied to the front of the next,
+  // sized to hold all of it; string views then always point into a block
+  // and the tree borrows them.
+  constexpr size_t block_size = 64 * 1024;
   try {
-    root = parseElement();
+    while (!parser.complete() && input) {
+      const size_t carried = parser.carried();
+      const size_t size =
+          carried + std::max(block_size, parser.pending() - carried);
+      auto *block = static_cast<char *>(arena->allocate(size, 1));
+      if (carried > 0) {
+        const std::string_view last = stream_blocks.back().bytes;
+        std::copy(last.end() - static_cast<std::ptrdiff_t>(carried),
+                  last.end(), block);
+      }
+      input.read(block + carried, static_cast<std::streamsize>(size - carried));
+      const auto count = static_cast<size_t>(input.gcount());
+      if (count == 0)
+        break;
+      if (stream_blocks.empty() && block[0] != 'd') {
+        throw std::runtime_error(
+            "Invalid torrent file: Must start with a dictionary 'd'");
+      }
+      stream_blocks.push_back({parser.position(), {block, carried + count}});
+      parser.releaseCarry();
+      parser.feed(stream_blocks.back().bytes);
+    }
+    if (stream_blocks.empty())
+      throw std::runtime_error("File is empty");
+    parser.finish();
+  } catch (const ParseLimitError &) {
+    throw;
   } catch (const std::exception &e) {
     throw std::runtime_error(std::string("Parsing error: ") + e.what());
   }
+  source_data = {};
+  info_span = builder.span();
+  info_searched = !projection;
+  *root = std::move(builder.result());
+}
+
+std::pmr::memory_resource *
+TorrentReader::createRoot(const TorrentReaderOptions &options,
+                          const size_t size_hint) {
+  if (!options.arena) {
+    root = {new TorrentValue, RootDeleter{false}};
+    return std::pmr::get_default_resource();
+  }
+  if (!arena) {
+    // The source size is a cheap upper-bound-ish guess for the first block
+    arena = std::make_unique<std::pmr::monotonic_buffer_resource>(size_hint);
+  }
+  void *slot = arena->allocate(sizeof(TorrentValue), alignof(TorrentValue));
+  root = {new (slot) TorrentValue, RootDeleter{true}};
+  return arena.get();
 }
 
 DictView TorrentReader::field() const {
-  if (!root.isDict()) {
+  if (!root->isDict()) {
     throw std::runtime_error(
         "Root is not a dictionary (Invalid torrent structure)");
   }
-  return {root.asDict()};
+  return {root->asDict()};
 }
 
-auto TorrentReader::getRoot() const -> const TorrentValue & { return root; }
+auto TorrentReader::getRoot() const -> const TorrentValue & { return *root; }
 
-// --- Parser Logic ---
+std::string_view TorrentReader::source() const { return source_data; }
 
-char TorrentReader::peek() const {
-  if (pos >= source_data.size())
-    return 0; // EOF
-  return source_data[pos];
-}
+const ParseLimits &TorrentReader::limits() const { return parse_limits; }
 
-char TorrentReader::consume() {
-  if (pos >= source_data.size())
-    throw std::out_of_range("Unexpected End Of File");
-  return source_data[pos++];
-}
+bool TorrentReader::isMapped() const { return mapping.data() != nullptr; }
 
-bool TorrentReader::match(const char expected) {
-  if (peek() == expected) {
-    consume();
-    return true;
+std::string_view TorrentReader::infoBytes() const {
+  if (!info_searched) {
+    info_searched = true;
+    info_span = findValueSpan(source_data, "info", nullptr);
   }
-  return false;
+  if (!info_span)
+    return {};
+  if (stream_blocks.empty())
+    return source_data.substr(info_span->begin,
+                              info_span->end - info_span->begin);
+
+  const auto [begin, end] = *info_span;
+  if (!info_copy.empty())
+    return {info_copy.data(), info_copy.size()};
+  for (const auto &[offset, bytes] : stream_blocks) {
+    if (offset <= begin && end <= offset + bytes.size())
+      return bytes.substr(begin - offset, end - begin);
+  }
+  // Spread over several blocks: join the parts, skipping the overlaps
+  info_copy.reserve(end - begin);
+  for (const auto &[offset, bytes] : stream_blocks) {
+    const size_t at = begin + info_copy.size();
+    if (at >= end)
+      break;
+    if (offset + bytes.size() <= at)
+      continue;
+    const std::string_view part =
+        bytes.substr(at - offset, std::min(end, offset + bytes.size()) - at);
+    info_copy.insert(info_copy.end(), part.begin(), part.end());
+  }
+  return {info_copy.data(), info_copy.size()};
 }
 
-void TorrentReader::expect(const char expected) {
-  if (consume() != expected) {
-    throw std::runtime_error(std::string("Expected '") + expected +
-                             "' at position " + std::to_string(pos));
+const InfoHashes &TorrentReader::infoHashes() const {
+  if (info_hashes)
+    return *info_hashes;
+  InfoHashes hashes;
+  const std::string_view info = infoBytes();
+  if (!info.empty()) {
+    // BEP 52: v2 torrents declare meta version 2; hybrids also keep the v1
+    // pieces, and only those have a v1 identity
+    bool v1 = true;
+    bool v2 = false;
+    const TorrentValue *fields_value = nullptr;
+    if (root->isDict()) {
+      const auto &dict = root->asDict();
+      if (const auto it = dict.find("info"); it != dict.end())
+        fields_value = &it->second;
+    }
+    if (fields_value && fields_value->isDict()) {
+      const auto &fields = fields_value->asDict();
+      const auto version = fields.find("meta version");
+      v2 = version != fields.end() && version->second.isInt() &&
+           version->second.asInt() == 2;
+      v1 = !v2 || fields.contains("pieces");
+    }
+    if (v1)
+      hashes.v1 = sha1(info);
+    if (v2)
+      hashes.v2 = sha256(info);
   }
+  info_hashes = hashes;
+  return *info_hashes;
 }
 
-TorrentValue TorrentReader::parseElement() {
-  const char c = peek();
-  if (isdigit(c))
-    return {parseString()};
-  if (c == 'i')
-    return {parseInt()};
-  if (c == 'l')
-    return {parseList()};
-  if (c == 'd')
-    return {parseDict()};
+// --- TorrentTreeBuilder Implementation ---
 
-  throw std::runtime_error(std::string("Unknown type indicator '") + c +
-                           "' at " + std::to_string(pos));
-}
+TorrentTreeBuilder::TorrentTreeBuilder(std::pmr::memory_resource *resource)
+    : resource(resource) {}
 
-TorrentInt TorrentReader::parseInt() {
-  expect('i');
-  const size_t end = source_data.find('e', pos);
-  if (end == std::string::npos)
-    throw std::runtime_error("Unterminated integer");
+TorrentTreeBuilder::TorrentTreeBuilder(const StructuralIndex &index,
+                                       const size_t node,
+                                       std::pmr::memory_resource *resource)
+    : resource(resource), index(&index), next_node(node) {}
 
-  const std::string numStr = source_data.substr(pos, end - pos);
-  pos = end + 1; // Skip 'e'
+void TorrentTreeBuilder::recordSpan(std::string_view key,
+                                    std::function<size_t()> position) {
+  span_key = TorrentKey(key);
+  span_position = std::move(position);
+}
 
-  if (numStr == "-0")
-    throw std::runtime_error("Invalid integer -0");
-  if (numStr.size() > 1 && numStr[0] == '0')
-    throw std::runtime_error("Invalid leading zero");
+void TorrentTreeBuilder::attach(TorrentValue value) {
+  if (open.empty()) {
+    root = std::move(value);
+    return;
+  }
+  auto &parent = open.back().data;
+  // The recorded value just ended, so the parser is right after it
+  if (span_position && open.size() == 1 && keys.back() == span_key &&
+      std::holds_alternative<TorrentDict>(parent))
+    recorded = SourceSpan{span_begin, span_position()};
+  if (auto *list = std::get_if<TorrentList>(&parent)) {
+    list->push_back(std::move(value));
+  } else {
+    entries.emplace_back(keys.back(), std::move(value));
+  }
+}
 
-  try {
-    return std::stoll(numStr);
-  } catch (...) {
-    throw std::runtime_error("Integer parse error: " + numStr);
+BencodeAction TorrentTreeBuilder::close() {
+  TorrentValue value = std::move(open.back());
+  open.pop_back();
+  keys.pop_back();
+  if (auto *dict = std::get_if<TorrentDict>(&value.data)) {
+    const auto first = entries.begin() + dict_starts.back();
+    // Bencode keys arrive sorted. Anything else is sorted here in one go,
+    // the last of any duplicates winning as repeated assignment would, so
+    // every insertion below is an append.
+    const auto before = [](const TorrentDict::value_type &a,
+                           const TorrentDict::value_type &b) {
+      return a.first.str() < b.first.str();
+    };
+    const auto out_of_order = [&](const auto &a, const auto &b) {
+      return !before(a, b);
+    };
+    if (std::adjacent_find(first, entries.end(), out_of_order) !=
+        entries.end()) {
+      std::stable_sort(first, entries.end(), before);
+      auto out = first;
+      for (auto it = first; it != entries.end(); ++it) {
+        if (std::next(it) != entries.end() && std::next(it)->first == it->first)
+          continue;
+        if (out != it)
+          *out = std::move(*it);
+        ++out;
+      }
+      entries.erase(out, entries.end());
+    }
+    dict->reserve(entries.end() - first);
+    for (auto it = first; it != entries.end(); ++it)
+      dict->insert_or_assign(it->first, std::move(it->second));
+    entries.erase(first, entries.end());
+    dict_starts.pop_back();
   }
+  attach(std::move(value));
+  return BencodeAction::Continue;
 }
 
-TorrentString TorrentReader::parseString() {
-  const size_t colon = source_data.find(':', pos);
-  if (colon == std::string::npos)
-    throw std::runtime_error("Invalid string length format");
+BencodeAction TorrentTreeBuilder::onInt(const long long value) {
+  attach(TorrentValue(value));
+  return BencodeAction::Continue;
+}
 
-  const std::string lenStr = source_data.substr(pos, colon - pos);
-  const long long len = std::stoll(lenStr);
+BencodeAction TorrentTreeBuilder::onString(const std::string_view value) {
+  attach(TorrentValue(TorrentString(value)));
+  return BencodeAction::Continue;
+}
 
-  pos = colon + 1; // Skip ':'
+BencodeAction TorrentTreeBuilder::begin(TorrentValue container) {
+  if (index) {
+    if (next_node >= index->size())
+      throw std::runtime_error("Container " + std::to_string(next_node) +
+                               " is not in the structural index");
+    if (!open.empty()) {
+      // Nested container: record where it lives and skip over it
+      attach(TorrentValue(TorrentLazy{index, next_node, resource}));
+      next_node = index->next(next_node);
+      return BencodeAction::Skip;
+    }
+    ++next_node;
+  }
+  if (container.isDict())
+    dict_starts.push_back(entries.size());
+  open.push_back(std::move(container));
+  keys.emplace_back();
+  return BencodeAction::Continue;
+}
 
-  if (pos + len > source_data.size())
-    throw std::runtime_error("String content out of bounds");
+BencodeAction TorrentTreeBuilder::onListBegin() {
+  return begin(TorrentValue(TorrentList(resource)));
+}
 
-  std::string str = source_data.substr(pos, len);
-  pos += len;
+BencodeAction TorrentTreeBuilder::onListEnd() { return close(); }
 
-  return str;
+BencodeAction TorrentTreeBuilder::onDictBegin() {
+  return begin(TorrentValue(TorrentDict(resource)));
 }
 
-TorrentList TorrentReader::parseList() {
-  expect('l');
-  TorrentList list;
-  while (peek() != 'e' && peek() != 0) {
-    list.push_back(parseElement());
-  }
-  expect('e');
-  return list;
+BencodeAction TorrentTreeBuilder::onKey(const std::string_view key) {
+  return addKey(TorrentKey(key));
 }
 
-TorrentDict TorrentReader::parseDict() {
-  expect('d');
-  TorrentDict dict;
-  while (peek() != 'e' && peek() != 0) {
-    // Keys must be strings
-    TorrentString key = parseString();
-    TorrentValue value = parseElement();
-    dict[key] = value;
-  }
-  expect('e');
-  return dict;
+BencodeAction TorrentTreeBuilder::addKey(const TorrentKey key) {
+  keys.back() = key;
+  if (span_position && open.size() == 1 && keys.back() == span_key)
+    span_begin = span_position();
+  return BencodeAction::Continue;
 }
 
+BencodeAction TorrentTreeBuilder::onDictEnd() { return close(); }
+
 // Simple validator: root must be a dictionary and contain at least an "info"
 // key. Additional checks (announce, piece length, etc.) can be added later.
 bool TorrentReader::isValidTorrent() const {
-  if (!root.isDict())
+  if (!root->isDict())
     return false;
-  const auto &dict = root.asDict();
-  return dict.contains("info");
+  try {
+    return root->asDict().contains("info");
+  } catch (const std::runtime_error &) {
+    return false; // a lazy root whose contents do not parse
+  }
 }
@@ -1,12 +1,27 @@
 #pragma once
 
+#include "bencode_parser.h"
+#include "bencode_projection.h"
+#include "meta_key.h"
+#include "mapped_file.h"
+#include "sha.h"
+#include "string_kind.h"
+#include "structural_index.h"
+#include "torrent_archive.h"
+
 #include <algorithm>
+#include <concepts>
+#include <expected>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <map>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -15,46 +30,228 @@ struct TorrentValue;
 
 // Alias types for clarity
 using TorrentInt = long long;
-using TorrentString = std::string;
-using TorrentList = std::vector<TorrentValue>;
-// using std::map with incomplete type is allowed in some C++ versions,
-// but wrapping in unique_ptr ensures standard compliance for recursive
-// definitions.
-using TorrentDict = std::map<std::string, TorrentValue>;
+/// @brief A string value: a borrowed slice of the reader's source buffer, so
+/// a TorrentValue must not outlive the TorrentReader it came from. Carries
+/// its StringKind, worked out once when the string is parsed so rendering
+/// never rescans it. Dictionary keys are TorrentKeys instead.
+class TorrentString : public std::string_view {
+public:
+  TorrentString() = default;
+  TorrentString(std::string_view bytes, StringKind kind)
+      : std::string_view(bytes), text_kind(kind) {}
+  // Classifies `bytes`
+  explicit TorrentString(std::string_view bytes)
+      : TorrentString(bytes, classifyString(bytes)) {}
+
+  StringKind kind() const { return text_kind; }
+  // ASCII or valid UTF-8 without control bytes
+  bool isText() const { return text_kind != StringKind::Binary; }
+
+private:
+  StringKind text_kind = StringKind::Ascii;
+};
+// Containers use polymorphic allocators so a whole tree can be carved out
+// of one per-document arena; by default they allocate from the heap.
+using TorrentList = std::pmr::vector<TorrentValue>;
+
+/// @brief Dictionary stored as one contiguous vector of (key, value) pairs
+/// kept sorted by key bytes. Bencode already requires sorted keys, so
+/// building is a run of appends; entries need no allocation of their own.
+/// Well-known keys carry their MetaKey, so matching one is an integer compare.
+/// Iterators dereference to std::pair like std::map's, and lookups accept
+/// any string_view.
+class TorrentDict {
+public:
+  using value_type = std::pair<TorrentKey, TorrentValue>;
+  using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+  using iterator = std::pmr::vector<value_type>::iterator;
+  using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+  TorrentDict() = default;
+  explicit TorrentDict(const allocator_type &alloc) : entries(alloc) {}
+
+  allocator_type get_allocator() const { return entries.get_allocator(); }
+
+  size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  void reserve(size_t count) { entries.reserve(count); }
+
+  iterator begin() { return entries.begin(); }
+  iterator end() { return entries.end(); }
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+
+  iterator find(TorrentKey key);
+  const_iterator find(TorrentKey key) const;
+  iterator find(std::string_view key);
+  const_iterator find(std::string_view key) const;
+  bool contains(std::string_view key) const;
+  // Throws std::out_of_range if the key is absent
+  TorrentValue &at(std::string_view key);
+  const TorrentValue &at(std::string_view key) const;
+
+  // Appends when key sorts after the last entry (the bencode case), else
+  // inserts in place or replaces an existing value. TorrentTreeBuilder
+  // sorts unordered input first, so it only ever appends.
+  TorrentValue &insert_or_assign(TorrentKey key, TorrentValue value);
+
+private:
+  // Up to this many entries, scanning ids beats a binary search on bytes
+  static constexpr size_t linear_scan_max = 8;
+
+  std::pmr::vector<value_type> entries;
+
+  const_iterator lowerBound(std::string_view key) const;
+};
+
+// A list or dictionary that has been indexed but not parsed yet. It is
+// replaced by the real container the first time its contents are accessed,
+// allocated from `resource`.
+struct TorrentLazy {
+  const StructuralIndex *index;
+  size_t node;
+  std::pmr::memory_resource *resource;
+};
 
 struct TorrentValue {
-  // We use a variant to hold the specific Torrent type
-  std::variant<TorrentInt, TorrentString, TorrentList, TorrentDict> data;
+  // We use a variant to hold the specific Torrent type. Mutable so that const
+  // accessors can materialize a lazy container in place.
+  mutable std::variant<TorrentInt, TorrentString, TorrentList, TorrentDict,
+                       TorrentLazy>
+      data;
+
+  TorrentValue() = default;
+  template <typename T>
+    requires std::constructible_from<decltype(data), T>
+  explicit TorrentValue(T &&value) : data(std::forward<T>(value)) {}
+  TorrentValue(const TorrentValue &) = default;
+  TorrentValue(TorrentValue &&) = default;
+  TorrentValue &operator=(const TorrentValue &) = default;
+  TorrentValue &operator=(TorrentValue &&) = default;
+  // Nested containers are torn down with an explicit stack rather than by
+  // recursion, so no nesting depth can overflow the call stack
+  ~TorrentValue() {
+    const auto *list = std::get_if<TorrentList>(&data);
+    const auto *dict = std::get_if<TorrentDict>(&data);
+    if ((list && !list->empty()) || (dict && !dict->empty()))
+      releaseChildren();
+  }
 
   // Helper to check types
   bool isInt() const { return std::holds_alternative<TorrentInt>(data); }
   bool isString() const { return std::holds_alternative<TorrentString>(data); }
-  bool isList() const { return std::holds_alternative<TorrentList>(data); }
-  bool isDict() const { return std::holds_alternative<TorrentDict>(data); }
+  bool isList() const {
+    const auto *lazy = std::get_if<TorrentLazy>(&data);
+    return lazy ? lazy->index->isList(lazy->node)
+                : std::holds_alternative<TorrentList>(data);
+  }
+  bool isDict() const {
+    const auto *lazy = std::get_if<TorrentLazy>(&data);
+    return lazy ? lazy->index->isDict(lazy->node)
+                : std::holds_alternative<TorrentDict>(data);
+  }
+
+  // True while this container's children have not been parsed
+  bool isLazy() const { return std::holds_alternative<TorrentLazy>(data); }
+
+  // Parse one level of a lazy container; nested containers stay lazy.
+  // Throws std::runtime_error if its contents are malformed, which only an
+  // index from a stale or forged cache snapshot lets through, so asList()
+  // and asDict() on a lazy value can throw too.
+  void materialize() const;
 
   // Accessors (throw if type mismatch)
   const TorrentInt &asInt() const { return std::get<TorrentInt>(data); }
   const TorrentString &asString() const {
     return std::get<TorrentString>(data);
   }
-  const TorrentList &asList() const { return std::get<TorrentList>(data); }
-  const TorrentDict &asDict() const { return std::get<TorrentDict>(data); }
+  const TorrentList &asList() const {
+    materialize();
+    return std::get<TorrentList>(data);
+  }
+  const TorrentDict &asDict() const {
+    materialize();
+    return std::get<TorrentDict>(data);
+  }
 
-  // Friendly printer for std::cout
+  // Friendly printer for std::cout; iterative like the destructor
   friend std::ostream &operator<<(std::ostream &os, const TorrentValue &val);
+
+private:
+  void releaseChildren();
 };
 
+// --- TorrentDict inline members (need the complete TorrentValue) ---
+
+inline TorrentDict::const_iterator
+TorrentDict::lowerBound(std::string_view key) const {
+  return std::lower_bound(entries.begin(), entries.end(), key,
+                          [](const value_type &entry, std::string_view k) {
+                            return entry.first.str() < k;
+                          });
+}
+
+inline TorrentDict::const_iterator TorrentDict::find(TorrentKey key) const {
+  if (entries.size() <= linear_scan_max) {
+    return std::find_if(entries.begin(), entries.end(),
+                        [key](const value_type &entry) {
+                          return entry.first == key;
+                        });
+  }
+  const auto it = lowerBound(key.str());
+  return it != end() && it->first == key ? it : end();
+}
+
+inline TorrentDict::const_iterator
+TorrentDict::find(std::string_view key) const {
+  return find(TorrentKey(key));
+}
+
+inline bool TorrentDict::contains(std::string_view key) const {
+  return find(key) != end();
+}
+
+inline TorrentDict::iterator TorrentDict::find(TorrentKey key) {
+  return entries.begin() + (std::as_const(*this).find(key) - entries.cbegin());
+}
+
+inline TorrentDict::iterator TorrentDict::find(std::string_view key) {
+  return entries.begin() + (std::as_const(*this).find(key) - entries.cbegin());
+}
+
+inline const TorrentValue &TorrentDict::at(std::string_view key) const {
+  const auto it = find(key);
+  if (it == end())
+    throw std::out_of_range("TorrentDict::at: key not found");
+  return it->second;
+}
+
+inline TorrentValue &TorrentDict::at(std::string_view key) {
+  return const_cast<TorrentValue &>(std::as_const(*this).at(key));
+}
+
+inline TorrentValue &TorrentDict::insert_or_assign(TorrentKey key,
+                                                   TorrentValue value) {
+  if (entries.empty() || entries.back().first.str() < key.str())
+    return entries.emplace_back(key, std::move(value)).second;
+  const auto pos = entries.begin() + (lowerBound(key) - entries.cbegin());
+  if (pos->first == key) {
+    pos->second = std::move(value);
+    return pos->second;
+  }
+  return entries.emplace(pos, key, std::move(value))->second;
+}
+
 // Helper class to provide the .key() / .value() syntax requested
 class DictEntryProxy {
 public:
-  DictEntryProxy(const std::string &key, const TorrentValue &val)
-      : k(key), v(val) {}
+  DictEntryProxy(TorrentKey key, const TorrentValue &val) : k(key), v(val) {}
 
-  const std::string &key() const { return k; }
+  std::string_view key() const { return k.str(); }
   const TorrentValue &value() const { return v; }
 
 private:
-  const std::string &k;
+  TorrentKey k;
   const TorrentValue &v;
 };
 
@@ -83,9 +280,162 @@ private:
   const TorrentDict &dict_ref;
 };
 
+// A byte range [begin, end) of a document's source
+struct SourceSpan {
+  size_t begin;
+  size_t end;
+};
+
+/// @brief BencodeHandler that assembles parser events into a TorrentValue
+/// tree. This is how TorrentReader builds its DOM; it can be fed by any
+/// BencodeParser whose source outlives the resulting tree.
+class TorrentTreeBuilder : public BencodeHandler {
+public:
+  // Containers are allocated from `resource`
+  explicit TorrentTreeBuilder(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  // Shallow mode: build only the direct children of an indexed container,
+  // leaving nested containers as TorrentLazy. Pair with the BencodeParser
+  // constructed from the same index and node.
+  TorrentTreeBuilder(
+      const StructuralIndex &index, size_t node,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  BencodeAction onInt(long long value) override;
+  BencodeAction onString(std::string_view value) override;
+  BencodeAction onListBegin() override;
+  BencodeAction onListEnd() override;
+  BencodeAction onDictBegin() override;
+  BencodeAction onKey(std::string_view key) override;
+  BencodeAction onDictEnd() override;
+
+  // The completed value; only meaningful once the parse has finished
+  TorrentValue &result() { return root; }
+
+  // Note where the value of top-level dictionary key `key` lies in the
+  // source as it is parsed; `position` returns the feeding parser's
+  // position(). Only valid if the builder sees every event of that value.
+  void recordSpan(std::string_view key, std::function<size_t()> position);
+  // The recorded value's bytes, once it has been parsed
+  std::optional<SourceSpan> span() const { return recorded; }
+
+protected:
+  // onKey() with the key already made
+  BencodeAction addKey(TorrentKey key);
+
+private:
+  TorrentValue root;
+  // Containers still being filled, innermost last, with the pending key for
+  // each level (unused for lists)
+  std::vector<TorrentValue> open;
+  std::vector<TorrentKey> keys;
+  // Entries of the open dictionaries, gathered here and moved into an
+  // exactly sized TorrentDict when it closes; dict_starts marks where each
+  // open dictionary's entries begin
+  std::vector<TorrentDict::value_type> entries;
+  std::vector<size_t> dict_starts;
+  std::pmr::memory_resource *resource;
+  // Shallow mode only: preorder number of the next nested container
+  const StructuralIndex *index = nullptr;
+  size_t next_node = 0;
+  // recordSpan() state
+  TorrentKey span_key;
+  std::function<size_t()> span_position;
+  size_t span_begin = 0;
+  std::optional<SourceSpan> recorded;
+
+  void attach(TorrentValue value);
+  BencodeAction begin(TorrentValue container);
+  BencodeAction close();
+};
+
+// How the source file is brought into memory
+enum class TorrentLoadMode {
+  Read, // copy the file into an owned buffer
+  Map,  // memory-map the file; falls back to Read for pipes and devices
+};
+
+// Which BasicBencodeParser instantiation builds the tree
+enum class TorrentParseMode {
+  Strict,  // BencodeParser: full validation, for files from anywhere
+  Lenient, // LenientBencodeParser: also accepts non-canonical integers
+  Trusted, // TrustedBencodeParser: no checks; files validated before only
+};
+
+struct TorrentReaderOptions {
+  TorrentLoadMode load_mode = TorrentLoadMode::Map;
+  // Ignored by lazy and streamed reads, which always validate strictly
+  TorrentParseMode parse_mode = TorrentParseMode::Strict;
+  // Index the document up front and parse containers only when first
+  // accessed, so opening cost depends on how much of the tree is looked at
+  bool lazy = false;
+  // Budgets for untrusted input; exceeding one throws ParseLimitError
+  ParseLimits limits;
+  // Allocate the whole tree from a per-document monotonic arena: building
+  // is a handful of bump allocations and destroying the reader frees it all
+  // at once without visiting the nodes
+  bool arena = false;
+  // Parse the elements of large lists (such as info.files) on this many
+  // threads; 0 means one per core. Eager reads of whole files only. The tree
+  // is identical to a single-threaded parse, but the document is indexed
+  // first and always validated strictly. One thread (or one core) parses
+  // sequentially.
+  size_t threads = 1;
+  // Build only these key paths and the containers leading to them, skipping
+  // every other subtree and stopping once all have been seen. Takes
+  // precedence over lazy and threads.
+  std::vector<KeyPath> projection;
+  // Keep snapshots of the structural index here (see IndexCache), so lazy
+  // and threaded reads of an unchanged file skip the indexing scan. Regular
+  // uncompressed files only; empty disables the cache.
+  std::string cache_dir;
+  // gzip and zstd input, and the compressed tar around an archive member,
+  // may decode to at most this many bytes before ParseLimits ever see them;
+  // more throws std::runtime_error
+  uint64_t max_decoded = decode_budget;
+};
+
+// A torrent's identities: hashes of the bencoded info dictionary
+struct InfoHashes {
+  std::optional<Sha1Digest> v1;   // v1 and hybrid torrents ("pieces")
+  std::optional<Sha256Digest> v2; // v2 and hybrid torrents ("meta version" 2)
+};
+
 class TorrentReader {
 public:
-  explicit TorrentReader(const std::string &filepath);
+  // Pipes, FIFOs and devices named by path are read as a stream (see below),
+  // as are compressed files and tar members named "bundle.tar!/a.torrent"
+  explicit TorrentReader(const std::string &filepath,
+                         const TorrentReaderOptions &options = {});
+
+  // Parse from a stream such as std::cin while it is still being read, with
+  // BencodePushParser. gzip and zstd streams are decompressed on the fly.
+  // The input is read into blocks of a per-document arena that never move,
+  // and strings borrow from those like they do from a mapped file, so the
+  // document is held once; source() stays empty. `lazy` is ignored because
+  // the index needs the whole document up front.
+  explicit TorrentReader(std::istream &input,
+                         const TorrentReaderOptions &options = {});
+
+  /// @brief Non-throwing counterpart of the path constructor, for batch
+  /// ingestion of corpora where many files are truncated or malformed.
+  /// Plain files are validated with validateBencode() first, so a bad file
+  /// costs one scan and no unwinding, and a good one is then built with the
+  /// unchecked TrustedBencodeParser. Lazy and threaded reads instead report
+  /// the errors found while building their StructuralIndex, and skip the scan
+  /// entirely when the index comes from options.cache_dir. Compressed,
+  /// archived and non-regular inputs go through the throwing path and come
+  /// back as Stream errors. Only running out of memory still throws.
+  static std::expected<TorrentReader, ParseError>
+  parse(const std::string &filepath, const TorrentReaderOptions &options = {});
+
+  // Parsed values point into the source buffer: copying would leave the copy
+  // referencing our storage. Moving is fine since the buffer does not move.
+  TorrentReader(const TorrentReader &) = delete;
+  TorrentReader &operator=(const TorrentReader &) = delete;
+  TorrentReader(TorrentReader &&) = default;
+  TorrentReader &operator=(TorrentReader &&) = default;
 
   // Validates file extension and structure
   bool isValidTorrent() const;
@@ -96,20 +446,85 @@ public:
   // Direct access to the root value
   const TorrentValue &getRoot() const;
 
+  // The raw bencoded bytes every TorrentString refers into; empty for
+  // streamed, decompressed and archived input, which is kept in blocks
+  std::string_view source() const;
+
+  // The options.limits the document was read under
+  const ParseLimits &limits() const;
+
+  // True when the source is a memory mapping rather than an owned copy
+  bool isMapped() const;
+
+  // The info dictionary exactly as it appears in the input, the bytes the
+  // info-hashes are taken over; empty if there is none, and for projected
+  // streams. Its position is recorded while parsing, so this needs no
+  // re-encoding and usually no scan. Streamed input copies it out of its
+  // blocks on first use if it spans more than one.
+  std::string_view infoBytes() const;
+
+  // Computed on first use and kept with the document. Not synchronised:
+  // call from one thread at a time per reader.
+  const InfoHashes &infoHashes() const;
+
 private:
-  std::string source_data;
-  size_t pos = 0;
-  TorrentValue root;
+  TorrentReader() = default;
+
+  ParseLimits parse_limits;
+  MappedFile mapping;
+  std::vector<char> buffer;
+  std::string_view source_data;
+  // Cached index arrays, mapped from options.cache_dir; must outlive index
+  MappedFile index_snapshot;
+  // Owned through a pointer so lazy values keep a stable address to it
+  std::unique_ptr<StructuralIndex> index;
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+  // With options.arena and threads, one arena per range of list elements
+  // parsed on a worker, since monotonic arenas are not thread-safe
+  std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>>
+      range_arenas;
+
+  // The root lives on the heap, or inside the arena where it is never
+  // destroyed individually: releasing the arena reclaims the whole tree
+  struct RootDeleter {
+    bool in_arena;
+    void operator()(TorrentValue *value) const {
+      if (!in_arena)
+        delete value;
+    }
+  };
+  std::unique_ptr<TorrentValue, RootDeleter> root;
+
+  // Streamed input: the arena blocks it was read into, in order, each with
+  // the stream offset of its first byte. A block starts with the token the
+  // previous one cut off, so neighbours can overlap.
+  struct StreamBlock {
+    size_t offset;
+    std::string_view bytes;
+  };
+  std::vector<StreamBlock> stream_blocks;
+  // infoBytes() of streamed input whose info spans blocks
+  mutable std::vector<char> info_copy;
+
+  // Where info lies in source_data (or the stream); found while parsing,
+  // except for projections, which look it up on first use
+  mutable std::optional<SourceSpan> info_span;
+  mutable bool info_searched = false;
+  mutable std::optional<InfoHashes> info_hashes;
 
-  // Parser methods
-  TorrentValue parseElement();
-  TorrentInt parseInt();
-  TorrentString parseString();
-  TorrentList parseList();
-  TorrentDict parseDict();
-
-  char peek() const;
-  char consume();
-  bool match(char expected);
-  void expect(char expected);
+  // Allocates the root per options.arena and returns the container resource
+  std::pmr::memory_resource *createRoot(const TorrentReaderOptions &options,
+                                        size_t size_hint);
+  // Map or read a regular file into source_data; false if it cannot be read
+  bool loadFile(const std::string &filepath, TorrentLoadMode mode);
+  // Build the tree from source_data, which must be uncompressed bencode
+  void parseSource(const std::string &filepath,
+                   const TorrentReaderOptions &options);
+  void readStream(std::istream &input, const TorrentReaderOptions &options);
+  // Index source_data, or load the index from options.cache_dir; the scan
+  // validates as it goes, so a failure is the document's first error
+  std::expected<void, ParseError>
+  buildIndex(const std::string &filepath, const TorrentReaderOptions &options);
+  void parseParallel(std::pmr::memory_resource *resource,
+                     const TorrentReaderOptions &options, size_t threads);
 };
@@ -0,0 +1,160 @@
+#include "torrent_tape.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Appends one record per parser event
+class TapeBuilder : public BencodeHandler {
+public:
+  TapeBuilder(const BencodeParser &parser, std::string_view source,
+              std::vector<TapeNode> &nodes)
+      : parser(parser), source(source), nodes(nodes) {}
+
+  BencodeAction onInt(long long value) override {
+    push(static_cast<uint64_t>(value), 0, TapeNode::Int);
+    completed();
+    return BencodeAction::Continue;
+  }
+  BencodeAction onString(std::string_view value) override {
+    pushString(value, classifyString(value));
+    completed();
+    return BencodeAction::Continue;
+  }
+  BencodeAction onKey(std::string_view key) override {
+    pushString(key, StringKind::Ascii); // keys are not previewed
+    return BencodeAction::Continue;
+  }
+  BencodeAction onListBegin() override { return begin(TapeNode::List); }
+  BencodeAction onDictBegin() override { return begin(TapeNode::Dict); }
+  BencodeAction onListEnd() override { return end(); }
+  BencodeAction onDictEnd() override { return end(); }
+
+private:
+  const BencodeParser &parser;
+  std::string_view source;
+  std::vector<TapeNode> &nodes;
+  std::vector<size_t> open;
+
+  void push(uint64_t payload, uint32_t count, TapeNode::Type type) {
+    nodes.push_back({payload, count, (1u << 2) | type});
+  }
+
+  void pushString(std::string_view value, StringKind kind) {
+    if (value.size() > UINT32_MAX)
+      throw std::runtime_error("String too large for tape");
+    push(static_cast<uint64_t>(value.data() - source.data()),
+         static_cast<uint32_t>(value.size()), TapeNode::String);
+    nodes.back().type_skip |= static_cast<uint32_t>(kind) << 30;
+  }
+
+  // A value finished: count it as an element / entry of its parent
+  void completed() {
+    if (!open.empty())
+      ++nodes[open.back()].count;
+  }
+
+  BencodeAction begin(TapeNode::Type type) {
+    open.push_back(nodes.size());
+    push(parser.position() - 1, 0, type);
+    return BencodeAction::Continue;
+  }
+
+  BencodeAction end() {
+    auto &node = nodes[open.back()];
+    const size_t skip = nodes.size() - open.back();
+    if (skip > (UINT32_MAX >> 2))
+      throw std::runtime_error("Document too large for tape");
+    node.type_skip = static_cast<uint32_t>(skip << 2) | node.type();
+    open.pop_back();
+    completed();
+    return BencodeAction::Continue;
+  }
+};
+
+std::runtime_error typeMismatch(const char *expected) {
+  return std::runtime_error(std::string("Tape value is not ") + expected);
+}
+
+} // namespace
+
+TorrentTape::TorrentTape(std::string_view source, const ParseLimits &limits)
+    : source_data(source) {
+  BencodeParser parser(source_data, limits);
+  TapeBuilder builder(parser, source_data, nodes);
+  parser.parse(builder);
+  nodes.shrink_to_fit();
+}
+
+// --- TapeCursor Implementation ---
+
+const TapeNode &TapeCursor::node() const { return (*tape)[index]; }
+
+long long TapeCursor::asInt() const {
+  if (!isInt())
+    throw typeMismatch("an integer");
+  return static_cast<long long>(node().payload);
+}
+
+std::string_view TapeCursor::asString() const {
+  if (!isString())
+    throw typeMismatch("a string");
+  return tape->source().substr(node().payload, node().count);
+}
+
+StringKind TapeCursor::stringKind() const {
+  if (!isString())
+    throw typeMismatch("a string");
+  return node().kind();
+}
+
+size_t TapeCursor::size() const {
+  return isList() || isDict() ? node().count : 0;
+}
+
+TapeCursor::ListIterator TapeCursor::begin() const {
+  if (!isList())
+    throw typeMismatch("a list");
+  return {*tape, index + 1};
+}
+
+TapeCursor::ListIterator TapeCursor::end() const {
+  if (!isList())
+    throw typeMismatch("a list");
+  return {*tape, index + node().skip()};
+}
+
+void TapeCursor::ListIterator::operator++() { index += (*tape)[index].skip(); }
+
+TapeDictView TapeCursor::entries() const {
+  if (!isDict())
+    throw typeMismatch("a dictionary");
+  return {*tape, index + 1, index + node().skip()};
+}
+
+bool TapeCursor::find(std::string_view key, TapeCursor &out) const {
+  if (!isDict())
+    return false;
+  // Linear to the end: the parser accepts unsorted and repeated keys, and
+  // the last duplicate wins, as it does in the tree
+  bool found = false;
+  for (const auto &entry : entries()) {
+    if (entry.key() == key) {
+      out = entry.value();
+      found = true;
+    }
+  }
+  return found;
+}
+
+// --- TapeDictView Implementation ---
+
+void TapeDictView::ProxyIterator::operator++() {
+  // Step over the key record, then the value's subtree
+  index += 1 + (*tape)[index + 1].skip();
+}
+
+TapeEntry TapeDictView::ProxyIterator::operator*() const {
+  return {TapeCursor(*tape, index).asString(), TapeCursor(*tape, index + 1)};
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "bencode_parser.h"
+#include "string_kind.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/// @brief One 16-byte record of a TorrentTape.
+/// Dictionaries store their entries as alternating key (String) and value
+/// records; `skip` lets a walker step over any subtree in O(1).
+struct TapeNode {
+  enum Type : uint32_t { Int = 0, String = 1, List = 2, Dict = 3 };
+
+  // Int: the value. String: offset of the bytes in the source.
+  // List/Dict: offset of the opening 'l' / 'd'.
+  uint64_t payload;
+  // String: length in bytes. List: element count. Dict: entry count.
+  uint32_t count;
+  // Type in the low two bits, then the subtree size in records (including
+  // this one). Strings are always one record, so their StringKind is kept
+  // in the top bits instead.
+  uint32_t type_skip;
+
+  Type type() const { return static_cast<Type>(type_skip & 3); }
+  size_t skip() const { return type() == String ? 1 : type_skip >> 2; }
+  StringKind kind() const { return static_cast<StringKind>(type_skip >> 30); }
+};
+static_assert(sizeof(TapeNode) == 16, "tape records must stay compact");
+
+class TorrentTape;
+class TapeDictView;
+
+/// @brief Read-only handle to one value on a tape. Cheap to copy; valid as
+/// long as the tape (and its source) lives.
+class TapeCursor {
+public:
+  TapeCursor(const TorrentTape &tape, size_t index)
+      : tape(&tape), index(index) {}
+
+  bool isInt() const { return node().type() == TapeNode::Int; }
+  bool isString() const { return node().type() == TapeNode::String; }
+  bool isList() const { return node().type() == TapeNode::List; }
+  bool isDict() const { return node().type() == TapeNode::Dict; }
+
+  // Accessors (throw if type mismatch)
+  long long asInt() const;
+  std::string_view asString() const;
+  // Classification of a string value, computed when the tape was built
+  StringKind stringKind() const;
+
+  // Elements of a list / entries of a dict
+  size_t size() const;
+
+  // List elements in order
+  class ListIterator;
+  ListIterator begin() const;
+  ListIterator end() const;
+
+  // Dictionary entries with .key() / .value(), like DictView
+  TapeDictView entries() const;
+  // Dictionary lookup; returns false if absent (or not a dict). Of repeated
+  // keys the last wins, matching the tree.
+  bool find(std::string_view key, TapeCursor &out) const;
+
+  // Position of this record on the tape
+  size_t position() const { return index; }
+
+private:
+  const TorrentTape *tape;
+  size_t index;
+
+  const TapeNode &node() const;
+};
+
+class TapeCursor::ListIterator {
+public:
+  ListIterator(const TorrentTape &tape, size_t index)
+      : tape(&tape), index(index) {}
+
+  bool operator!=(const ListIterator &other) const {
+    return index != other.index;
+  }
+  void operator++();
+  TapeCursor operator*() const { return {*tape, index}; }
+
+private:
+  const TorrentTape *tape;
+  size_t index;
+};
+
+// Same .key() / .value() shape as DictEntryProxy
+class TapeEntry {
+public:
+  TapeEntry(std::string_view key, TapeCursor value) : k(key), v(value) {}
+
+  std::string_view key() const { return k; }
+  const TapeCursor &value() const { return v; }
+
+private:
+  std::string_view k;
+  TapeCursor v;
+};
+
+/// @brief Iteration over a tape dictionary, mirroring DictView
+class TapeDictView {
+public:
+  struct ProxyIterator {
+    const TorrentTape *tape;
+    size_t index; // record of the current key
+
+    bool operator==(const ProxyIterator &other) const {
+      return index == other.index;
+    }
+    bool operator!=(const ProxyIterator &other) const {
+      return index != other.index;
+    }
+    void operator++();
+    TapeEntry operator*() const;
+  };
+
+  TapeDictView(const TorrentTape &tape, size_t first, size_t last)
+      : tape(tape), first(first), last(last) {}
+
+  ProxyIterator begin() const { return {&tape, first}; }
+  ProxyIterator end() const { return {&tape, last}; }
+
+private:
+  const TorrentTape &tape;
+  size_t first;
+  size_t last;
+};
+
+/// @brief Flat, preorder document: every value is one TapeNode in a single
+/// contiguous array and strings point back into the source. An alternative
+/// to the TorrentValue tree for whole-document walks over large torrents,
+/// at 16 bytes per value. The source must outlive the tape.
+class TorrentTape {
+public:
+  explicit TorrentTape(std::string_view source,
+                       const ParseLimits &limits = {});
+
+  TapeCursor root() const { return {*this, 0}; }
+
+  std::string_view source() const { return source_data; }
+  size_t size() const { return nodes.size(); }
+  const TapeNode &operator[](size_t index) const { return nodes[index]; }
+
+private:
+  std::string_view source_data;
+  std::vector<TapeNode> nodes;
+};